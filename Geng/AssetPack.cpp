@@ -0,0 +1,338 @@
+// AssetPack.cpp
+#include "AssetPack.h"
+#include "LzCodec.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <unordered_set>
+
+static_assert(sizeof(AssetPackEntry) == 48, "AssetPackEntry is part of the .gpak format");
+
+// File layout (little endian):
+//   "GPAK" version(u32) entryCount(u32) slotCount(u32) nameBytes(u64) reserved(u64)
+//   slots        u32[slotCount], open addressing on hash & (slotCount - 1)
+//   entries      AssetPackEntry[entryCount]
+//   names        nameBytes of path characters
+//   data         every entry's stored bytes, 16-byte aligned
+static const char ASSET_PACK_MAGIC[4] = { 'G', 'P', 'A', 'K' };
+static const size_t ASSET_PACK_HEADER_SIZE = 32;
+static const size_t ASSET_PACK_ALIGN = 16;
+
+enum : uint32_t {
+    PACK_STORED = 0,
+    PACK_LZ = 1,
+};
+
+static uint64_t HashPath(const std::string& normalized) {
+    uint64_t hash = 14695981039346656037ull;   // FNV-1a
+    for (unsigned char c : normalized) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string NormalizeAssetPath(const std::string& path) {
+    std::string normalized;
+    normalized.reserve(path.size());
+    for (char c : path) {
+        c = c == '\\' ? '/' : char(std::tolower(static_cast<unsigned char>(c)));
+        if (c == '/' && !normalized.empty() && normalized.back() == '/') continue;
+        normalized.push_back(c);
+    }
+    while (normalized.compare(0, 2, "./") == 0) normalized.erase(0, 2);
+    return normalized;
+}
+
+bool AssetPack::Open(const std::string& packPath) {
+    path = packPath;
+    if (!file.Open(packPath)) return false;
+
+    const char* data = file.Data();
+    const size_t size = file.Size();
+    uint32_t version = 0, count = 0, slotCount = 0;
+    uint64_t nameBytes = 0;
+    if (size >= ASSET_PACK_HEADER_SIZE) {
+        memcpy(&version, data + 4, 4);
+        memcpy(&count, data + 8, 4);
+        memcpy(&slotCount, data + 12, 4);
+        memcpy(&nameBytes, data + 16, 8);
+    }
+    const size_t entriesOffset = ASSET_PACK_HEADER_SIZE + size_t(slotCount) * sizeof(uint32_t);
+    const size_t namesOffset = entriesOffset + size_t(count) * sizeof(AssetPackEntry);
+    if (size < ASSET_PACK_HEADER_SIZE || memcmp(data, ASSET_PACK_MAGIC, 4) != 0 ||
+        version != ASSET_PACK_VERSION || slotCount < 2 || (slotCount & (slotCount - 1)) != 0 ||
+        count > slotCount || namesOffset > size || nameBytes > size - namesOffset) {
+        std::cerr << "ERROR: Invalid asset pack: " << packPath << std::endl;
+        file.Close();
+        return false;
+    }
+
+    slots = reinterpret_cast<const uint32_t*>(data + ASSET_PACK_HEADER_SIZE);
+    slotMask = slotCount - 1;
+    entries = reinterpret_cast<const AssetPackEntry*>(data + entriesOffset);
+    entryCount = count;
+    names = data + namesOffset;
+
+    // Checked once here, so lookups and reads can trust the directory
+    for (uint32_t s = 0; s < slotCount; ++s) {
+        if (slots[s] > count) entryCount = 0;
+    }
+    for (size_t i = 0; i < entryCount; ++i) {
+        const AssetPackEntry& entry = entries[i];
+        if (uint64_t(entry.nameOffset) + entry.nameLength > nameBytes || entry.offset > size ||
+            entry.storedSize > size - entry.offset || entry.compression > PACK_LZ ||
+            (entry.compression == PACK_STORED && entry.storedSize != entry.rawSize)) {
+            entryCount = 0;
+        }
+    }
+    if (entryCount != count) {
+        std::cerr << "ERROR: Corrupt asset pack directory: " << packPath << std::endl;
+        file.Close();
+        return false;
+    }
+    return true;
+}
+
+const AssetPackEntry* AssetPack::Find(const std::string& assetPath) const {
+    if (!entries) return nullptr;
+    const std::string normalized = NormalizeAssetPath(assetPath);
+    const uint64_t hash = HashPath(normalized);
+    for (uint32_t probe = 0, slot = uint32_t(hash) & slotMask; probe <= slotMask; ++probe, slot = (slot + 1) & slotMask) {
+        if (slots[slot] == 0) return nullptr;
+        const AssetPackEntry& entry = entries[slots[slot] - 1];
+        if (entry.hash == hash && entry.nameLength == normalized.size() &&
+            memcmp(names + entry.nameOffset, normalized.data(), normalized.size()) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+bool AssetPack::Read(const AssetPackEntry& entry, std::vector<char>& buffer, const char*& data) const {
+    const char* stored = file.Data() + entry.offset;
+    // An empty entry has nothing to expand, and an empty buffer's data() may
+    // be null, which AssetFile would take for a failed open
+    if (entry.compression == PACK_STORED || entry.rawSize == 0) {
+        data = stored;
+        return true;
+    }
+    buffer.resize(size_t(entry.rawSize));
+    if (!LzDecompress(stored, size_t(entry.storedSize), buffer.data(), buffer.size())) {
+        std::cerr << "ERROR: Corrupt entry in asset pack " << path << ": "
+            << std::string(names + entry.nameOffset, entry.nameLength) << std::endl;
+        return false;
+    }
+    data = buffer.data();
+    return true;
+}
+
+bool WriteAssetPack(const std::string& packPath, const std::vector<std::string>& files) {
+    struct PendingEntry {
+        std::string name;
+        std::vector<char> stored;
+        AssetPackEntry entry;
+    };
+    std::vector<PendingEntry> pending(files.size());
+    std::unordered_set<std::string> seen;
+    for (size_t i = 0; i < files.size(); ++i) {
+        pending[i].name = NormalizeAssetPath(files[i]);
+        if (!seen.insert(pending[i].name).second) {
+            std::cerr << "ERROR: Asset listed twice: " << files[i] << std::endl;
+            return false;
+        }
+    }
+
+    // Compression dominates packing time and every file is independent
+    std::vector<char> failed(files.size(), 0);
+    ThreadPool::Shared().ParallelFor(files.size(), [&](size_t i) {
+        MappedFile source;
+        if (!source.Open(files[i])) {
+            failed[i] = 1;
+            return;
+        }
+        PendingEntry& out = pending[i];
+        out.entry.hash = HashPath(out.name);
+        out.entry.rawSize = source.Size();
+        LzCompress(source.Data(), source.Size(), out.stored);
+
+        // Already-compressed formats barely shrink; keep those readable in
+        // place. Empty files always land here.
+        if (out.stored.size() + source.Size() / 8 >= source.Size()) {
+            out.stored.assign(source.Data(), source.Data() + source.Size());
+            out.entry.compression = PACK_STORED;
+        }
+        else {
+            out.entry.compression = PACK_LZ;
+        }
+        out.entry.storedSize = out.stored.size();
+    });
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (failed[i]) {
+            std::cerr << "ERROR: Failed to open file for packing: " << files[i] << std::endl;
+            return false;
+        }
+    }
+
+    // Keep the table at most half full so probes stay short
+    uint32_t slotCount = 2;
+    while (slotCount < pending.size() * 2) slotCount *= 2;
+    std::vector<uint32_t> slots(slotCount, 0);
+    std::string names;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        AssetPackEntry& entry = pending[i].entry;
+        entry.nameOffset = uint32_t(names.size());
+        entry.nameLength = uint32_t(pending[i].name.size());
+        names += pending[i].name;
+
+        uint32_t slot = uint32_t(entry.hash) & (slotCount - 1);
+        while (slots[slot] != 0) slot = (slot + 1) & (slotCount - 1);
+        slots[slot] = uint32_t(i + 1);
+    }
+
+    size_t offset = ASSET_PACK_HEADER_SIZE + slots.size() * sizeof(uint32_t) +
+        pending.size() * sizeof(AssetPackEntry) + names.size();
+    for (auto& item : pending) {
+        offset = (offset + ASSET_PACK_ALIGN - 1) / ASSET_PACK_ALIGN * ASSET_PACK_ALIGN;
+        item.entry.offset = offset;
+        offset += item.stored.size();
+    }
+
+    // Written next to the final name and renamed, like the mesh cache
+    std::string tempPath = packPath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "ERROR: Failed to create asset pack: " << packPath << std::endl;
+            return false;
+        }
+        uint32_t header[4] = { 0, ASSET_PACK_VERSION, uint32_t(pending.size()), slotCount };
+        memcpy(header, ASSET_PACK_MAGIC, 4);
+        uint64_t sizes[2] = { names.size(), 0 };
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+        out.write(reinterpret_cast<const char*>(slots.data()), std::streamsize(slots.size() * sizeof(uint32_t)));
+        for (const auto& item : pending) {
+            out.write(reinterpret_cast<const char*>(&item.entry), sizeof(AssetPackEntry));
+        }
+        out.write(names.data(), std::streamsize(names.size()));
+
+        static const char zeros[ASSET_PACK_ALIGN] = {};
+        size_t written = size_t(out.tellp());
+        for (const auto& item : pending) {
+            out.write(zeros, std::streamsize(item.entry.offset - written));
+            out.write(item.stored.data(), std::streamsize(item.stored.size()));
+            written = size_t(item.entry.offset + item.stored.size());
+        }
+        if (!out) {
+            std::cerr << "ERROR: Failed to write asset pack: " << packPath << std::endl;
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempPath, packPath, ec);
+    if (ec) {
+        std::remove(tempPath.c_str());
+        std::cerr << "ERROR: Failed to replace asset pack: " << packPath << std::endl;
+        return false;
+    }
+
+    size_t rawBytes = 0, storedBytes = 0;
+    for (const auto& item : pending) {
+        rawBytes += size_t(item.entry.rawSize);
+        storedBytes += item.stored.size();
+    }
+    std::cout << "Packed " << pending.size() << " files into " << packPath << " ("
+        << rawBytes / 1024 << " KB -> " << storedBytes / 1024 << " KB)\n";
+    return true;
+}
+
+// ---- Mounted packs ----
+
+static std::mutex mountMutex;
+static std::vector<std::shared_ptr<const AssetPack>> mountedPacks;
+
+static std::vector<std::shared_ptr<const AssetPack>> MountedPacks() {
+    std::lock_guard<std::mutex> lock(mountMutex);
+    return mountedPacks;
+}
+
+bool MountAssetPack(const std::string& path) {
+    auto pack = std::make_shared<AssetPack>();
+    if (!pack->Open(path)) return false;
+    std::cout << "Mounted asset pack: " << path << " (" << pack->EntryCount() << " files)\n";
+
+    std::lock_guard<std::mutex> lock(mountMutex);
+    mountedPacks.push_back(std::move(pack));
+    return true;
+}
+
+void UnmountAssetPacks() {
+    std::lock_guard<std::mutex> lock(mountMutex);
+    mountedPacks.clear();
+}
+
+bool StatAsset(const std::string& path, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    auto packs = MountedPacks();
+    for (auto pack = packs.rbegin(); pack != packs.rend(); ++pack) {
+        const AssetPackEntry* entry = (*pack)->Find(path);
+        if (!entry) continue;
+        auto packTime = std::filesystem::last_write_time((*pack)->Path(), ec);
+        if (ec) return false;
+        size = entry->rawSize;
+        mtime = int64_t(packTime.time_since_epoch().count());
+        return true;
+    }
+
+    auto fileSize = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    auto fileTime = std::filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    size = uint64_t(fileSize);
+    mtime = int64_t(fileTime.time_since_epoch().count());
+    return true;
+}
+
+// ---- AssetFile ----
+
+bool AssetFile::Open(const std::string& path) {
+    Close();
+    auto packs = MountedPacks();
+    for (auto pack = packs.rbegin(); pack != packs.rend(); ++pack) {
+        const AssetPackEntry* entry = (*pack)->Find(path);
+        if (entry && (*pack)->Read(*entry, unpacked, data)) {
+            this->pack = *pack;
+            size = size_t(entry->rawSize);
+            return true;
+        }
+    }
+
+    if (!loose.Open(path)) return false;
+    data = loose.Data();
+    size = loose.Size();
+    return true;
+}
+
+void AssetFile::Close() {
+    pack.reset();
+    std::vector<char>().swap(unpacked);
+    loose.Close();
+    data = nullptr;
+    size = 0;
+}
+
+bool OpenAssetFiles(const std::vector<std::string>& paths, AssetFile* files) {
+    std::vector<char> opened(paths.size(), 0);
+    ThreadPool::Shared().ParallelFor(paths.size(), [&](size_t i) {
+        opened[i] = files[i].Open(paths[i]) ? 1 : 0;
+    });
+    return std::all_of(opened.begin(), opened.end(), [](char ok) { return ok != 0; });
+}
@@ -0,0 +1,94 @@
+// AssetPack.h
+#pragma once
+#include "MappedFile.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Single-file archive (.gpak) of the engine's assets. The directory sits at
+// the front of the file, so a mounted pack costs one open and one mapping;
+// each entry is then a hash probe and a slice of the mapping. Entries that
+// compress well are stored LZ-compressed (see LzCodec.h), the rest (JPEG, PNG)
+// are stored as-is and read without a copy.
+const uint32_t ASSET_PACK_VERSION = 1;
+
+struct AssetPackEntry {
+    uint64_t hash = 0;          // of the normalized path
+    uint64_t offset = 0;        // of the stored bytes, from the start of the pack
+    uint64_t storedSize = 0;
+    uint64_t rawSize = 0;
+    uint32_t nameOffset = 0;    // into the name block
+    uint32_t nameLength = 0;
+    uint32_t compression = 0;   // 0 = stored, 1 = LZ
+    uint32_t reserved = 0;
+};
+
+class AssetPack {
+public:
+    bool Open(const std::string& path);
+
+    const std::string& Path() const { return path; }
+    size_t EntryCount() const { return entryCount; }
+
+    // nullptr if the pack has no entry for path.
+    const AssetPackEntry* Find(const std::string& path) const;
+
+    // Stored entries point straight into the mapping; compressed ones are
+    // expanded into 'buffer', which then backs 'data'.
+    bool Read(const AssetPackEntry& entry, std::vector<char>& buffer, const char*& data) const;
+
+private:
+    MappedFile file;
+    std::string path;
+    const uint32_t* slots = nullptr;            // entry index + 1, 0 = empty
+    uint32_t slotMask = 0;
+    const AssetPackEntry* entries = nullptr;
+    size_t entryCount = 0;
+    const char* names = nullptr;
+};
+
+// Asset paths are looked up case-insensitively with single '/' separators and
+// no leading "./", the way Windows resolves the same relative path.
+std::string NormalizeAssetPath(const std::string& path);
+
+// Packs the given files under their normalized paths.
+bool WriteAssetPack(const std::string& packPath, const std::vector<std::string>& files);
+
+// Makes a pack's entries visible to AssetFile. Later mounts win over earlier
+// ones. Mount before starting loads; a missing pack just returns false.
+bool MountAssetPack(const std::string& path);
+void UnmountAssetPacks();
+
+// Size and timestamp of an asset for cache invalidation. Packed assets carry
+// the pack's timestamp, since repacking is what changes them.
+bool StatAsset(const std::string& path, uint64_t& size, int64_t& mtime);
+
+// The bytes of one asset: an entry of a mounted pack if there is one,
+// otherwise the loose file, mapped.
+class AssetFile {
+public:
+    AssetFile() = default;
+    AssetFile(const AssetFile&) = delete;
+    AssetFile& operator=(const AssetFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+    bool IsOpen() const { return data != nullptr; }
+    bool FromPack() const { return pack != nullptr; }
+
+private:
+    std::shared_ptr<const AssetPack> pack;   // keeps the mapping alive
+    std::vector<char> unpacked;
+    MappedFile loose;
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+// Opens files[i] for paths[i] across the shared thread pool, so compressed
+// entries are expanded in parallel. 'files' must hold paths.size() entries.
+// Returns false if any of them failed to open.
+bool OpenAssetFiles(const std::vector<std::string>& paths, AssetFile* files);
@@ -0,0 +1,384 @@
+// BlockCompression.cpp
+#include "BlockCompression.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// From EXT_texture_compression_s3tc, which glad was generated without
+static const GLenum COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+static const GLenum COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+
+static std::atomic<bool> s3tcSupported{ false };
+
+BlockFormat BlockFormatFor(int components) {
+    switch (components) {
+    case 1: return BlockFormat::BC4;
+    case 2: return BlockFormat::BC5;
+    case 3: return BlockFormat::BC1;
+    case 4: return BlockFormat::BC3;
+    default: return BlockFormat::None;
+    }
+}
+
+size_t BlockBytes(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1:
+    case BlockFormat::BC4: return 8;
+    case BlockFormat::BC3:
+    case BlockFormat::BC5: return 16;
+    default: return 0;
+    }
+}
+
+size_t BlockLevelBytes(BlockFormat format, int width, int height) {
+    return size_t((width + 3) / 4) * size_t((height + 3) / 4) * BlockBytes(format);
+}
+
+GLenum BlockFormatGL(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: return COMPRESSED_RGB_S3TC_DXT1;
+    case BlockFormat::BC3: return COMPRESSED_RGBA_S3TC_DXT5;
+    case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    default: return 0;
+    }
+}
+
+void DetectBlockFormats() {
+    static bool detected = false;
+    if (detected) return;
+    detected = true;
+
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+        if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) {
+            s3tcSupported = true;
+        }
+    }
+}
+
+bool BlockFormatSupported(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1:
+    case BlockFormat::BC3: return s3tcSupported;
+    case BlockFormat::BC4:
+    case BlockFormat::BC5: return true;
+    default: return false;
+    }
+}
+
+// ---- BC1 color blocks ----
+// The loops run over the block's 16 texels in plain float arrays, which
+// compilers vectorize; there are no intrinsics to keep per platform.
+
+static uint16_t Pack565(const float color[3]) {
+    int r = std::clamp(int(color[0] * (31.0f / 255.0f) + 0.5f), 0, 31);
+    int g = std::clamp(int(color[1] * (63.0f / 255.0f) + 0.5f), 0, 63);
+    int b = std::clamp(int(color[2] * (31.0f / 255.0f) + 0.5f), 0, 31);
+    return uint16_t(r << 11 | g << 5 | b);
+}
+
+static void Unpack565(uint16_t packed, float color[3]) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = float(r << 3 | r >> 2);
+    color[1] = float(g << 2 | g >> 4);
+    color[2] = float(b << 3 | b >> 2);
+}
+
+// Index bits for the nearest of the four colors c0 > c1 decode to; returns
+// the squared error. Equal endpoints select the three-color mode, where only
+// index 0 is safe, which ties resolving to the first entry guarantee.
+static float ColorIndices(const float texels[16][3], uint16_t c0, uint16_t c1, uint32_t& indices) {
+    float palette[4][3];
+    Unpack565(c0, palette[0]);
+    Unpack565(c1, palette[1]);
+    for (int k = 0; k < 3; ++k) {
+        palette[2][k] = (2.0f * palette[0][k] + palette[1][k]) / 3.0f;
+        palette[3][k] = (palette[0][k] + 2.0f * palette[1][k]) / 3.0f;
+    }
+
+    indices = 0;
+    float error = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0;
+        float bestDistance = FLT_MAX;
+        for (int p = 0; p < 4; ++p) {
+            float dr = texels[i][0] - palette[p][0];
+            float dg = texels[i][1] - palette[p][1];
+            float db = texels[i][2] - palette[p][2];
+            float distance = dr * dr + dg * dg + db * db;
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = p;
+            }
+        }
+        indices |= uint32_t(best) << (2 * i);
+        error += bestDistance;
+    }
+    return error;
+}
+
+static void OrderEndpoints(uint16_t& c0, uint16_t& c1) {
+    if (c0 < c1) std::swap(c0, c1);
+}
+
+static void EncodeColorBlock(const float texels[16][3], TextureCompression quality, unsigned char* out) {
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    float low[3] = { 255.0f, 255.0f, 255.0f };
+    float high[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            mean[k] += texels[i][k];
+            low[k] = std::min(low[k], texels[i][k]);
+            high[k] = std::max(high[k], texels[i][k]);
+        }
+    }
+    for (int k = 0; k < 3; ++k) mean[k] /= 16.0f;
+
+    float covariance[3][3] = {};
+    for (int i = 0; i < 16; ++i) {
+        float d[3] = { texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2] };
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < 3; ++b) covariance[a][b] += d[a] * d[b];
+        }
+    }
+
+    // The box diagonal, turned to follow how the other channels vary with the
+    // widest one
+    float axis[3] = { high[0] - low[0], high[1] - low[1], high[2] - low[2] };
+    int widest = int(std::max_element(axis, axis + 3) - axis);
+    for (int k = 0; k < 3; ++k) {
+        if (covariance[widest][k] < 0.0f) axis[k] = -axis[k];
+    }
+    if (quality == TextureCompression::High) {
+        // Power iteration toward the principal axis
+        for (int step = 0; step < 4; ++step) {
+            float next[3];
+            for (int a = 0; a < 3; ++a) {
+                next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+            }
+            float scale = std::max({ std::abs(next[0]), std::abs(next[1]), std::abs(next[2]) });
+            if (scale < 1e-6f) break;
+            for (int a = 0; a < 3; ++a) axis[a] = next[a] / scale;
+        }
+    }
+
+    float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float tMin = 0.0f, tMax = 0.0f;
+    if (length > 1e-6f) {
+        for (int k = 0; k < 3; ++k) axis[k] /= length;
+        tMin = FLT_MAX;
+        tMax = -FLT_MAX;
+        for (int i = 0; i < 16; ++i) {
+            float t = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] +
+                (texels[i][2] - mean[2]) * axis[2];
+            tMin = std::min(tMin, t);
+            tMax = std::max(tMax, t);
+        }
+        if (quality == TextureCompression::Fast) {
+            // Inset, since the extremes are rarely worth a palette entry each
+            float inset = (tMax - tMin) / 16.0f;
+            tMin += inset;
+            tMax -= inset;
+        }
+    }
+    float end0[3], end1[3];
+    for (int k = 0; k < 3; ++k) {
+        end0[k] = mean[k] + axis[k] * tMax;
+        end1[k] = mean[k] + axis[k] * tMin;
+    }
+    uint16_t c0 = Pack565(end0);
+    uint16_t c1 = Pack565(end1);
+    OrderEndpoints(c0, c1);
+    uint32_t indices;
+    float error = ColorIndices(texels, c0, c1, indices);
+
+    if (quality == TextureCompression::High) {
+        // Least squares endpoints for the chosen indices, kept while they help
+        static const float WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        for (int step = 0; step < 2 && error > 0.0f; ++step) {
+            float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+            float ax[3] = {}, bx[3] = {};
+            for (int i = 0; i < 16; ++i) {
+                float w = WEIGHTS[(indices >> (2 * i)) & 3];
+                aa += (1.0f - w) * (1.0f - w);
+                ab += (1.0f - w) * w;
+                bb += w * w;
+                for (int k = 0; k < 3; ++k) {
+                    ax[k] += (1.0f - w) * texels[i][k];
+                    bx[k] += w * texels[i][k];
+                }
+            }
+            float determinant = aa * bb - ab * ab;
+            if (std::abs(determinant) < 1e-6f) break;
+            for (int k = 0; k < 3; ++k) {
+                end0[k] = (bb * ax[k] - ab * bx[k]) / determinant;
+                end1[k] = (aa * bx[k] - ab * ax[k]) / determinant;
+            }
+            uint16_t r0 = Pack565(end0);
+            uint16_t r1 = Pack565(end1);
+            OrderEndpoints(r0, r1);
+            uint32_t refined;
+            float refinedError = ColorIndices(texels, r0, r1, refined);
+            if (refinedError >= error) break;
+            c0 = r0;
+            c1 = r1;
+            indices = refined;
+            error = refinedError;
+        }
+    }
+
+    out[0] = uint8_t(c0);
+    out[1] = uint8_t(c0 >> 8);
+    out[2] = uint8_t(c1);
+    out[3] = uint8_t(c1 >> 8);
+    for (int i = 0; i < 4; ++i) out[4 + i] = uint8_t(indices >> (8 * i));
+}
+
+// ---- BC4 channel blocks (BC3 alpha, BC5 per channel) ----
+
+static int ChannelIndices(const unsigned char values[16], const int palette[8], uint64_t& indices) {
+    indices = 0;
+    int error = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0;
+        int bestDistance = 256 * 256;
+        for (int p = 0; p < 8; ++p) {
+            int d = int(values[i]) - palette[p];
+            if (d * d < bestDistance) {
+                bestDistance = d * d;
+                best = p;
+            }
+        }
+        indices |= uint64_t(best) << (3 * i);
+        error += bestDistance;
+    }
+    return error;
+}
+
+static void EncodeChannelBlock(const unsigned char values[16], TextureCompression quality, unsigned char* out) {
+    int low = 255, high = 0;
+    int innerLow = 255, innerHigh = 0;     // ignoring 0 and 255, which the six-value mode has exactly
+    for (int i = 0; i < 16; ++i) {
+        low = std::min(low, int(values[i]));
+        high = std::max(high, int(values[i]));
+        if (values[i] != 0 && values[i] != 255) {
+            innerLow = std::min(innerLow, int(values[i]));
+            innerHigh = std::max(innerHigh, int(values[i]));
+        }
+    }
+
+    // Eight values: a0 > a1 and six steps between
+    int a0 = high, a1 = low;
+    int palette[8] = { a0, a1 };
+    for (int i = 2; i < 8; ++i) palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+    uint64_t indices;
+    int error = ChannelIndices(values, palette, indices);
+
+    if (quality == TextureCompression::High && innerLow <= innerHigh && error > 0) {
+        // Six values: a0 <= a1, four steps between, then 0 and 255
+        int b0 = innerLow, b1 = innerHigh;
+        int six[8] = { b0, b1, 0, 0, 0, 0, 0, 255 };
+        for (int i = 2; i < 6; ++i) six[i] = ((6 - i) * b0 + (i - 1) * b1 + 2) / 5;
+        uint64_t sixIndices;
+        int sixError = ChannelIndices(values, six, sixIndices);
+        if (sixError < error) {
+            a0 = b0;
+            a1 = b1;
+            indices = sixIndices;
+        }
+    }
+
+    out[0] = uint8_t(a0);
+    out[1] = uint8_t(a1);
+    for (int i = 0; i < 6; ++i) out[2 + i] = uint8_t(indices >> (8 * i));
+}
+
+// ---- Levels ----
+
+static void EncodeLevel(const ImageLevel& level, int components, BlockFormat format, TextureCompression quality,
+    unsigned char* out) {
+    const int blocksX = (level.width + 3) / 4;
+    const int blocksY = (level.height + 3) / 4;
+    const size_t blockBytes = BlockBytes(format);
+    ThreadPool::Shared().ParallelFor(size_t(blocksY), [&](size_t by) {
+        float colors[16][3];
+        unsigned char channels[2][16];
+        for (int bx = 0; bx < blocksX; ++bx) {
+            // Partial blocks at the right and bottom edges repeat the last texel
+            for (int i = 0; i < 16; ++i) {
+                int x = std::min(bx * 4 + i % 4, level.width - 1);
+                int y = std::min(int(by) * 4 + i / 4, level.height - 1);
+                const unsigned char* texel = level.pixels + (size_t(y) * level.width + x) * components;
+                if (components >= 3) {
+                    for (int k = 0; k < 3; ++k) colors[i][k] = float(texel[k]);
+                    channels[0][i] = components == 4 ? texel[3] : 255;
+                }
+                else {
+                    channels[0][i] = texel[0];
+                    channels[1][i] = components == 2 ? texel[1] : 0;
+                }
+            }
+
+            unsigned char* block = out + (by * blocksX + bx) * blockBytes;
+            switch (format) {
+            case BlockFormat::BC1:
+                EncodeColorBlock(colors, quality, block);
+                break;
+            case BlockFormat::BC3:
+                EncodeChannelBlock(channels[0], quality, block);
+                EncodeColorBlock(colors, quality, block + 8);
+                break;
+            case BlockFormat::BC4:
+                EncodeChannelBlock(channels[0], quality, block);
+                break;
+            case BlockFormat::BC5:
+                EncodeChannelBlock(channels[0], quality, block);
+                EncodeChannelBlock(channels[1], quality, block + 8);
+                break;
+            default:
+                break;
+            }
+        }
+    });
+}
+
+bool CompressMipChain(DecodedImage& image, TextureCompression quality) {
+    BlockFormat format = BlockFormatFor(image.components);
+    if (quality == TextureCompression::None || image.levels.empty() ||
+        image.blockFormat != BlockFormat::None || !BlockFormatSupported(format)) {
+        return false;
+    }
+
+    std::vector<ImageLevel> levels(image.levels.size());
+    std::vector<size_t> offsets;
+    size_t total = 0;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        levels[i].width = image.levels[i].width;
+        levels[i].height = image.levels[i].height;
+        levels[i].size = BlockLevelBytes(format, levels[i].width, levels[i].height);
+        offsets.push_back(total);
+        total += levels[i].size;
+    }
+    std::vector<unsigned char> storage(total);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        levels[i].pixels = storage.data() + offsets[i];
+        EncodeLevel(image.levels[i], image.components, format, quality, storage.data() + offsets[i]);
+    }
+
+    // The source levels may live in either; neither is needed now
+    image.levels.swap(levels);
+    image.levelStorage.swap(storage);
+    image.levelFile.Close();
+    image.blockFormat = format;
+    return true;
+}
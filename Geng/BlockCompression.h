@@ -0,0 +1,35 @@
+// BlockCompression.h
+#pragma once
+#include "ImageDecoder.h"
+#include <glad/glad.h>
+#include <cstddef>
+
+// CPU encoders for the block formats GL 3.3 can sample: BC1 (DXT1) for RGB,
+// BC3 (DXT5) for RGBA, and BC4/BC5 (RGTC) for one and two channel images.
+// A compressed chain takes a quarter (BC3/BC5) to an eighth (BC1/BC4 against
+// RGBA) of the memory and sampling bandwidth. BC6H/BC7 and ETC2 need newer
+// GL than this renderer targets and are not offered.
+
+enum class TextureCompression {
+    None,
+    Fast,       // bounding box endpoints
+    High,       // principal axis endpoints refined by least squares, both alpha modes tried
+};
+
+// The format an image with 'components' channels compresses to.
+BlockFormat BlockFormatFor(int components);
+size_t BlockBytes(BlockFormat format);
+// Bytes of one level; 4x4 blocks, so partial blocks round up.
+size_t BlockLevelBytes(BlockFormat format, int width, int height);
+GLenum BlockFormatGL(BlockFormat format);
+
+// Reads the driver's extensions once. Call on the GL thread before loader
+// threads ask BlockFormatSupported; until then only the RGTC formats, which
+// are core since GL 3.0, count as supported.
+void DetectBlockFormats();
+bool BlockFormatSupported(BlockFormat format);
+
+// Encodes every level of image.levels, across ThreadPool::Shared(), and
+// replaces them with the blocks. False, leaving the image as it was, when
+// there is no chain or its format is not supported.
+bool CompressMipChain(DecodedImage& image, TextureCompression quality);
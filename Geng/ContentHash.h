@@ -0,0 +1,23 @@
+// ContentHash.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+const uint64_t CONTENT_HASH_SEED = 0xCBF29CE484222325ull;
+
+// Fast 64-bit hash over raw bytes. Not cryptographic; only has to tell edited
+// data from the data it replaces. Chain calls by passing the previous result.
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = CONTENT_HASH_SEED) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    for (; size > 0; ++p, --size) {
+        hash = (hash ^ *p) * 0x100000001B3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,263 @@
+// FileWatcher.cpp
+#include "FileWatcher.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <algorithm>
+#include <cctype>
+#endif
+
+static bool StampPath(const std::string& path, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    auto fileSize = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    auto fileTime = std::filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    size = uint64_t(fileSize);
+    mtime = int64_t(fileTime.time_since_epoch().count());
+    return true;
+}
+
+#ifdef _WIN32
+
+// One directory handle with a ReadDirectoryChangesW call kept outstanding on it
+struct FileWatcher::WatchedDirectory {
+    std::string prefix;
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    OVERLAPPED overlapped = {};
+    bool reading = false;
+    DWORD buffer[4096];     // FILE_NOTIFY_INFORMATION records are DWORD aligned
+    // Lower-cased file name -> registered paths, since Windows names are case-insensitive
+    std::unordered_map<std::string, std::vector<std::string>> names;
+
+    ~WatchedDirectory() {
+        if (reading) {
+            DWORD bytes = 0;
+            CancelIoEx(handle, &overlapped);
+            GetOverlappedResult(handle, &overlapped, &bytes, TRUE);
+        }
+        if (handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+        if (overlapped.hEvent) CloseHandle(overlapped.hEvent);
+    }
+};
+
+static std::string LowerCase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+        [](unsigned char c) { return char(std::tolower(c)); });
+    return text;
+}
+
+#endif
+
+FileWatcher::~FileWatcher() {
+    stopping = true;
+    if (thread.joinable()) thread.join();
+#ifdef __linux__
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+}
+
+void FileWatcher::Watch(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& path : paths) {
+        if (path.empty() || files.count(path)) continue;
+        Stamp& stamp = files[path];
+        StampPath(path, stamp.size, stamp.mtime);
+
+#ifdef __linux__
+        if (inotifyFd < 0) inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        std::string prefix = path.substr(0, path.find_last_of('/') + 1);
+        if (inotifyFd >= 0 && watchedDirs.insert(prefix).second) {
+            // Whole directories, so a rename over the file is seen as well
+            int wd = inotify_add_watch(inotifyFd, prefix.empty() ? "." : prefix.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (wd >= 0) {
+                watchDirs[wd].push_back(prefix);
+            }
+            else {
+                std::cerr << "ERROR: Failed to watch directory for changes: " << prefix << std::endl;
+            }
+        }
+#elif defined(_WIN32)
+        size_t slash = path.find_last_of("/\\");
+        std::string prefix = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+        auto found = directoriesByPrefix.find(prefix);
+        if (found == directoriesByPrefix.end()) {
+            auto directory = std::make_unique<WatchedDirectory>();
+            directory->prefix = prefix;
+            directory->handle = CreateFileA(prefix.empty() ? "." : prefix.c_str(), FILE_LIST_DIRECTORY,
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+            directory->overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+            if (directory->handle == INVALID_HANDLE_VALUE || !directory->overlapped.hEvent) {
+                std::cerr << "ERROR: Failed to watch directory for changes: " << prefix << std::endl;
+                directory.reset();
+            }
+            found = directoriesByPrefix.emplace(prefix, directory.get()).first;
+            if (directory) watchedDirectories.push_back(std::move(directory));
+        }
+        if (found->second) {
+            found->second->names[LowerCase(path.substr(prefix.size()))].push_back(path);
+        }
+#endif
+    }
+    if (!thread.joinable() && !files.empty()) {
+        thread = std::thread(&FileWatcher::Run, this);
+    }
+}
+
+std::vector<std::string> FileWatcher::TakeChanges() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> taken;
+    taken.swap(changes);
+    changeSet.clear();
+    return taken;
+}
+
+// Called with the mutex held.
+void FileWatcher::Report(const std::string& path) {
+    if (changeSet.insert(path).second) changes.push_back(path);
+}
+
+#ifdef __linux__
+
+void FileWatcher::Run() {
+    alignas(inotify_event) char buffer[4096];
+    while (!stopping) {
+        pollfd waiting = { inotifyFd, POLLIN, 0 };
+        if (inotifyFd < 0 || poll(&waiting, 1, POLL_INTERVAL_MS) <= 0) continue;
+
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        std::lock_guard<std::mutex> lock(mutex);
+        for (ssize_t offset = 0; offset < length; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += ssize_t(sizeof(inotify_event) + event->len);
+            if (event->len == 0) continue;
+
+            auto dir = watchDirs.find(event->wd);
+            if (dir == watchDirs.end()) continue;
+            for (const auto& prefix : dir->second) {
+                std::string path = prefix + event->name;
+                if (files.count(path)) Report(path);
+            }
+        }
+    }
+}
+
+#elif defined(_WIN32)
+
+void FileWatcher::Run() {
+    std::vector<HANDLE> events;
+    std::vector<WatchedDirectory*> waiting;
+    while (!stopping) {
+        events.clear();
+        waiting.clear();
+        {
+            // Directories added by Watch since the last pass start reading here
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& directory : watchedDirectories) {
+                if (!directory->reading) {
+                    ResetEvent(directory->overlapped.hEvent);
+                    directory->reading = ReadDirectoryChangesW(directory->handle, directory->buffer,
+                        sizeof(directory->buffer), FALSE,
+                        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+                        nullptr, &directory->overlapped, nullptr) != FALSE;
+                }
+                if (directory->reading && events.size() < MAXIMUM_WAIT_OBJECTS) {
+                    events.push_back(directory->overlapped.hEvent);
+                    waiting.push_back(directory.get());
+                }
+            }
+        }
+        if (events.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+            continue;
+        }
+
+        DWORD woken = WaitForMultipleObjects(DWORD(events.size()), events.data(), FALSE, POLL_INTERVAL_MS);
+        if (woken >= WAIT_OBJECT_0 + events.size()) continue;
+
+        // More than one directory may have finished; collect them all
+        std::lock_guard<std::mutex> lock(mutex);
+        for (WatchedDirectory* directory : waiting) {
+            DWORD bytes = 0;
+            if (!GetOverlappedResult(directory->handle, &directory->overlapped, &bytes, FALSE) &&
+                GetLastError() == ERROR_IO_INCOMPLETE) {
+                continue;
+            }
+            directory->reading = false;
+            ReportRecords(*directory, bytes);
+        }
+    }
+}
+
+// Called with the mutex held. Reports the registered files a finished read
+// names whose stamp moved, as the polling backend would. Zero bytes means the
+// buffer overflowed and the names were lost, so every file in the directory
+// is compared instead.
+void FileWatcher::ReportRecords(WatchedDirectory& directory, unsigned long bytes) {
+    auto reportIfChanged = [this](const std::vector<std::string>& paths) {
+        for (const auto& path : paths) {
+            Stamp current;
+            Stamp& last = files[path];
+            if (!StampPath(path, current.size, current.mtime)) continue;   // mid-save
+            if (current.size != last.size || current.mtime != last.mtime) {
+                last = current;
+                Report(path);
+            }
+        }
+    };
+
+    if (bytes == 0) {
+        for (const auto& name : directory.names) reportIfChanged(name.second);
+        return;
+    }
+
+    const char* record = reinterpret_cast<const char*>(directory.buffer);
+    for (;;) {
+        const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(record);
+        if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED ||
+            info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+            // Registered paths are narrow strings opened through the ANSI APIs
+            int wideLength = int(info->FileNameLength / sizeof(WCHAR));
+            int length = WideCharToMultiByte(CP_ACP, 0, info->FileName, wideLength, nullptr, 0, nullptr, nullptr);
+            std::string name(size_t(std::max(length, 0)), '\0');
+            if (length > 0) {
+                WideCharToMultiByte(CP_ACP, 0, info->FileName, wideLength, &name[0], length, nullptr, nullptr);
+            }
+
+            auto found = directory.names.find(LowerCase(name));
+            if (found != directory.names.end()) reportIfChanged(found->second);
+        }
+        if (info->NextEntryOffset == 0) break;
+        record += info->NextEntryOffset;
+    }
+}
+
+#else
+
+void FileWatcher::Run() {
+    while (!stopping) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& file : files) {
+            Stamp current;
+            if (!StampPath(file.first, current.size, current.mtime)) continue;   // mid-save
+            if (current.size != file.second.size || current.mtime != file.second.mtime) {
+                file.second = current;
+                Report(file.first);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,60 @@
+// FileWatcher.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Reports files that were rewritten since they were registered. The parent
+// directories are watched with inotify on Linux and ReadDirectoryChangesW on
+// Windows, which also catches editors that save by writing a new file and
+// renaming it over the old one. Other platforms compare size and timestamp
+// every POLL_INTERVAL_MS instead.
+class FileWatcher {
+public:
+    static const unsigned POLL_INTERVAL_MS = 250;
+
+    FileWatcher() = default;
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Paths already being watched are skipped, so this is cheap to repeat.
+    void Watch(const std::vector<std::string>& paths);
+
+    // Registered paths (as passed to Watch) changed since the last call,
+    // each listed once however many times it was written.
+    std::vector<std::string> TakeChanges();
+
+private:
+    struct Stamp {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    void Run();
+    void Report(const std::string& path);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Stamp> files;   // registered path -> stamp at the last poll
+    std::vector<std::string> changes;
+    std::unordered_set<std::string> changeSet;
+    std::thread thread;
+    std::atomic<bool> stopping{ false };
+#ifdef __linux__
+    int inotifyFd = -1;
+    std::unordered_map<int, std::vector<std::string>> watchDirs;   // watch descriptor -> directory prefixes
+    std::unordered_set<std::string> watchedDirs;
+#elif defined(_WIN32)
+    struct WatchedDirectory;
+    std::vector<std::unique_ptr<WatchedDirectory>> watchedDirectories;
+    std::unordered_map<std::string, WatchedDirectory*> directoriesByPrefix;
+    void ReportRecords(WatchedDirectory& directory, unsigned long bytes);
+#endif
+};
@@ -0,0 +1,550 @@
+// GltfLoader.cpp
+#include "GltfLoader.h"
+#include "AssetPack.h"
+#include "LoadReport.h"
+#include <json/json.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+static_assert(sizeof(Vertex) == 32, "the direct copy path expects Vertex to be three tightly packed attributes");
+
+// File layout (little endian): "glTF" version(u32) length(u32), then chunks of
+// length(u32) type(u32) data, each padded to 4 bytes. The JSON chunk comes
+// first and the optional BIN chunk second.
+static const uint32_t GLB_MAGIC = 0x46546C67;        // "glTF"
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;   // "JSON"
+static const uint32_t GLB_CHUNK_BIN = 0x004E4942;    // "BIN\0"
+static const char GLB_IMAGE_TAG[] = "#image";
+
+// Accessor component types
+enum : int {
+    GLTF_BYTE = 5120,
+    GLTF_UNSIGNED_BYTE = 5121,
+    GLTF_SHORT = 5122,
+    GLTF_UNSIGNED_SHORT = 5123,
+    GLTF_UNSIGNED_INT = 5125,
+    GLTF_FLOAT = 5126,
+};
+static const int GLTF_TRIANGLES = 4;
+
+struct GlbFile {
+    AssetFile file;
+    double openMs = 0.0;
+    json doc;
+    const unsigned char* bin = nullptr;
+    size_t binSize = 0;
+};
+
+static uint32_t ReadU32(const char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static bool OpenGlb(const std::string& path, GlbFile& glb) {
+    LoadTimer timer;
+    if (!glb.file.Open(path)) {
+        std::cerr << "ERROR: Failed to open glTF file: " << path << std::endl;
+        return false;
+    }
+    glb.openMs = timer.Lap();
+    const char* data = glb.file.Data();
+    const size_t size = glb.file.Size();
+    if (size < 20 || ReadU32(data) != GLB_MAGIC || ReadU32(data + 4) != 2) {
+        std::cerr << "ERROR: Not a glTF 2.0 binary file: " << path << std::endl;
+        return false;
+    }
+
+    size_t offset = 12;
+    const char* jsonBegin = nullptr;
+    size_t jsonSize = 0;
+    while (offset + 8 <= size) {
+        size_t chunkSize = ReadU32(data + offset);
+        uint32_t chunkType = ReadU32(data + offset + 4);
+        offset += 8;
+        if (chunkSize > size - offset) break;
+        if (chunkType == GLB_CHUNK_JSON && !jsonBegin) {
+            jsonBegin = data + offset;
+            jsonSize = chunkSize;
+        }
+        else if (chunkType == GLB_CHUNK_BIN && !glb.bin) {
+            glb.bin = reinterpret_cast<const unsigned char*>(data + offset);
+            glb.binSize = chunkSize;
+        }
+        offset += (chunkSize + 3) & ~size_t(3);
+    }
+    if (!jsonBegin) {
+        std::cerr << "ERROR: glTF file has no JSON chunk: " << path << std::endl;
+        return false;
+    }
+
+    glb.doc = json::parse(jsonBegin, jsonBegin + jsonSize, nullptr, false);
+    if (glb.doc.is_discarded() || !glb.doc.is_object()) {
+        std::cerr << "ERROR: Malformed glTF JSON in: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Returns the element array at doc[key][index], or nullptr when absent.
+static const json* Element(const json& doc, const char* key, int index) {
+    auto it = doc.find(key);
+    if (it == doc.end() || !it->is_array() || index < 0 || size_t(index) >= it->size()) return nullptr;
+    return &(*it)[size_t(index)];
+}
+
+// Bytes [offset, offset + length) of a buffer view inside the BIN chunk.
+static bool ResolveBufferView(const GlbFile& glb, int index, const unsigned char*& data, size_t& length, size_t& stride) {
+    const json* view = Element(glb.doc, "bufferViews", index);
+    if (!view) return false;
+
+    // Only the GLB-stored buffer 0 is mapped; a uri buffer would be a separate .bin
+    const json* buffer = Element(glb.doc, "buffers", view->value("buffer", 0));
+    if (!buffer || buffer->contains("uri") || !glb.bin) return false;
+
+    size_t offset = view->value("byteOffset", size_t(0));
+    length = view->value("byteLength", size_t(0));
+    stride = view->value("byteStride", size_t(0));
+    if (offset > glb.binSize || length > glb.binSize - offset) return false;
+    data = glb.bin + offset;
+    return true;
+}
+
+static size_t ComponentSize(int componentType) {
+    switch (componentType) {
+    case GLTF_BYTE: case GLTF_UNSIGNED_BYTE: return 1;
+    case GLTF_SHORT: case GLTF_UNSIGNED_SHORT: return 2;
+    case GLTF_UNSIGNED_INT: case GLTF_FLOAT: return 4;
+    default: return 0;
+    }
+}
+
+static int ComponentCount(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0;
+}
+
+struct GlbAccessor {
+    const unsigned char* data = nullptr;   // first element, inside the mapping
+    size_t count = 0;
+    size_t stride = 0;
+    int componentType = 0;
+    int components = 0;
+    bool normalized = false;
+};
+
+static bool ResolveAccessor(const GlbFile& glb, int index, GlbAccessor& out) {
+    const json* accessor = Element(glb.doc, "accessors", index);
+    if (!accessor || accessor->contains("sparse") || !accessor->contains("bufferView")) return false;
+
+    const unsigned char* viewData;
+    size_t viewLength, viewStride;
+    if (!ResolveBufferView(glb, accessor->value("bufferView", -1), viewData, viewLength, viewStride)) return false;
+
+    out.componentType = accessor->value("componentType", 0);
+    out.components = ComponentCount(accessor->value("type", std::string()));
+    out.count = accessor->value("count", size_t(0));
+    out.normalized = accessor->value("normalized", false);
+    const size_t elementSize = ComponentSize(out.componentType) * size_t(out.components);
+    if (elementSize == 0) return false;
+    out.stride = viewStride ? viewStride : elementSize;
+
+    // Every element must lie inside the view, since the data is read unchecked later
+    size_t offset = accessor->value("byteOffset", size_t(0));
+    if (out.count > 0) {
+        if (offset > viewLength || elementSize > viewLength - offset) return false;
+        if ((viewLength - offset - elementSize) / out.stride < out.count - 1) return false;
+    }
+    out.data = viewData + offset;
+    return true;
+}
+
+// Reads up to n components of element i as floats, applying normalization.
+static void ReadFloats(const GlbAccessor& accessor, size_t i, float* out, int n) {
+    const unsigned char* p = accessor.data + i * accessor.stride;
+    for (int c = 0; c < std::min(n, accessor.components); ++c) {
+        switch (accessor.componentType) {
+        case GLTF_FLOAT: memcpy(&out[c], p + c * 4, 4); break;
+        case GLTF_UNSIGNED_BYTE: out[c] = float(p[c]) / (accessor.normalized ? 255.0f : 1.0f); break;
+        case GLTF_BYTE: {
+            float v = float(int8_t(p[c]));
+            out[c] = accessor.normalized ? std::max(v / 127.0f, -1.0f) : v;
+            break;
+        }
+        case GLTF_UNSIGNED_SHORT: {
+            uint16_t v;
+            memcpy(&v, p + c * 2, 2);
+            out[c] = float(v) / (accessor.normalized ? 65535.0f : 1.0f);
+            break;
+        }
+        case GLTF_SHORT: {
+            int16_t v;
+            memcpy(&v, p + c * 2, 2);
+            out[c] = accessor.normalized ? std::max(float(v) / 32767.0f, -1.0f) : float(v);
+            break;
+        }
+        default: out[c] = 0.0f; break;
+        }
+    }
+}
+
+static uint32_t ReadIndex(const GlbAccessor& accessor, size_t i) {
+    const unsigned char* p = accessor.data + i * accessor.stride;
+    switch (accessor.componentType) {
+    case GLTF_UNSIGNED_BYTE: return p[0];
+    case GLTF_UNSIGNED_SHORT: { uint16_t v; memcpy(&v, p, 2); return v; }
+    default: { uint32_t v; memcpy(&v, p, 4); return v; }
+    }
+}
+
+static glm::mat4 NodeTransform(const json& node) {
+    auto matrix = node.find("matrix");
+    if (matrix != node.end() && matrix->is_array() && matrix->size() == 16) {
+        std::vector<float> m = matrix->get<std::vector<float>>();
+        return glm::make_mat4(m.data());   // column-major in both glTF and glm
+    }
+
+    glm::vec3 translation(0.0f), scale(1.0f);
+    glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+    auto t = node.find("translation");
+    if (t != node.end() && t->is_array() && t->size() == 3) {
+        translation = glm::vec3((*t)[0].get<float>(), (*t)[1].get<float>(), (*t)[2].get<float>());
+    }
+    auto r = node.find("rotation");
+    if (r != node.end() && r->is_array() && r->size() == 4) {
+        // glTF stores x, y, z, w
+        rotation = glm::quat((*r)[3].get<float>(), (*r)[0].get<float>(), (*r)[1].get<float>(), (*r)[2].get<float>());
+    }
+    auto s = node.find("scale");
+    if (s != node.end() && s->is_array() && s->size() == 3) {
+        scale = glm::vec3((*s)[0].get<float>(), (*s)[1].get<float>(), (*s)[2].get<float>());
+    }
+    return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+static Material ConvertMaterial(const json& doc, int index, const std::string& path) {
+    Material material;
+    material.name = "default_material";
+    material.ambient = glm::vec3(0.1f);
+    material.diffuse = glm::vec3(1.0f);
+
+    // The glTF default material is fully metallic and rough
+    float metallic = 1.0f, roughness = 1.0f;
+    const json* source = Element(doc, "materials", index);
+    if (source) {
+        material.name = source->value("name", "material_" + std::to_string(index));
+        auto pbr = source->find("pbrMetallicRoughness");
+        if (pbr != source->end() && pbr->is_object()) {
+            auto factor = pbr->find("baseColorFactor");
+            if (factor != pbr->end() && factor->is_array() && factor->size() >= 3) {
+                material.diffuse = glm::vec3((*factor)[0].get<float>(), (*factor)[1].get<float>(), (*factor)[2].get<float>());
+            }
+            metallic = pbr->value("metallicFactor", 1.0f);
+            roughness = pbr->value("roughnessFactor", 1.0f);
+
+            auto texture = pbr->find("baseColorTexture");
+            if (texture != pbr->end() && texture->is_object()) {
+                const json* textureDef = Element(doc, "textures", texture->value("index", -1));
+                if (textureDef && textureDef->contains("source")) {
+                    int image = textureDef->value("source", -1);
+                    if (Element(doc, "images", image)) {
+                        material.diffuseTexture = path + GLB_IMAGE_TAG + std::to_string(image);
+                    }
+                }
+            }
+        }
+    }
+
+    // Rough approximation of metal/roughness for the Blinn-Phong shader:
+    // dielectrics reflect 4%, metals their base color, fading with roughness.
+    metallic = glm::clamp(metallic, 0.0f, 1.0f);
+    roughness = glm::clamp(roughness, 0.0f, 1.0f);
+    material.specular = glm::mix(glm::vec3(0.04f), material.diffuse, metallic) * (1.0f - roughness);
+    float alpha = roughness * roughness;
+    material.shininess = glm::clamp(2.0f / std::max(alpha * alpha, 1e-4f) - 2.0f, 1.0f, 256.0f);
+    return material;
+}
+
+// Appends one triangle primitive to mesh. 'direct' is set when the vertex
+// data already had Vertex's interleaved layout and went in as a single copy.
+static bool AppendPrimitive(const GlbFile& glb, const json& primitive, const glm::mat4& transform,
+    Mesh& mesh, bool& direct) {
+    direct = false;
+    if (primitive.value("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES) return false;
+    auto attributes = primitive.find("attributes");
+    if (attributes == primitive.end() || !attributes->is_object()) return false;
+
+    GlbAccessor position, normal, texCoord;
+    if (!ResolveAccessor(glb, attributes->value("POSITION", -1), position) ||
+        position.componentType != GLTF_FLOAT || position.components != 3) {
+        return false;
+    }
+    const size_t count = position.count;
+    bool hasNormal = ResolveAccessor(glb, attributes->value("NORMAL", -1), normal) &&
+        normal.componentType == GLTF_FLOAT && normal.components == 3 && normal.count == count;
+    bool hasTexCoord = ResolveAccessor(glb, attributes->value("TEXCOORD_0", -1), texCoord) &&
+        texCoord.components == 2 && texCoord.count == count;
+
+    GlbAccessor indexAccessor;
+    const bool indexed = primitive.contains("indices");
+    if (indexed && (!ResolveAccessor(glb, primitive.value("indices", -1), indexAccessor) ||
+        indexAccessor.components != 1 || indexAccessor.componentType == GLTF_FLOAT ||
+        indexAccessor.componentType == GLTF_BYTE || indexAccessor.componentType == GLTF_SHORT)) {
+        return false;
+    }
+
+    const size_t firstVertex = mesh.vertices.size();
+    const size_t firstIndex = mesh.indices.size();
+    const size_t indexCount = (indexed ? indexAccessor.count : count) / 3 * 3;
+    mesh.indices.resize(firstIndex + indexCount);
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t index = indexed ? ReadIndex(indexAccessor, i) : uint32_t(i);
+        if (index >= count) {
+            mesh.indices.resize(firstIndex);
+            return false;
+        }
+        mesh.indices[firstIndex + i] = unsigned(firstVertex) + index;
+    }
+
+    // Mirroring transforms turn the winding around
+    const glm::mat3 linear(transform);
+    if (glm::determinant(linear) < 0.0f) {
+        for (size_t i = firstIndex; i < mesh.indices.size(); i += 3) {
+            std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+        }
+    }
+
+    mesh.vertices.resize(firstVertex + count);
+    Vertex* out = mesh.vertices.data() + firstVertex;
+    const bool identity = transform == glm::mat4(1.0f);
+    if (identity && hasNormal && hasTexCoord && texCoord.componentType == GLTF_FLOAT &&
+        position.stride == sizeof(Vertex) && normal.stride == sizeof(Vertex) && texCoord.stride == sizeof(Vertex) &&
+        normal.data == position.data + offsetof(Vertex, normal) &&
+        texCoord.data == position.data + offsetof(Vertex, texCoord)) {
+        memcpy(out, position.data, count * sizeof(Vertex));
+        direct = true;
+        return true;
+    }
+
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+    for (size_t i = 0; i < count; ++i) {
+        Vertex& vertex = out[i];
+        ReadFloats(position, i, &vertex.position.x, 3);
+        vertex.normal = glm::vec3(0.0f);
+        vertex.texCoord = glm::vec2(0.0f);
+        if (hasNormal) ReadFloats(normal, i, &vertex.normal.x, 3);
+        if (hasTexCoord) ReadFloats(texCoord, i, &vertex.texCoord.x, 2);
+        if (!identity) {
+            vertex.position = glm::vec3(transform * glm::vec4(vertex.position, 1.0f));
+            vertex.normal = normalMatrix * vertex.normal;
+        }
+    }
+
+    if (!hasNormal) {
+        // The spec asks for flat normals here; area-weighted smooth ones keep
+        // the vertices shared and look the same on flat geometry.
+        for (size_t i = firstIndex; i + 2 < mesh.indices.size(); i += 3) {
+            Vertex& a = mesh.vertices[mesh.indices[i]];
+            Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+            Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+            glm::vec3 faceNormal = glm::cross(b.position - a.position, c.position - a.position);
+            a.normal += faceNormal;
+            b.normal += faceNormal;
+            c.normal += faceNormal;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        float length = glm::length(out[i].normal);
+        if (length > 0.0f) out[i].normal /= length;
+    }
+    return true;
+}
+
+bool IsGlbPath(const std::string& path) {
+    if (path.size() < 4) return false;
+    std::string extension = path.substr(path.size() - 4);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](unsigned char c) { return char(std::tolower(c)); });
+    return extension == ".glb";
+}
+
+bool LoadGlb(const std::string& path, bool splitGroups, std::vector<Mesh>& meshes, GlbLoadStats& stats) {
+    GlbFile glb;
+    if (!OpenGlb(path, glb)) return false;
+    stats.ioMs += glb.openMs;
+    stats.bytesRead += glb.file.Size();
+
+    try {
+        const json& doc = glb.doc;
+        std::unordered_map<std::string, size_t> meshIndex;   // group '\n' material -> meshes[]
+        std::unordered_map<int, Material> materials;
+
+        auto addMesh = [&](int meshId, const std::string& nodeName, const glm::mat4& transform) {
+            const json* source = Element(doc, "meshes", meshId);
+            if (!source) return;
+            auto primitives = source->find("primitives");
+            if (primitives == source->end() || !primitives->is_array()) return;
+
+            std::string group;
+            if (splitGroups) {
+                group = !nodeName.empty() ? nodeName : source->value("name", "mesh_" + std::to_string(meshId));
+            }
+            for (const auto& primitive : *primitives) {
+                int materialId = primitive.value("material", -1);
+                std::string key = group + '\n' + std::to_string(materialId);
+                auto found = meshIndex.find(key);
+                if (found == meshIndex.end()) {
+                    auto converted = materials.find(materialId);
+                    if (converted == materials.end()) {
+                        converted = materials.emplace(materialId, ConvertMaterial(doc, materialId, path)).first;
+                    }
+                    found = meshIndex.emplace(key, meshes.size()).first;
+                    meshes.emplace_back();
+                    meshes.back().material = converted->second;
+                    meshes.back().group = group;
+                }
+
+                bool direct = false;
+                if (AppendPrimitive(glb, primitive, transform, meshes[found->second], direct)) {
+                    ++stats.primitives;
+                    if (direct) ++stats.directPrimitives;
+                }
+                else {
+                    ++stats.skippedPrimitives;
+                }
+            }
+        };
+
+        const json* scene = Element(doc, "scenes", doc.value("scene", 0));
+        if (scene && scene->contains("nodes")) {
+            // Depth-first over the node tree, accumulating transforms
+            struct PendingNode {
+                int node;
+                glm::mat4 parent;
+            };
+            // Pushed in reverse so meshes come out in file order
+            std::vector<PendingNode> stack;
+            const json& roots = (*scene)["nodes"];
+            for (auto root = roots.rbegin(); root != roots.rend(); ++root) {
+                stack.push_back({ root->get<int>(), glm::mat4(1.0f) });
+            }
+            // A valid file is a forest, so every node is reached once; a
+            // node seen again is a cycle or a shared child and is skipped
+            std::vector<bool> visited(doc.contains("nodes") ? doc["nodes"].size() : 0, false);
+            while (!stack.empty()) {
+                PendingNode pending = stack.back();
+                stack.pop_back();
+                const json* node = Element(doc, "nodes", pending.node);
+                if (!node || visited[size_t(pending.node)]) continue;
+                visited[size_t(pending.node)] = true;
+
+                glm::mat4 world = pending.parent * NodeTransform(*node);
+                if (node->contains("mesh")) {
+                    addMesh(node->value("mesh", -1), node->value("name", std::string()), world);
+                }
+                auto children = node->find("children");
+                if (children != node->end() && children->is_array()) {
+                    for (auto child = children->rbegin(); child != children->rend(); ++child) {
+                        stack.push_back({ child->get<int>(), world });
+                    }
+                }
+            }
+        }
+        else if (doc.contains("meshes")) {
+            // No scene: take every mesh once, untransformed
+            for (size_t m = 0; m < doc["meshes"].size(); ++m) {
+                addMesh(int(m), std::string(), glm::mat4(1.0f));
+            }
+        }
+    }
+    catch (const json::exception& e) {
+        std::cerr << "ERROR: Malformed glTF file: " << path << " (" << e.what() << ")" << std::endl;
+        meshes.clear();
+        return false;
+    }
+
+    if (stats.skippedPrimitives > 0) {
+        std::cerr << "ERROR: Skipped " << stats.skippedPrimitives
+            << " glTF primitives that are not indexable triangles in: " << path << std::endl;
+    }
+
+    // Materials whose every primitive failed leave empty meshes behind
+    meshes.erase(std::remove_if(meshes.begin(), meshes.end(),
+        [](const Mesh& mesh) { return mesh.indices.empty(); }), meshes.end());
+    return !meshes.empty();
+}
+
+bool IsGlbImagePath(const std::string& path) {
+    size_t tag = path.rfind(GLB_IMAGE_TAG);
+    return tag != std::string::npos && IsGlbPath(path.substr(0, tag));
+}
+
+std::string GlbImageFile(const std::string& path) {
+    return path.substr(0, path.rfind(GLB_IMAGE_TAG));
+}
+
+std::shared_ptr<const GlbFile> OpenGlbFile(const std::string& path) {
+    auto glb = std::make_shared<GlbFile>();
+    if (!OpenGlb(path, *glb)) return nullptr;
+    return glb;
+}
+
+bool ReadGlbImage(const std::string& path, std::vector<unsigned char>& bytes, const GlbFile* opened) {
+    size_t tag = path.rfind(GLB_IMAGE_TAG);
+    if (tag == std::string::npos) return false;
+    std::string glbPath = path.substr(0, tag);
+    int index = atoi(path.c_str() + tag + strlen(GLB_IMAGE_TAG));
+
+    GlbFile local;
+    if (!opened && !OpenGlb(glbPath, local)) return false;
+    const GlbFile& glb = opened ? *opened : local;
+    const json* image = Element(glb.doc, "images", index);
+    if (!image) {
+        std::cerr << "ERROR: glTF image not found: " << path << std::endl;
+        return false;
+    }
+
+    try {
+        if (image->contains("bufferView")) {
+            const unsigned char* data;
+            size_t length, stride;
+            if (!ResolveBufferView(glb, image->value("bufferView", -1), data, length, stride)) {
+                std::cerr << "ERROR: glTF image has a bad buffer view: " << path << std::endl;
+                return false;
+            }
+            bytes.assign(data, data + length);
+            return true;
+        }
+
+        std::string uri = image->value("uri", std::string());
+        if (uri.empty() || uri.compare(0, 5, "data:") == 0) {
+            std::cerr << "ERROR: Unsupported glTF image source: " << path << std::endl;
+            return false;
+        }
+        std::string filePath = glbPath.substr(0, glbPath.find_last_of("/\\") + 1) + uri;
+        AssetFile file;
+        if (!file.Open(filePath)) {
+            std::cerr << "ERROR: Failed to open glTF image: " << filePath << std::endl;
+            return false;
+        }
+        bytes.assign(file.Data(), file.Data() + file.Size());
+        return true;
+    }
+    catch (const json::exception& e) {
+        std::cerr << "ERROR: Malformed glTF image entry: " << path << " (" << e.what() << ")" << std::endl;
+        return false;
+    }
+}
@@ -0,0 +1,44 @@
+// GltfLoader.h
+#pragma once
+#include "model_loader.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Binary glTF 2.0 (.glb) import. Only what Model can draw is read: triangle
+// primitives with POSITION, NORMAL and TEXCOORD_0, and the base color of
+// pbrMetallicRoughness materials. Skins, morph targets, sparse accessors and
+// external .bin buffers are not supported.
+
+struct GlbLoadStats {
+    size_t primitives = 0;          // triangle primitives read, counting each node instance
+    size_t directPrimitives = 0;    // of those, copied as one block because they already match Vertex
+    size_t skippedPrimitives = 0;   // points, lines or malformed primitives
+    double ioMs = 0.0;              // opening the file
+    size_t bytesRead = 0;
+};
+
+struct GlbFile;
+
+bool IsGlbPath(const std::string& path);
+
+// Reads the triangle primitives of the default scene into meshes with node
+// transforms baked in. Primitives sharing a material are merged per node name,
+// or across the whole file when splitGroups is false.
+bool LoadGlb(const std::string& path, bool splitGroups, std::vector<Mesh>& meshes, GlbLoadStats& stats);
+
+// glTF images are referenced as "<file>.glb#image<N>", so they can be queued
+// and cached like any other texture path. Their UV origin is the top left,
+// which means they must be decoded without the vertical flip OBJ textures get.
+bool IsGlbImagePath(const std::string& path);
+// The .glb an image path points into.
+std::string GlbImageFile(const std::string& path);
+
+// A .glb mapped with its JSON parsed, so several of its images can be read
+// without opening and parsing it again for each. Null if it fails to open.
+std::shared_ptr<const GlbFile> OpenGlbFile(const std::string& path);
+
+// Copies the encoded (PNG/JPEG) bytes of a glTF image, from the BIN chunk or
+// from a file next to the .glb. 'glb', when given, is that .glb opened with
+// OpenGlbFile; otherwise it is opened for this one image.
+bool ReadGlbImage(const std::string& path, std::vector<unsigned char>& bytes, const GlbFile* glb = nullptr);
@@ -0,0 +1,70 @@
+// GpuUploadQueue.cpp
+#include "GpuUploadQueue.h"
+#include <chrono>
+
+GpuUploadQueue::GpuUploadQueue() : head(&stub), tail(&stub) {
+}
+
+GpuUploadQueue::~GpuUploadQueue() {
+    // Jobs left over at shutdown are dropped without running
+    while (Node* node = PopNode()) {
+        delete node;
+    }
+}
+
+void GpuUploadQueue::Push(std::function<void()> job) {
+    Node* node = new Node();
+    node->job = std::move(job);
+    pending.fetch_add(1, std::memory_order_relaxed);
+    PushNode(node);
+}
+
+void GpuUploadQueue::PushNode(Node* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* previous = head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+}
+
+GpuUploadQueue::Node* GpuUploadQueue::PopNode() {
+    Node* first = tail;
+    Node* next = first->next.load(std::memory_order_acquire);
+
+    if (first == &stub) {
+        if (!next) return nullptr;
+        tail = next;
+        first = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+        tail = next;
+        return first;
+    }
+
+    // 'first' is the last node; a producer may be between its exchange and
+    // its link, in which case we try again next time.
+    if (first != head.load(std::memory_order_acquire)) return nullptr;
+
+    PushNode(&stub);
+    next = first->next.load(std::memory_order_acquire);
+    if (next) {
+        tail = next;
+        return first;
+    }
+    return nullptr;
+}
+
+size_t GpuUploadQueue::Drain(double budgetMs) {
+    auto start = std::chrono::steady_clock::now();
+    size_t ran = 0;
+
+    while (Node* node = PopNode()) {
+        node->job();
+        delete node;
+        pending.fetch_sub(1, std::memory_order_relaxed);
+        ++ran;
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() >= budgetMs) break;
+    }
+    return ran;
+}
@@ -0,0 +1,40 @@
+// GpuUploadQueue.h
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+// Hands GL work from loader threads to the thread that owns the context.
+// Any thread may Push; only the GL thread calls Drain. The queue is an
+// intrusive multi-producer / single-consumer list, so producers never block.
+class GpuUploadQueue {
+public:
+    GpuUploadQueue();
+    ~GpuUploadQueue();
+
+    GpuUploadQueue(const GpuUploadQueue&) = delete;
+    GpuUploadQueue& operator=(const GpuUploadQueue&) = delete;
+
+    void Push(std::function<void()> job);
+
+    // Runs queued jobs in push order until budgetMs has been spent. At least
+    // one job runs per call so uploads always make progress. Returns the number
+    // of jobs run.
+    size_t Drain(double budgetMs);
+
+    size_t Pending() const { return pending.load(std::memory_order_relaxed); }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{ nullptr };
+        std::function<void()> job;
+    };
+
+    void PushNode(Node* node);
+    Node* PopNode();
+
+    std::atomic<Node*> head;    // most recently pushed, shared by producers
+    Node* tail;                 // next to pop, owned by the consumer
+    Node stub;
+    std::atomic<size_t> pending{ 0 };
+};
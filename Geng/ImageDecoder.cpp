@@ -0,0 +1,49 @@
+// ImageDecoder.cpp
+#include "ImageDecoder.h"
+#include "AssetPack.h"
+#include "ContentHash.h"
+#include "LoadReport.h"
+#include "ThreadPool.h"
+#include "stb_image.h"
+
+DecodedImage::~DecodedImage() {
+    if (pixels) stbi_image_free(pixels);
+}
+
+uint64_t ImageContentHash(const unsigned char* bytes, size_t size, bool flipVertically) {
+    unsigned char flip = flipVertically ? 1 : 0;
+    return HashBytes(bytes, size, HashBytes(&flip, 1));
+}
+
+bool DecodeImageMemory(const unsigned char* bytes, size_t size, bool flipVertically, DecodedImage& image) {
+    LoadTimer timer;
+    if (!image.contentHash) {
+        image.contentHash = ImageContentHash(bytes, size, flipVertically);
+    }
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+    image.pixels = stbi_load_from_memory(bytes, int(size), &image.width, &image.height, &image.components, 0);
+    image.decodeMs = timer.Lap();
+    return image.pixels != nullptr;
+}
+
+bool DecodeImageFile(const std::string& path, bool flipVertically, DecodedImage& image) {
+    image.path = path;
+    LoadTimer timer;
+    AssetFile file;
+    if (!file.Open(path)) return false;
+    image.ioMs = timer.Lap();
+    image.fileBytes = file.Size();
+    return DecodeImageMemory(reinterpret_cast<const unsigned char*>(file.Data()), file.Size(), flipVertically, image);
+}
+
+std::vector<std::shared_ptr<DecodedImage>> DecodeImageFiles(const std::vector<std::string>& paths,
+    bool flipVertically) {
+    std::vector<std::shared_ptr<DecodedImage>> images(paths.size());
+    for (auto& image : images) {
+        image = std::make_shared<DecodedImage>();
+    }
+    ThreadPool::Shared().ParallelFor(paths.size(), [&](size_t i) {
+        DecodeImageFile(paths[i], flipVertically, *images[i]);
+    });
+    return images;
+}
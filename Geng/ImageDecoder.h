@@ -0,0 +1,74 @@
+// ImageDecoder.h
+#pragma once
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// What a mip chain's levels hold: tightly packed 8-bit texels, or 4x4 blocks
+// of a BCn format (see BlockCompression.h).
+enum class BlockFormat : uint32_t {
+    None = 0,
+    BC1 = 1,    // RGB, 8 bytes per block
+    BC3 = 3,    // RGBA, 16 bytes per block
+    BC4 = 4,    // one channel, 8 bytes per block
+    BC5 = 5,    // two channels, 16 bytes per block
+};
+
+// One level of a mip chain, tightly packed rows or blocks.
+struct ImageLevel {
+    int width = 0;
+    int height = 0;
+    const unsigned char* pixels = nullptr;
+    size_t size = 0;
+};
+
+// Pixels decoded on a loader thread and waiting for upload. Frees them on destruction.
+struct DecodedImage {
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    unsigned char* pixels = nullptr;        // from stb_image; level 0 only
+
+    // A complete mip chain, largest first, from MipCache. When set, 'pixels'
+    // is null and the levels point into levelStorage or levelFile.
+    std::vector<ImageLevel> levels;
+    std::vector<unsigned char> levelStorage;
+    MappedFile levelFile;
+    BlockFormat blockFormat = BlockFormat::None;
+    uint64_t mipCacheKey = 0;   // the MipCache entry the levels were read from or stored to
+    double ioMs = 0.0;
+    double decodeMs = 0.0;
+    size_t fileBytes = 0;
+    uint64_t contentHash = 0;   // ImageContentHash of the encoded bytes
+
+    DecodedImage() = default;
+    ~DecodedImage();
+    DecodedImage(const DecodedImage&) = delete;
+    DecodedImage& operator=(const DecodedImage&) = delete;
+
+    bool HasPixels() const { return pixels || !levels.empty(); }
+};
+
+// stb_image decoding that any number of threads may run at once. The vertical
+// flip is passed per call and applied through stb's thread-local setting;
+// nothing may use the process-wide stbi_set_flip_vertically_on_load.
+
+// Equal for two files with the same bytes decoded the same way, so it can
+// stand in for the pixels when looking for duplicates.
+uint64_t ImageContentHash(const unsigned char* bytes, size_t size, bool flipVertically);
+
+// Decodes PNG, JPEG, ... bytes into image.pixels and sets image.decodeMs, and
+// image.contentHash unless the caller already set it.
+bool DecodeImageMemory(const unsigned char* bytes, size_t size, bool flipVertically, DecodedImage& image);
+
+// Reads 'path' through AssetFile, then decodes it. Sets every field of 'image'.
+bool DecodeImageFile(const std::string& path, bool flipVertically, DecodedImage& image);
+
+// Decodes all of 'paths' on ThreadPool::Shared() and the calling thread.
+// Results are in the order of 'paths'; an image that failed has no pixels.
+std::vector<std::shared_ptr<DecodedImage>> DecodeImageFiles(const std::vector<std::string>& paths,
+    bool flipVertically);
@@ -0,0 +1,87 @@
+// LoadReport.cpp
+#include "LoadReport.h"
+#include <json/json.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+LoadReport& LoadReport::Shared() {
+    static LoadReport report;
+    return report;
+}
+
+void LoadReport::Add(const AssetLoadRecord& record) {
+    std::lock_guard<std::mutex> lock(mutex);
+    records.push_back(record);
+}
+
+std::vector<AssetLoadRecord> LoadReport::Records() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return records;
+}
+
+void LoadReport::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    records.clear();
+}
+
+static nlohmann::json RecordJson(const AssetLoadRecord& record) {
+    return {
+        { "kind", record.kind },
+        { "path", record.path },
+        { "totalMs", record.totalMs },
+        { "ioMs", record.ioMs },
+        { "parseMs", record.parseMs },
+        { "mipMs", record.mipMs },
+        { "uploadMs", record.uploadMs },
+        { "bytesRead", record.bytesRead },
+        { "gpuBytes", record.gpuBytes },
+        { "fromCache", record.fromCache },
+    };
+}
+
+bool LoadReport::WriteJson(const std::string& path) const {
+    std::vector<AssetLoadRecord> snapshot = Records();
+
+    nlohmann::json assets = nlohmann::json::array();
+    std::map<std::string, AssetLoadRecord> totals;   // sorted, so diffs between runs stay stable
+    for (const auto& record : snapshot) {
+        assets.push_back(RecordJson(record));
+        AssetLoadRecord& total = totals[record.kind];
+        total.kind = record.kind;
+        total.totalMs += record.totalMs;
+        total.ioMs += record.ioMs;
+        total.parseMs += record.parseMs;
+        total.mipMs += record.mipMs;
+        total.uploadMs += record.uploadMs;
+        total.bytesRead += record.bytesRead;
+        total.gpuBytes += record.gpuBytes;
+    }
+    nlohmann::json byKind = nlohmann::json::object();
+    for (const auto& entry : totals) {
+        nlohmann::json total = RecordJson(entry.second);
+        total.erase("kind");
+        total.erase("path");
+        total.erase("fromCache");
+        byKind[entry.first] = total;
+    }
+
+    nlohmann::json report = {
+        { "build", __DATE__ " " __TIME__ },
+        { "assets", assets },
+        { "totals", byKind },
+    };
+
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "ERROR: Failed to write load report: " << path << std::endl;
+        return false;
+    }
+    out << report.dump(2) << "\n";
+    return bool(out);
+}
+
+size_t EstimateTextureBytes(int width, int height, int components, bool mipmapped) {
+    size_t bytes = size_t(width) * size_t(height) * size_t(components);
+    return mipmapped ? bytes + bytes / 3 : bytes;
+}
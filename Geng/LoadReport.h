@@ -0,0 +1,61 @@
+// LoadReport.h
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One instrumented load: a model, material library, texture or cubemap.
+// GL phases are CPU-side submission time; the driver may finish the work
+// later. Mapped files fault their pages in while being parsed, so for OBJ
+// and glTF most of the real disk time lands in parseMs rather than ioMs.
+struct AssetLoadRecord {
+    std::string kind;           // "Model", "MTL", "Texture", "Cubemap"
+    std::string path;
+    double totalMs = 0.0;       // wall time, including a model's textures; a texture
+                                // decoded off the GL thread reports the sum of its phases
+    double ioMs = 0.0;          // opening, mapping or unpacking files
+    double parseMs = 0.0;       // text parsing, mesh processing or image decoding
+    double mipMs = 0.0;         // glGenerateMipmap
+    double uploadMs = 0.0;      // buffer and texture uploads
+    size_t bytesRead = 0;
+    size_t gpuBytes = 0;        // estimated, including mip levels
+    bool fromCache = false;     // a model served from its .gmesh sidecar
+};
+
+// Process-wide list of load records, filled from any thread.
+class LoadReport {
+public:
+    static LoadReport& Shared();
+
+    void Add(const AssetLoadRecord& record);
+    std::vector<AssetLoadRecord> Records() const;
+    void Clear();
+
+    // Records plus per-kind totals, so startup runs can be compared across builds.
+    bool WriteJson(const std::string& path) const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<AssetLoadRecord> records;
+};
+
+// Milliseconds since construction or the previous Lap().
+class LoadTimer {
+public:
+    LoadTimer() : start(std::chrono::steady_clock::now()) {}
+
+    double Lap() {
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::milli> elapsed = now - start;
+        start = now;
+        return elapsed.count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// GPU footprint of an 8-bit texture; a full mip chain adds a third.
+size_t EstimateTextureBytes(int width, int height, int components, bool mipmapped);
@@ -0,0 +1,126 @@
+// LzCodec.cpp
+#include "LzCodec.h"
+#include <cstdint>
+#include <cstring>
+
+// A sequence is: token (literal length << 4 | match length - 4), extra
+// literal length bytes, literals, match offset (u16), extra match length
+// bytes. Lengths of 15 continue in following bytes of 255 until a smaller one.
+// The block ends with a literal-only sequence.
+static const size_t MIN_MATCH = 4;
+static const size_t MAX_OFFSET = 0xFFFF;
+static const size_t LAST_LITERALS = 5;   // the final bytes are always literals
+static const size_t MATCH_LIMIT = 12;    // no match may start this close to the end
+static const unsigned HASH_BITS = 16;
+
+static uint32_t Read32(const char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t HashBytes(uint32_t bytes) {
+    return (bytes * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void PutLength(std::vector<char>& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(char(255));
+        length -= 255;
+    }
+    out.push_back(char(length));
+}
+
+static void PutSequence(std::vector<char>& out, const char* literals, size_t literalCount,
+    size_t offset, size_t matchLength) {
+    const size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+    out.push_back(char(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15)));
+    if (literalCount >= 15) PutLength(out, literalCount - 15);
+    out.insert(out.end(), literals, literals + literalCount);
+    if (matchLength == 0) return;
+
+    out.push_back(char(offset & 0xFF));
+    out.push_back(char(offset >> 8));
+    if (matchCode >= 15) PutLength(out, matchCode - 15);
+}
+
+void LzCompress(const char* src, size_t size, std::vector<char>& out) {
+    out.clear();
+    out.reserve(size / 2 + 16);
+
+    size_t anchor = 0;   // first byte not yet emitted
+    if (size > MATCH_LIMIT) {
+        std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);   // position + 1, 0 = empty
+        const size_t matchEnd = size - LAST_LITERALS;
+        size_t pos = 0;
+        while (pos + MATCH_LIMIT <= size) {
+            const uint32_t bytes = Read32(src + pos);
+            uint32_t& slot = table[HashBytes(bytes)];
+            const size_t candidate = slot ? slot - 1 : pos;
+            slot = uint32_t(pos + 1);
+
+            if (candidate >= pos || pos - candidate > MAX_OFFSET || Read32(src + candidate) != bytes) {
+                ++pos;
+                continue;
+            }
+
+            size_t length = MIN_MATCH;
+            while (pos + length < matchEnd && src[candidate + length] == src[pos + length]) ++length;
+
+            PutSequence(out, src + anchor, pos - anchor, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+        }
+    }
+    PutSequence(out, src + anchor, size - anchor, 0, 0);
+}
+
+// Reads a length continuation; false if the input ends first.
+static bool GetLength(const unsigned char*& in, const unsigned char* end, size_t& length) {
+    unsigned char byte;
+    do {
+        if (in >= end) return false;
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool LzDecompress(const char* src, size_t srcSize, char* dst, size_t dstSize) {
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* inEnd = in + srcSize;
+    size_t outPos = 0;
+
+    while (in < inEnd) {
+        const unsigned token = *in++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !GetLength(in, inEnd, literalCount)) return false;
+        if (literalCount > size_t(inEnd - in) || literalCount > dstSize - outPos) return false;
+        memcpy(dst + outPos, in, literalCount);
+        in += literalCount;
+        outPos += literalCount;
+        if (in == inEnd) break;   // the last sequence has no match
+
+        if (inEnd - in < 2) return false;
+        const size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+        in += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !GetLength(in, inEnd, matchLength)) return false;
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > outPos || matchLength > dstSize - outPos) return false;
+
+        // A match closer than its length repeats bytes it is still writing,
+        // so it has to be copied forward one byte at a time.
+        const char* match = dst + outPos - offset;
+        char* out = dst + outPos;
+        if (offset >= matchLength) {
+            memcpy(out, match, matchLength);
+        }
+        else {
+            for (size_t i = 0; i < matchLength; ++i) out[i] = match[i];
+        }
+        outPos += matchLength;
+    }
+    return outPos == dstSize;
+}
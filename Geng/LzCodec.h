@@ -0,0 +1,15 @@
+// LzCodec.h
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Byte-oriented LZ77 in the LZ4 block format: greedy matching against a 64 KB
+// window, no entropy coding. Compression is modest but decompression runs at
+// memory speed, which is what asset reads want.
+
+// Replaces 'out' with the compressed form of [src, src + size).
+void LzCompress(const char* src, size_t size, std::vector<char>& out);
+
+// Decompresses exactly dstSize bytes. Returns false on malformed or truncated
+// input instead of reading or writing out of bounds.
+bool LzDecompress(const char* src, size_t srcSize, char* dst, size_t dstSize);
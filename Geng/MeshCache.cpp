@@ -0,0 +1,299 @@
+// MeshCache.cpp
+#include "MeshCache.h"
+#include "AssetPack.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static_assert(sizeof(Vertex) == 32, "Vertex layout is part of the .gmesh format");
+
+// File layout (little endian, blobs 16-byte aligned):
+//   "GMSH" version flags meshCount sourceCount
+//   per source:  size(u64) mtime(i64) path
+//   per mesh:    material group lods boundsMin boundsMax uvExtent contentHash
+//                vertexCount(u64) indexCount(u64) packed(u32) [offset scale error]
+//                <pad> vertices <pad> indices [<pad> packed vertices]
+// Strings are a u32 length followed by the bytes.
+static const char MESH_CACHE_MAGIC[4] = { 'G', 'M', 'S', 'H' };
+static const size_t MESH_CACHE_ALIGN = 16;
+
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+// Sources may live in a mounted asset pack, so they are stamped through it
+static bool StampFile(const std::string& path, SourceStamp& stamp) {
+    return StatAsset(path, stamp.size, stamp.mtime);
+}
+
+std::string MeshCachePath(const std::string& sourcePath) {
+    return sourcePath + ".gmesh";
+}
+
+// ---- Writing ----
+
+class CacheWriter {
+public:
+    explicit CacheWriter(std::ofstream& out) : out(out) {}
+
+    template <typename T>
+    void Put(const T& value) { Bytes(&value, sizeof(T)); }
+
+    void String(const std::string& s) {
+        Put(uint32_t(s.size()));
+        Bytes(s.data(), s.size());
+    }
+
+    void Bytes(const void* data, size_t size) {
+        out.write(static_cast<const char*>(data), std::streamsize(size));
+        offset += size;
+    }
+
+    void Align() {
+        static const char zeros[MESH_CACHE_ALIGN] = {};
+        size_t pad = (MESH_CACHE_ALIGN - offset % MESH_CACHE_ALIGN) % MESH_CACHE_ALIGN;
+        Bytes(zeros, pad);
+    }
+
+private:
+    std::ofstream& out;
+    size_t offset = 0;
+};
+
+bool WriteMeshCache(const std::string& sourcePath, const std::vector<std::string>& sourceFiles,
+    uint32_t flags, const std::vector<Mesh>& meshes) {
+    std::vector<SourceStamp> stamps(sourceFiles.size());
+    for (size_t i = 0; i < sourceFiles.size(); ++i) {
+        if (!StampFile(sourceFiles[i], stamps[i])) return false;
+    }
+
+    // Write next to the final name and rename, so a crash never leaves a
+    // truncated cache that looks fresh.
+    std::string cachePath = MeshCachePath(sourcePath);
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "ERROR: Failed to write mesh cache: " << cachePath << std::endl;
+            return false;
+        }
+
+        CacheWriter writer(out);
+        writer.Bytes(MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+        writer.Put(MESH_CACHE_VERSION);
+        writer.Put(flags);
+        writer.Put(uint32_t(meshes.size()));
+        writer.Put(uint32_t(sourceFiles.size()));
+
+        for (size_t i = 0; i < sourceFiles.size(); ++i) {
+            writer.Put(stamps[i].size);
+            writer.Put(stamps[i].mtime);
+            writer.String(sourceFiles[i]);
+        }
+
+        for (const auto& mesh : meshes) {
+            const Material& mat = mesh.material;
+            writer.String(mat.name);
+            writer.Put(mat.ambient);
+            writer.Put(mat.diffuse);
+            writer.Put(mat.specular);
+            writer.Put(mat.shininess);
+            writer.String(mat.diffuseTexture);
+            writer.String(mesh.group);
+
+            writer.Put(uint32_t(mesh.lods.size()));
+            for (const auto& lod : mesh.lods) {
+                writer.Put(uint64_t(lod.firstIndex));
+                writer.Put(uint64_t(lod.indexCount));
+                writer.Put(lod.error);
+            }
+
+            writer.Put(mesh.boundsMin);
+            writer.Put(mesh.boundsMax);
+            writer.Put(mesh.uvExtent);
+            writer.Put(mesh.contentHash);
+
+            const bool packed = !mesh.packedVertices.empty() && mesh.packedVertices.size() == mesh.VertexCount();
+            writer.Put(uint64_t(mesh.VertexCount()));
+            writer.Put(uint64_t(mesh.IndexCount()));
+            writer.Put(uint32_t(packed ? 1 : 0));
+            if (packed) {
+                writer.Put(mesh.positionOffset);
+                writer.Put(mesh.positionScale);
+                writer.Put(mesh.packingError);
+            }
+            writer.Align();
+            writer.Bytes(mesh.VertexData(), mesh.VertexCount() * sizeof(Vertex));
+            writer.Align();
+            writer.Bytes(mesh.IndexData(), mesh.IndexCount() * sizeof(unsigned int));
+            writer.Align();
+            if (packed) {
+                writer.Bytes(mesh.packedVertices.data(), mesh.packedVertices.size() * sizeof(PackedVertex));
+                writer.Align();
+            }
+        }
+
+        if (!out.good()) {
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ---- Reading ----
+
+// Bounds-checked cursor over the mapped file; any overrun marks it failed.
+class CacheReader {
+public:
+    CacheReader(const char* data, size_t size) : data(data), size(size) {}
+
+    template <typename T>
+    T Get() {
+        T value{};
+        if (Has(sizeof(T))) memcpy(&value, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    std::string String() {
+        uint32_t length = Get<uint32_t>();
+        if (!Has(length)) return std::string();
+        std::string s(data + offset, length);
+        offset += length;
+        return s;
+    }
+
+    const char* Blob(size_t bytes) {
+        if (!Has(bytes)) return nullptr;
+        const char* blob = data + offset;
+        offset += bytes;
+        return blob;
+    }
+
+    void Align() {
+        offset += (MESH_CACHE_ALIGN - offset % MESH_CACHE_ALIGN) % MESH_CACHE_ALIGN;
+    }
+
+    bool Ok() const { return !failed && offset <= size; }
+
+private:
+    bool Has(size_t bytes) {
+        if (failed || offset > size || bytes > size - offset) failed = true;
+        return !failed;
+    }
+
+    const char* data;
+    size_t size;
+    size_t offset = 0;
+    bool failed = false;
+};
+
+bool OpenMeshCache(const std::string& sourcePath, uint32_t flags, MappedFile& file,
+    std::vector<CachedMeshView>& views, std::vector<std::string>& sourceFiles) {
+    views.clear();
+    sourceFiles.clear();
+    if (!file.Open(MeshCachePath(sourcePath))) return false;
+
+    CacheReader reader(file.Data(), file.Size());
+    const char* magic = reader.Blob(sizeof(MESH_CACHE_MAGIC));
+    if (!magic || memcmp(magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0) return false;
+    if (reader.Get<uint32_t>() != MESH_CACHE_VERSION) return false;
+    if (reader.Get<uint32_t>() != flags) return false;
+
+    uint32_t meshCount = reader.Get<uint32_t>();
+    uint32_t sourceCount = reader.Get<uint32_t>();
+
+    for (uint32_t i = 0; i < sourceCount && reader.Ok(); ++i) {
+        SourceStamp cached;
+        cached.size = reader.Get<uint64_t>();
+        cached.mtime = reader.Get<int64_t>();
+        std::string path = reader.String();
+
+        SourceStamp current;
+        if (!StampFile(path, current) || current.size != cached.size || current.mtime != cached.mtime)
+            return false;
+        sourceFiles.push_back(path);
+    }
+    if (sourceFiles.empty() || sourceFiles[0] != sourcePath) return false;
+
+    for (uint32_t i = 0; i < meshCount && reader.Ok(); ++i) {
+        CachedMeshView view;
+        Material& mat = view.material;
+        mat.name = reader.String();
+        mat.ambient = reader.Get<glm::vec3>();
+        mat.diffuse = reader.Get<glm::vec3>();
+        mat.specular = reader.Get<glm::vec3>();
+        mat.shininess = reader.Get<float>();
+        mat.diffuseTexture = reader.String();
+        view.group = reader.String();
+
+        uint32_t lodCount = reader.Get<uint32_t>();
+        if (lodCount == 0 || lodCount > MAX_MESH_LODS) return false;
+        for (uint32_t l = 0; l < lodCount; ++l) {
+            MeshLod lod;
+            lod.firstIndex = size_t(reader.Get<uint64_t>());
+            lod.indexCount = size_t(reader.Get<uint64_t>());
+            lod.error = reader.Get<float>();
+            view.lods.push_back(lod);
+        }
+
+        view.boundsMin = reader.Get<glm::vec3>();
+        view.boundsMax = reader.Get<glm::vec3>();
+        view.uvExtent = reader.Get<float>();
+        view.contentHash = reader.Get<uint64_t>();
+
+        uint64_t vertexCount = reader.Get<uint64_t>();
+        uint64_t indexCount = reader.Get<uint64_t>();
+        uint32_t packed = reader.Get<uint32_t>();
+        if (packed > 1) return false;
+        if (packed) {
+            view.positionOffset = reader.Get<glm::vec3>();
+            view.positionScale = reader.Get<glm::vec3>();
+            view.packingError = reader.Get<PackingError>();
+        }
+        if (vertexCount > file.Size() / sizeof(Vertex) || indexCount > file.Size() / sizeof(unsigned int))
+            return false;
+        // Level 0 is the full mesh and each simplified level follows the one
+        // before, as BuildLods lays them out, ending with the index payload
+        size_t lodEnd = 0;
+        for (const auto& lod : view.lods) {
+            if (lod.firstIndex != lodEnd || lod.indexCount > indexCount - lod.firstIndex) return false;
+            lodEnd = lod.firstIndex + lod.indexCount;
+        }
+        if (lodEnd != indexCount) return false;
+
+        reader.Align();
+        view.vertices = reinterpret_cast<const Vertex*>(reader.Blob(size_t(vertexCount) * sizeof(Vertex)));
+        reader.Align();
+        view.indices = reinterpret_cast<const unsigned int*>(reader.Blob(size_t(indexCount) * sizeof(unsigned int)));
+        reader.Align();
+        if (packed) {
+            view.packedVertices = reinterpret_cast<const PackedVertex*>(reader.Blob(size_t(vertexCount) * sizeof(PackedVertex)));
+            reader.Align();
+        }
+        view.vertexCount = size_t(vertexCount);
+        view.indexCount = size_t(indexCount);
+
+        // Reject indices that would read past the vertex buffer on the GPU
+        if (view.indices) {
+            for (size_t j = 0; j < view.indexCount; ++j) {
+                if (view.indices[j] >= vertexCount) return false;
+            }
+        }
+        views.push_back(view);
+    }
+
+    return reader.Ok() && views.size() == meshCount;
+}
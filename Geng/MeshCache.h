@@ -0,0 +1,47 @@
+// MeshCache.h
+#pragma once
+#include "model_loader.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary sidecar (<source>.gmesh) holding triangulated meshes in the exact
+// layout glBufferData expects. It records the size and timestamp of every
+// file the model was built from, so edits to the OBJ or its MTLs invalidate it.
+const uint32_t MESH_CACHE_VERSION = 5;
+
+// A mesh inside a mapped cache file. The pointers stay valid while the
+// MappedFile it was read from is open. Bounds, UV extent and content hash
+// are stored so a cache hit does not walk the vertices again.
+struct CachedMeshView {
+    Material material;
+    std::string group;
+    std::vector<MeshLod> lods;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    float uvExtent = 1.0f;
+    uint64_t contentHash = 0;
+    const Vertex* vertices = nullptr;
+    size_t vertexCount = 0;
+    const unsigned int* indices = nullptr;
+    size_t indexCount = 0;
+    // Present when the cache was written by a Packed16 load; vertexCount of them
+    const PackedVertex* packedVertices = nullptr;
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    PackingError packingError;
+};
+
+std::string MeshCachePath(const std::string& sourcePath);
+
+// sourceFiles[0] is the model itself; flags encodes the load options that
+// shaped the stored data, so a load with different options misses the cache.
+// Meshes holding packedVertices have them stored as well.
+bool WriteMeshCache(const std::string& sourcePath, const std::vector<std::string>& sourceFiles,
+    uint32_t flags, const std::vector<Mesh>& meshes);
+
+// Maps the cache for sourcePath and returns false if it is missing, stale,
+// written with other flags or malformed.
+bool OpenMeshCache(const std::string& sourcePath, uint32_t flags, MappedFile& file,
+    std::vector<CachedMeshView>& views, std::vector<std::string>& sourceFiles);
@@ -0,0 +1,765 @@
+// MeshOptimizer.cpp
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+// ---- Vertex cache (Forsyth) ----
+
+static const int FORSYTH_CACHE_SIZE = 32;
+static const unsigned FORSYTH_VALENCE_TABLE = 32;
+
+struct ForsythScores {
+    float position[FORSYTH_CACHE_SIZE];
+    float valence[FORSYTH_VALENCE_TABLE];
+
+    ForsythScores() {
+        for (int i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+            // The three most recent vertices score equally, so the order the
+            // last triangle was emitted in does not matter.
+            position[i] = i < 3 ? 0.75f
+                : std::pow(1.0f - float(i - 3) / float(FORSYTH_CACHE_SIZE - 3), 1.5f);
+        }
+        valence[0] = 0.0f;
+        for (unsigned i = 1; i < FORSYTH_VALENCE_TABLE; ++i) {
+            valence[i] = 2.0f / std::sqrt(float(i));
+        }
+    }
+
+    float Vertex(int cachePos, unsigned remaining) const {
+        if (remaining == 0) return -1.0f;
+        float score = cachePos >= 0 ? position[cachePos] : 0.0f;
+        score += remaining < FORSYTH_VALENCE_TABLE ? valence[remaining] : 2.0f / std::sqrt(float(remaining));
+        return score;
+    }
+};
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount) {
+    static const ForsythScores scores;
+    const size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+
+    // Live triangles per vertex; emitted triangles are swapped out of the range
+    std::vector<unsigned> remaining(vertexCount, 0);
+    for (unsigned idx : indices) ++remaining[idx];
+
+    std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+
+    std::vector<unsigned> adjacency(indices.size());
+    {
+        std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t t = 0; t < triCount; ++t) {
+            for (int k = 0; k < 3; ++k) adjacency[fill[indices[t * 3 + k]]++] = unsigned(t);
+        }
+    }
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = scores.Vertex(-1, remaining[v]);
+
+    std::vector<float> triScore(triCount);
+    std::vector<char> emitted(triCount, 0);
+    size_t best = 0;
+    for (size_t t = 0; t < triCount; ++t) {
+        triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triScore[t] > triScore[best]) best = t;
+    }
+
+    std::vector<unsigned> cache, nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    std::vector<unsigned> result;
+    result.reserve(indices.size());
+    size_t deadEndCursor = 0;
+
+    for (size_t step = 0; step < triCount; ++step) {
+        if (best == size_t(-1)) {
+            // Nothing in the cache has work left; continue with the next
+            // unemitted triangle in input order.
+            while (emitted[deadEndCursor]) ++deadEndCursor;
+            best = deadEndCursor;
+        }
+
+        const unsigned* tri = &indices[best * 3];
+        emitted[best] = 1;
+        result.insert(result.end(), tri, tri + 3);
+
+        for (int k = 0; k < 3; ++k) {
+            unsigned v = tri[k];
+            unsigned* live = &adjacency[adjacencyStart[v]];
+            for (unsigned i = 0; i < remaining[v]; ++i) {
+                if (live[i] == best) {
+                    std::swap(live[i], live[remaining[v] - 1]);
+                    break;
+                }
+            }
+            --remaining[v];
+        }
+
+        // LRU update: the emitted triangle's vertices move to the front
+        nextCache.assign(tri, tri + 3);
+        for (unsigned v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) nextCache.push_back(v);
+        }
+        cache.swap(nextCache);
+
+        for (size_t i = 0; i < cache.size(); ++i) {
+            unsigned v = cache[i];
+            cachePos[v] = i < size_t(FORSYTH_CACHE_SIZE) ? int(i) : -1;
+            vertexScore[v] = scores.Vertex(cachePos[v], remaining[v]);
+        }
+
+        best = size_t(-1);
+        float bestScore = -1.0f;
+        for (unsigned v : cache) {
+            const unsigned* live = &adjacency[adjacencyStart[v]];
+            for (unsigned i = 0; i < remaining[v]; ++i) {
+                size_t t = live[i];
+                float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                triScore[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        if (cache.size() > size_t(FORSYTH_CACHE_SIZE)) cache.resize(FORSYTH_CACHE_SIZE);
+    }
+
+    indices.swap(result);
+}
+
+// ---- Overdraw ----
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices) {
+    const size_t triCount = indices.size() / 3;
+    if (triCount < 2) return;
+
+    // Cluster boundaries: triangles whose three vertices all miss a 16-entry
+    // FIFO, i.e. where the cache-optimized order starts a new island anyway.
+    // Reordering whole clusters therefore leaves the cache hit rate intact.
+    const unsigned cacheSize = 16;
+    std::vector<unsigned> stamp(vertices.size(), 0);
+    unsigned time = cacheSize + 1;
+    std::vector<size_t> clusterStart;
+    for (size_t t = 0; t < triCount; ++t) {
+        int misses = 0;
+        for (int k = 0; k < 3; ++k) {
+            unsigned v = indices[t * 3 + k];
+            if (time - stamp[v] > cacheSize) {
+                stamp[v] = time++;
+                ++misses;
+            }
+        }
+        if (t == 0 || misses == 3) clusterStart.push_back(t);
+    }
+    clusterStart.push_back(triCount);
+    const size_t clusterCount = clusterStart.size() - 1;
+    if (clusterCount < 2) return;
+
+    // Area-weighted centroid and normal per cluster and for the whole mesh
+    std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float clusterArea = 0.0f;
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; ++t) {
+            const glm::vec3& a = vertices[indices[t * 3]].position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& d = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float area = glm::length(n);
+            clusterCentroid[c] += (a + b + d) * (area / 3.0f);
+            clusterNormal[c] += n;
+            clusterArea += area;
+        }
+        meshCentroid += clusterCentroid[c];
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f) clusterCentroid[c] /= clusterArea;
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        float length = glm::length(clusterNormal[c]);
+        sortKey[c] = length > 0.0f ? glm::dot(clusterCentroid[c] - meshCentroid, clusterNormal[c] / length) : 0.0f;
+    }
+
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order) {
+        result.insert(result.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+    }
+    indices.swap(result);
+}
+
+// ---- Vertex fetch ----
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    const unsigned unused = unsigned(-1);
+    std::vector<unsigned> remap(vertices.size(), unused);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for (unsigned& idx : indices) {
+        if (remap[idx] == unused) {
+            remap[idx] = unsigned(result.size());
+            result.push_back(vertices[idx]);
+        }
+        idx = remap[idx];
+    }
+    vertices.swap(result);
+}
+
+// ---- Splitting ----
+
+void SplitMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t maxVertices, std::vector<MeshPart>& parts) {
+    parts.clear();
+    if (indices.empty()) return;
+
+    // remap[v] is valid for the current part when stamp[v] == parts.size()
+    std::vector<unsigned> remap(vertices.size());
+    std::vector<size_t> stamp(vertices.size(), 0);
+    MeshPart* part = nullptr;
+
+    for (size_t tri = 0; tri + 2 < indices.size(); tri += 3) {
+        size_t newVertices = 0;
+        if (part) {
+            for (int corner = 0; corner < 3; ++corner) {
+                unsigned v = indices[tri + corner];
+                bool repeated = (corner > 0 && indices[tri] == v) || (corner > 1 && indices[tri + 1] == v);
+                if (stamp[v] != parts.size() && !repeated) ++newVertices;
+            }
+        }
+        if (!part || part->vertices.size() + newVertices > maxVertices) {
+            parts.emplace_back();
+            part = &parts.back();
+        }
+
+        for (int corner = 0; corner < 3; ++corner) {
+            unsigned v = indices[tri + corner];
+            if (stamp[v] != parts.size()) {
+                stamp[v] = parts.size();
+                remap[v] = unsigned(part->vertices.size());
+                part->vertices.push_back(vertices[v]);
+            }
+            part->indices.push_back(remap[v]);
+        }
+    }
+}
+
+static void AppendPart(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    const unsigned* triangles, size_t triangleCount, std::vector<unsigned>& remap, std::vector<MeshPart>& parts) {
+    const unsigned unused = unsigned(-1);
+    parts.emplace_back();
+    MeshPart& part = parts.back();
+    part.indices.reserve(triangleCount * 3);
+
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int corner = 0; corner < 3; ++corner) {
+            unsigned v = indices[size_t(triangles[t]) * 3 + corner];
+            if (remap[v] == unused) {
+                remap[v] = unsigned(part.vertices.size());
+                part.vertices.push_back(vertices[v]);
+            }
+            part.indices.push_back(remap[v]);
+        }
+    }
+
+    // Reset only what this part touched
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int corner = 0; corner < 3; ++corner) {
+            remap[indices[size_t(triangles[t]) * 3 + corner]] = unused;
+        }
+    }
+}
+
+void ClusterMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t maxTriangles, float maxExtent, std::vector<MeshPart>& parts) {
+    parts.clear();
+    const size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+
+    std::vector<glm::vec3> centroids(triCount);
+    std::vector<glm::vec3> triMin(triCount), triMax(triCount);
+    for (size_t t = 0; t < triCount; ++t) {
+        const glm::vec3& a = vertices[indices[t * 3]].position;
+        const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+        const glm::vec3& c = vertices[indices[t * 3 + 2]].position;
+        centroids[t] = (a + b + c) / 3.0f;
+        triMin[t] = glm::min(a, glm::min(b, c));
+        triMax[t] = glm::max(a, glm::max(b, c));
+    }
+
+    std::vector<unsigned> triangles(triCount);
+    for (size_t t = 0; t < triCount; ++t) triangles[t] = unsigned(t);
+    std::vector<unsigned> remap(vertices.size(), unsigned(-1));
+
+    // Ranges of 'triangles' still to be examined
+    std::vector<std::pair<size_t, size_t>> pending{ { 0, triCount } };
+    while (!pending.empty()) {
+        auto [begin, end] = pending.back();
+        pending.pop_back();
+        const size_t count = end - begin;
+
+        glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+        glm::vec3 centerMin = boundsMin, centerMax = boundsMax;
+        for (size_t i = begin; i < end; ++i) {
+            unsigned t = triangles[i];
+            boundsMin = glm::min(boundsMin, triMin[t]);
+            boundsMax = glm::max(boundsMax, triMax[t]);
+            centerMin = glm::min(centerMin, centroids[t]);
+            centerMax = glm::max(centerMax, centroids[t]);
+        }
+        glm::vec3 extent = boundsMax - boundsMin;
+        glm::vec3 spread = centerMax - centerMin;
+
+        bool fitsCount = maxTriangles == 0 || count <= maxTriangles;
+        bool fitsExtent = maxExtent <= 0.0f || std::max(extent.x, std::max(extent.y, extent.z)) <= maxExtent;
+        int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+
+        // Triangles sharing one centroid cannot be separated spatially
+        if ((fitsCount && fitsExtent) || count < 2 || spread[axis] <= 0.0f) {
+            std::sort(triangles.begin() + begin, triangles.begin() + end);
+            AppendPart(vertices, indices, triangles.data() + begin, count, remap, parts);
+            continue;
+        }
+
+        size_t middle = begin + count / 2;
+        std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end,
+            [&](unsigned a, unsigned b) { return centroids[a][axis] < centroids[b][axis]; });
+        // Upper half is pushed first so parts come out in order along the axis
+        pending.push_back({ middle, end });
+        pending.push_back({ begin, middle });
+    }
+}
+
+// ---- Simplification (Garland & Heckbert quadrics) ----
+
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0;
+    double weight = 0;
+
+    // Plane n.x + d = 0 with unit n
+    void AddPlane(const glm::dvec3& n, double d, double w) {
+        a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+        a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+        b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+        a00 += o.a00; a01 += o.a01; a02 += o.a02; a11 += o.a11; a12 += o.a12; a22 += o.a22;
+        b0 += o.b0; b1 += o.b1; b2 += o.b2; c += o.c;
+        weight += o.weight;
+        return *this;
+    }
+
+    // Weighted mean squared distance of p to the accumulated planes
+    double Error(const glm::dvec3& p) const {
+        double r = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+            + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+            + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        return weight > 0.0 ? std::fabs(r) / weight : 0.0;
+    }
+};
+
+// Border edges are held in place by planes through them, perpendicular to
+// their triangle, weighted well above the surface planes.
+static const double SIMPLIFY_BORDER_WEIGHT = 10.0;
+
+// Collapses that turn a triangle by more than about 75 degrees are refused.
+static const double SIMPLIFY_MIN_NORMAL_COS = 0.25;
+
+class Simplifier {
+public:
+    Simplifier(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+        : indices(indices), triCount(indices.size() / 3) {
+        BuildPositions(vertices);
+        BuildTriangles();
+        BuildQuadrics();
+    }
+
+    float Run(size_t targetTriangles, float maxError) {
+        const double maxCost = double(maxError) * double(maxError);
+        double worst = 0.0;
+
+        for (unsigned t = 0; t < indices.size() / 3; ++t) {
+            for (int e = 0; e < 3; ++e) {
+                unsigned a = posId[indices[t * 3 + e]];
+                unsigned b = posId[indices[t * 3 + (e + 1) % 3]];
+                PushEdge(a, b);
+                PushEdge(b, a);
+            }
+        }
+
+        while (!heap.empty() && triCount > targetTriangles) {
+            std::pop_heap(heap.begin(), heap.end());
+            Candidate edge = heap.back();
+            heap.pop_back();
+
+            if (removed[edge.from] || removed[edge.to]) continue;
+            if (edge.fromVersion != version[edge.from] || edge.toVersion != version[edge.to]) continue;
+            if (-edge.negCost > maxCost) break;
+            if (!Collapse(edge.from, edge.to)) continue;
+
+            worst = std::max(worst, -edge.negCost);
+            for (unsigned n : neighbours) {
+                PushEdge(n, edge.to);
+                PushEdge(edge.to, n);
+            }
+        }
+        return float(std::sqrt(worst));
+    }
+
+    void Result(std::vector<unsigned int>& out) const {
+        out.clear();
+        out.reserve(triCount * 3);
+        for (size_t t = 0; t < dead.size(); ++t) {
+            if (dead[t]) continue;
+            out.insert(out.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+        }
+    }
+
+private:
+    struct Candidate {
+        double negCost;     // negated so the std heap pops the cheapest
+        unsigned from, to;
+        unsigned fromVersion, toVersion;
+        bool operator<(const Candidate& o) const { return negCost < o.negCost; }
+    };
+
+    // Vertices that only differ in normal or UV share a position id; the
+    // topology and error are tracked per position.
+    void BuildPositions(const std::vector<Vertex>& vertices) {
+        glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+        for (const auto& vertex : vertices) {
+            boundsMin = glm::min(boundsMin, vertex.position);
+            boundsMax = glm::max(boundsMax, vertex.position);
+        }
+        glm::vec3 extent = boundsMax - boundsMin;
+        double scale = std::max(extent.x, std::max(extent.y, extent.z));
+        scale = scale > 0.0 ? 1.0 / scale : 1.0;
+
+        struct PositionHash {
+            size_t operator()(const glm::vec3& p) const {
+                uint32_t h[3];
+                memcpy(h, &p, sizeof(h));
+                return size_t(h[0] * 73856093u ^ h[1] * 19349663u ^ h[2] * 83492791u);
+            }
+        };
+        std::unordered_map<glm::vec3, unsigned, PositionHash> ids;
+        ids.reserve(vertices.size());
+        posId.resize(vertices.size());
+        for (size_t v = 0; v < vertices.size(); ++v) {
+            // Adding zero folds -0 into +0 so equal positions hash equally
+            auto inserted = ids.emplace(vertices[v].position + glm::vec3(0.0f), unsigned(points.size()));
+            if (inserted.second) {
+                points.push_back(glm::dvec3(vertices[v].position - boundsMin) * scale);
+            }
+            posId[v] = inserted.first->second;
+        }
+
+        removed.assign(points.size(), 0);
+        locked.assign(points.size(), 0);
+        border.assign(points.size(), 0);
+        version.assign(points.size(), 0);
+        quadrics.assign(points.size(), Quadric());
+        around.resize(points.size());
+    }
+
+    void BuildTriangles() {
+        dead.assign(indices.size() / 3, 0);
+        for (unsigned t = 0; t < dead.size(); ++t) {
+            unsigned a = posId[indices[t * 3]], b = posId[indices[t * 3 + 1]], c = posId[indices[t * 3 + 2]];
+            if (a == b || b == c || a == c) {
+                dead[t] = 1;
+                --triCount;
+                continue;
+            }
+            around[a].push_back(t);
+            around[b].push_back(t);
+            around[c].push_back(t);
+        }
+    }
+
+    static uint64_t EdgeKey(unsigned a, unsigned b) {
+        return a < b ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a);
+    }
+
+    void BuildQuadrics() {
+        std::unordered_map<uint64_t, unsigned> edgeUse;
+        edgeUse.reserve(triCount * 3);
+        for (unsigned t = 0; t < dead.size(); ++t) {
+            if (dead[t]) continue;
+            for (int e = 0; e < 3; ++e) {
+                ++edgeUse[EdgeKey(posId[indices[t * 3 + e]], posId[indices[t * 3 + (e + 1) % 3]])];
+            }
+        }
+
+        for (unsigned t = 0; t < dead.size(); ++t) {
+            if (dead[t]) continue;
+            unsigned p[3] = { posId[indices[t * 3]], posId[indices[t * 3 + 1]], posId[indices[t * 3 + 2]] };
+            glm::dvec3 normal = glm::cross(points[p[1]] - points[p[0]], points[p[2]] - points[p[0]]);
+            double area = glm::length(normal);
+            if (area <= 0.0) continue;
+            normal /= area;
+
+            Quadric plane;
+            plane.AddPlane(normal, -glm::dot(normal, points[p[0]]), area * 0.5);
+            for (int i = 0; i < 3; ++i) quadrics[p[i]] += plane;
+
+            for (int e = 0; e < 3; ++e) {
+                unsigned a = p[e], b = p[(e + 1) % 3];
+                unsigned uses = edgeUse[EdgeKey(a, b)];
+                if (uses == 2) continue;
+                if (uses > 2) {
+                    // Non-manifold edges are left exactly as they are
+                    locked[a] = locked[b] = 1;
+                    continue;
+                }
+                border[a] = border[b] = 1;
+                glm::dvec3 edge = points[b] - points[a];
+                glm::dvec3 side = glm::cross(edge, normal);
+                double length = glm::length(side);
+                if (length <= 0.0) continue;
+                side /= length;
+
+                Quadric constraint;
+                constraint.AddPlane(side, -glm::dot(side, points[a]), glm::dot(edge, edge) * SIMPLIFY_BORDER_WEIGHT);
+                quadrics[a] += constraint;
+                quadrics[b] += constraint;
+            }
+        }
+    }
+
+    void PushEdge(unsigned from, unsigned to) {
+        if (from == to || locked[from] || removed[from] || removed[to]) return;
+        Quadric q = quadrics[from];
+        q += quadrics[to];
+        heap.push_back({ -q.Error(points[to]), from, to, version[from], version[to] });
+        std::push_heap(heap.begin(), heap.end());
+    }
+
+    int Corner(unsigned t, unsigned position) const {
+        for (int i = 0; i < 3; ++i) {
+            if (posId[indices[t * 3 + i]] == position) return i;
+        }
+        return -1;
+    }
+
+    void GatherNeighbours(unsigned position, std::vector<unsigned>& out) const {
+        out.clear();
+        for (unsigned t : around[position]) {
+            if (dead[t]) continue;
+            for (int i = 0; i < 3; ++i) {
+                unsigned p = posId[indices[t * 3 + i]];
+                if (p != position) out.push_back(p);
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    // Moves 'from' onto 'to' if that keeps the mesh manifold, unflipped and
+    // every attribute wedge of 'from' continuous with one of 'to'.
+    bool Collapse(unsigned from, unsigned to) {
+        wedgeMap.clear();
+        size_t edgeTriangles = 0;
+        for (unsigned t : around[from]) {
+            if (dead[t]) continue;
+            int toCorner = Corner(t, to);
+            if (toCorner < 0) continue;
+            ++edgeTriangles;
+            unsigned fromVertex = indices[t * 3 + Corner(t, from)];
+            unsigned toVertex = indices[t * 3 + toCorner];
+            if (std::find_if(wedgeMap.begin(), wedgeMap.end(),
+                    [&](const std::pair<unsigned, unsigned>& w) { return w.first == fromVertex; }) == wedgeMap.end()) {
+                wedgeMap.push_back({ fromVertex, toVertex });
+            }
+        }
+        if (edgeTriangles == 0) return false;
+        // Border vertices may only slide along the border
+        if (border[from] && (!border[to] || edgeTriangles != 1)) return false;
+
+        GatherNeighbours(from, neighbours);
+        GatherNeighbours(to, scratch);
+        size_t shared = 0;
+        for (unsigned n : neighbours) {
+            if (std::binary_search(scratch.begin(), scratch.end(), n)) ++shared;
+        }
+        if (shared != edgeTriangles) return false;
+
+        for (unsigned t : around[from]) {
+            if (dead[t] || Corner(t, to) >= 0) continue;
+            int corner = Corner(t, from);
+            unsigned fromVertex = indices[t * 3 + corner];
+            auto wedge = std::find_if(wedgeMap.begin(), wedgeMap.end(),
+                [&](const std::pair<unsigned, unsigned>& w) { return w.first == fromVertex; });
+            if (wedge == wedgeMap.end()) return false;
+
+            const glm::dvec3& p0 = points[posId[indices[t * 3 + (corner + 1) % 3]]];
+            const glm::dvec3& p1 = points[posId[indices[t * 3 + (corner + 2) % 3]]];
+            glm::dvec3 before = glm::cross(p0 - points[from], p1 - points[from]);
+            glm::dvec3 after = glm::cross(p0 - points[to], p1 - points[to]);
+            double lengths = glm::length(before) * glm::length(after);
+            if (lengths <= 0.0 || glm::dot(before, after) < SIMPLIFY_MIN_NORMAL_COS * lengths) return false;
+        }
+
+        for (unsigned t : around[from]) {
+            if (dead[t]) continue;
+            if (Corner(t, to) >= 0) {
+                dead[t] = 1;
+                --triCount;
+                continue;
+            }
+            unsigned& vertex = indices[t * 3 + Corner(t, from)];
+            for (const auto& wedge : wedgeMap) {
+                if (wedge.first == vertex) {
+                    vertex = wedge.second;
+                    break;
+                }
+            }
+            around[to].push_back(t);
+        }
+        around[from].clear();
+        around[from].shrink_to_fit();
+        auto isDead = [&](unsigned t) { return dead[t] != 0; };
+        around[to].erase(std::remove_if(around[to].begin(), around[to].end(), isDead), around[to].end());
+
+        quadrics[to] += quadrics[from];
+        removed[from] = 1;
+        ++version[to];
+        GatherNeighbours(to, neighbours);
+        return true;
+    }
+
+    std::vector<unsigned int> indices;
+    size_t triCount;
+
+    std::vector<unsigned> posId;            // vertex -> position id
+    std::vector<glm::dvec3> points;         // per position id, normalized to the mesh extent
+    std::vector<char> removed, locked, border;
+    std::vector<unsigned> version;
+    std::vector<Quadric> quadrics;
+    std::vector<std::vector<unsigned>> around;  // triangles touching each position
+    std::vector<char> dead;
+    std::vector<Candidate> heap;
+
+    std::vector<std::pair<unsigned, unsigned>> wedgeMap;
+    std::vector<unsigned> neighbours, scratch;
+};
+
+float SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float maxError, std::vector<unsigned int>& result) {
+    Simplifier simplifier(vertices, indices);
+    float error = simplifier.Run(targetIndexCount / 3, maxError);
+    simplifier.Result(result);
+    return error;
+}
+
+// ---- Analysis ----
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount,
+    unsigned cacheSize) {
+    VertexCacheStats result;
+    const size_t triCount = indices.size() / 3;
+    if (triCount == 0) return result;
+
+    std::vector<unsigned> stamp(vertexCount, 0);
+    std::vector<char> referenced(vertexCount, 0);
+    unsigned time = cacheSize + 1;
+    size_t misses = 0, unique = 0;
+
+    for (unsigned v : indices) {
+        if (!referenced[v]) {
+            referenced[v] = 1;
+            ++unique;
+        }
+        if (time - stamp[v] > cacheSize) {
+            stamp[v] = time++;
+            ++misses;
+        }
+    }
+
+    result.acmr = float(misses) / float(triCount);
+    result.atvr = unique ? float(misses) / float(unique) : 0.0f;
+    return result;
+}
+
+float AnalyzeOverdraw(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices) {
+    const int res = 256;
+    if (indices.size() < 3 || vertices.empty()) return 0.0f;
+
+    glm::vec3 minPos(std::numeric_limits<float>::max());
+    glm::vec3 maxPos(-std::numeric_limits<float>::max());
+    for (unsigned idx : indices) {
+        minPos = glm::min(minPos, vertices[idx].position);
+        maxPos = glm::max(maxPos, vertices[idx].position);
+    }
+    glm::vec3 extent = maxPos - minPos;
+    float scale = std::max(extent.x, std::max(extent.y, extent.z));
+    if (scale <= 0.0f) return 0.0f;
+    scale = float(res) / scale;
+
+    std::vector<float> depth(size_t(res) * res);
+    size_t covered = 0, shaded = 0;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        const int uAxis = (axis + 1) % 3;
+        const int vAxis = (axis + 2) % 3;
+
+        for (float direction : { 1.0f, -1.0f }) {
+            std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+
+            for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+                glm::vec3 p[3];
+                for (int k = 0; k < 3; ++k) {
+                    glm::vec3 pos = (vertices[indices[t + k]].position - minPos) * scale;
+                    p[k] = glm::vec3(pos[uAxis], pos[vAxis], pos[axis] * direction);
+                }
+
+                float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+                if (area == 0.0f) continue;
+
+                int x0 = std::max(0, int(std::floor(std::min({ p[0].x, p[1].x, p[2].x }))));
+                int y0 = std::max(0, int(std::floor(std::min({ p[0].y, p[1].y, p[2].y }))));
+                int x1 = std::min(res - 1, int(std::ceil(std::max({ p[0].x, p[1].x, p[2].x }))));
+                int y1 = std::min(res - 1, int(std::ceil(std::max({ p[0].y, p[1].y, p[2].y }))));
+
+                for (int y = y0; y <= y1; ++y) {
+                    for (int x = x0; x <= x1; ++x) {
+                        float px = x + 0.5f, py = y + 0.5f;
+                        float w0 = ((p[2].x - p[1].x) * (py - p[1].y) - (p[2].y - p[1].y) * (px - p[1].x)) / area;
+                        float w1 = ((p[0].x - p[2].x) * (py - p[2].y) - (p[0].y - p[2].y) * (px - p[2].x)) / area;
+                        float w2 = 1.0f - w0 - w1;
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+                        float z = w0 * p[0].z + w1 * p[1].z + w2 * p[2].z;
+                        float& stored = depth[size_t(y) * res + x];
+                        if (z < stored) {
+                            if (stored == std::numeric_limits<float>::max()) ++covered;
+                            stored = z;
+                            ++shaded;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return covered ? float(shaded) / float(covered) : 0.0f;
+}
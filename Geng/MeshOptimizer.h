@@ -0,0 +1,61 @@
+// MeshOptimizer.h
+#pragma once
+#include "model_loader.h"
+#include <vector>
+
+// Index/vertex reordering for indexed triangle lists. None of these change
+// what is drawn, only the order it is drawn and fetched in.
+
+// Reorders triangles for post-transform cache hits (Forsyth's linear-speed
+// algorithm, modelled on a 32-entry LRU cache).
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+// Splits a cache-optimized index list into clusters at points where the
+// cache starts cold anyway, then draws outward-facing clusters first so the
+// depth test rejects more of what follows (Sander et al., "Tipsify").
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices);
+
+// Renumbers vertices in order of first use and drops unreferenced ones.
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+struct MeshPart {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Cuts the triangle list into consecutive runs that each reference at most
+// maxVertices vertices, renumbered per part in order of first use. Vertices
+// shared across a cut are duplicated, so split after OptimizeVertexCache to
+// keep cuts (and duplicates) few.
+void SplitMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t maxVertices, std::vector<MeshPart>& parts);
+
+// Recursively halves the triangles at the median centroid along the longest
+// axis until every part has at most maxTriangles triangles and a bounding box
+// no longer than maxExtent on any side (0 disables either limit). Parts keep
+// the original triangle order and are renumbered in order of first use.
+void ClusterMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t maxTriangles, float maxExtent, std::vector<MeshPart>& parts);
+
+// Quadric error metric edge collapse (Garland & Heckbert) down to at most
+// targetIndexCount indices, stopping early once a collapse would move the
+// surface by more than maxError, relative to the mesh's largest extent.
+// Vertices are only ever moved onto existing ones, so the result indexes the
+// same vertex buffer. Borders and attribute seams only slide along
+// themselves. Returns the largest error actually introduced.
+float SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float maxError, std::vector<unsigned int>& result);
+
+struct VertexCacheStats {
+    float acmr = 0.0f;   // transformed vertices per triangle (0.5 ideal, 3 worst)
+    float atvr = 0.0f;   // transformed vertices per unique vertex (1 ideal)
+};
+
+// Simulates a FIFO post-transform cache of the given size.
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount,
+    unsigned cacheSize = 16);
+
+// Shaded fragments per covered pixel, averaged over six axis-aligned
+// orthographic views rasterized in software with a depth test and no culling
+// (matching the renderer). 1.0 means no overdraw.
+float AnalyzeOverdraw(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices);
@@ -0,0 +1,357 @@
+// MipCache.cpp
+#include "MipCache.h"
+#include "AssetPack.h"
+#include "ContentHash.h"
+#include "LoadReport.h"
+#include "PixelUploadRing.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+// File layout (little endian, level data 16-byte aligned):
+//   MipCacheHeader, MipCacheLevel[levelCount], level data
+struct MipCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t width;
+    uint32_t height;
+    uint32_t components;
+    uint32_t levelCount;
+    uint32_t blockFormat;       // BlockFormat
+    uint32_t reserved;
+};
+
+struct MipCacheLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+static const char MIP_CACHE_MAGIC[4] = { 'G', 'T', 'E', 'X' };
+static const size_t MIP_CACHE_ALIGN = 16;
+static const uint32_t MAX_MIP_LEVELS = 32;
+
+static size_t AlignUp(size_t offset) {
+    return (offset + MIP_CACHE_ALIGN - 1) / MIP_CACHE_ALIGN * MIP_CACHE_ALIGN;
+}
+
+uint64_t MipCacheKey(uint64_t contentHash) {
+    return HashBytes(&MIP_CACHE_VERSION, sizeof(MIP_CACHE_VERSION), contentHash);
+}
+
+// Bumped whenever the encoders' output changes
+static const uint32_t BLOCK_ENCODER_VERSION = 1;
+
+uint64_t CompressedMipCacheKey(uint64_t key, TextureCompression quality) {
+    uint32_t settings[2] = { BLOCK_ENCODER_VERSION, uint32_t(quality) };
+    return HashBytes(settings, sizeof(settings), key);
+}
+
+std::string MipCachePath(uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.gtex", static_cast<unsigned long long>(key));
+    return std::string(MIP_CACHE_DIR) + "/" + name;
+}
+
+// ---- Building ----
+
+// 8-bit sRGB to linear, and linear (quantized to 12 bits) back to 8-bit sRGB
+struct SrgbTables {
+    float toLinear[256];
+    unsigned char fromLinear[4096];
+
+    SrgbTables() {
+        for (int i = 0; i < 256; ++i) {
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < 4096; ++i) {
+            float l = i / 4095.0f;
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            fromLinear[i] = static_cast<unsigned char>(std::min(255.0f, c * 255.0f + 0.5f));
+        }
+    }
+};
+
+static const SrgbTables& Srgb() {
+    static SrgbTables tables;
+    return tables;
+}
+
+// Each destination texel averages the 2x2 block above it; on odd sizes the
+// last row or column is clamped.
+static void Downsample(const ImageLevel& src, ImageLevel& dst, int components, unsigned char* out) {
+    const SrgbTables& srgb = Srgb();
+    const int colorChannels = components >= 3 ? 3 : 0;
+    const size_t srcRow = size_t(src.width) * components;
+    for (int y = 0; y < dst.height; ++y) {
+        const unsigned char* row0 = src.pixels + size_t(std::min(2 * y, src.height - 1)) * srcRow;
+        const unsigned char* row1 = src.pixels + size_t(std::min(2 * y + 1, src.height - 1)) * srcRow;
+        for (int x = 0; x < dst.width; ++x) {
+            size_t x0 = size_t(std::min(2 * x, src.width - 1)) * components;
+            size_t x1 = size_t(std::min(2 * x + 1, src.width - 1)) * components;
+            unsigned char* texel = out + (size_t(y) * dst.width + x) * components;
+            for (int c = 0; c < components; ++c) {
+                if (c < colorChannels) {
+                    float sum = srgb.toLinear[row0[x0 + c]] + srgb.toLinear[row0[x1 + c]] +
+                        srgb.toLinear[row1[x0 + c]] + srgb.toLinear[row1[x1 + c]];
+                    texel[c] = srgb.fromLinear[int(sum * 0.25f * 4095.0f + 0.5f)];
+                }
+                else {
+                    int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                    texel[c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+void BuildMipChain(DecodedImage& image) {
+    if (!image.pixels) return;
+    const size_t components = size_t(image.components);
+
+    // Size everything first so the levels can point into one allocation
+    std::vector<size_t> offsets;
+    size_t total = 0;
+    for (int w = image.width, h = image.height; ; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        offsets.push_back(total);
+        ImageLevel level;
+        level.width = w;
+        level.height = h;
+        level.size = size_t(w) * size_t(h) * components;
+        image.levels.push_back(level);
+        total += level.size;
+        if (w == 1 && h == 1) break;
+    }
+    image.levelStorage.resize(total);
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        image.levels[i].pixels = image.levelStorage.data() + offsets[i];
+    }
+
+    std::memcpy(image.levelStorage.data(), image.pixels, image.levels[0].size);
+    for (size_t i = 1; i < image.levels.size(); ++i) {
+        Downsample(image.levels[i - 1], image.levels[i], image.components,
+            image.levelStorage.data() + offsets[i]);
+    }
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+}
+
+bool WriteMipCache(uint64_t key, const DecodedImage& image) {
+    if (image.levels.empty() || image.levels.size() > MAX_MIP_LEVELS) return false;
+
+    std::error_code ec;
+    std::filesystem::create_directories(MIP_CACHE_DIR, ec);
+
+    // Loader threads may build the same texture at once, so each writes its
+    // own temporary file and the rename decides.
+    std::string cachePath = MipCachePath(key);
+    std::ostringstream tempName;
+    tempName << cachePath << ".tmp" << std::hash<std::thread::id>()(std::this_thread::get_id());
+    std::string tempPath = tempName.str();
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "ERROR: Failed to write mip cache: " << cachePath << std::endl;
+            return false;
+        }
+
+        MipCacheHeader header;
+        std::memcpy(header.magic, MIP_CACHE_MAGIC, sizeof(header.magic));
+        header.version = MIP_CACHE_VERSION;
+        header.key = key;
+        header.width = uint32_t(image.width);
+        header.height = uint32_t(image.height);
+        header.components = uint32_t(image.components);
+        header.levelCount = uint32_t(image.levels.size());
+        header.blockFormat = uint32_t(image.blockFormat);
+        header.reserved = 0;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        size_t offset = AlignUp(sizeof(header) + image.levels.size() * sizeof(MipCacheLevel));
+        for (const auto& level : image.levels) {
+            MipCacheLevel entry = { uint32_t(level.width), uint32_t(level.height), offset, level.size };
+            out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+            offset = AlignUp(offset + level.size);
+        }
+
+        static const char zeros[MIP_CACHE_ALIGN] = {};
+        size_t written = sizeof(header) + image.levels.size() * sizeof(MipCacheLevel);
+        for (const auto& level : image.levels) {
+            out.write(zeros, std::streamsize(AlignUp(written) - written));
+            out.write(reinterpret_cast<const char*>(level.pixels), std::streamsize(level.size));
+            written = AlignUp(written) + level.size;
+        }
+
+        if (!out.good()) {
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ---- Reading ----
+
+bool OpenMipCache(uint64_t key, DecodedImage& image) {
+    if (!image.levelFile.Open(MipCachePath(key))) return false;
+    const char* data = image.levelFile.Data();
+    const size_t size = image.levelFile.Size();
+
+    MipCacheHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MIP_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MIP_CACHE_VERSION || header.key != key ||
+        header.components < 1 || header.components > 4 ||
+        header.levelCount < 1 || header.levelCount > MAX_MIP_LEVELS ||
+        (header.blockFormat != 0 && BlockBytes(BlockFormat(header.blockFormat)) == 0) ||
+        size < sizeof(header) + header.levelCount * sizeof(MipCacheLevel)) {
+        image.levelFile.Close();
+        return false;
+    }
+
+    std::vector<ImageLevel> levels(header.levelCount);
+    uint32_t expectWidth = header.width;
+    uint32_t expectHeight = header.height;
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        MipCacheLevel entry;
+        std::memcpy(&entry, data + sizeof(header) + i * sizeof(MipCacheLevel), sizeof(entry));
+        uint64_t expectSize = header.blockFormat != 0 ?
+            BlockLevelBytes(BlockFormat(header.blockFormat), int(expectWidth), int(expectHeight)) :
+            uint64_t(expectWidth) * expectHeight * header.components;
+        if (entry.width != expectWidth || entry.height != expectHeight || entry.size != expectSize ||
+            entry.offset > size || entry.size > size - entry.offset) {
+            image.levelFile.Close();
+            return false;
+        }
+        levels[i].width = int(entry.width);
+        levels[i].height = int(entry.height);
+        levels[i].size = size_t(entry.size);
+        levels[i].pixels = reinterpret_cast<const unsigned char*>(data + entry.offset);
+        expectWidth = std::max(1u, expectWidth / 2);
+        expectHeight = std::max(1u, expectHeight / 2);
+    }
+
+    image.width = int(header.width);
+    image.height = int(header.height);
+    image.components = int(header.components);
+    image.levels = std::move(levels);
+    image.blockFormat = BlockFormat(header.blockFormat);
+    image.mipCacheKey = key;
+    return true;
+}
+
+bool DecodeImageMemoryMips(const unsigned char* bytes, size_t size, bool flipVertically, DecodedImage& image,
+    TextureCompression compression) {
+    LoadTimer timer;
+    image.contentHash = ImageContentHash(bytes, size, flipVertically);
+    uint64_t key = MipCacheKey(image.contentHash);
+    uint64_t compressedKey = CompressedMipCacheKey(key, compression);
+
+    // A compressed entry may come from a driver with other formats
+    if (compression != TextureCompression::None && OpenMipCache(compressedKey, image)) {
+        if (BlockFormatSupported(image.blockFormat)) {
+            image.decodeMs = timer.Lap();
+            return true;
+        }
+        image.levels.clear();
+        image.levelFile.Close();
+        image.blockFormat = BlockFormat::None;
+    }
+
+    if (!OpenMipCache(key, image)) {
+        if (!DecodeImageMemory(bytes, size, flipVertically, image)) return false;
+        BuildMipChain(image);
+        if (WriteMipCache(key, image)) image.mipCacheKey = key;
+    }
+    if (CompressMipChain(image, compression)) {
+        image.mipCacheKey = WriteMipCache(compressedKey, image) ? compressedKey : 0;
+    }
+    image.decodeMs = timer.Lap();
+    return true;
+}
+
+bool DecodeImageFileMips(const std::string& path, bool flipVertically, DecodedImage& image,
+    TextureCompression compression) {
+    image.path = path;
+    LoadTimer timer;
+    AssetFile file;
+    if (!file.Open(path)) return false;
+    image.ioMs = timer.Lap();
+    image.fileBytes = file.Size();
+    return DecodeImageMemoryMips(reinterpret_cast<const unsigned char*>(file.Data()), file.Size(),
+        flipVertically, image, compression);
+}
+
+// ---- Upload ----
+
+GLenum TextureFormat(int components) {
+    switch (components) {
+    case 1: return GL_RED;
+    case 2: return GL_RG;
+    case 4: return GL_RGBA;
+    default: return GL_RGB;
+    }
+}
+
+GLenum TextureInternalFormat(int components) {
+    switch (components) {
+    case 1: return GL_R8;
+    case 2: return GL_RG8;
+    case 4: return GL_RGBA8;
+    default: return GL_RGB8;
+    }
+}
+
+GLenum ImageInternalFormat(const DecodedImage& image) {
+    if (image.blockFormat != BlockFormat::None) return BlockFormatGL(image.blockFormat);
+    return TextureInternalFormat(image.components);
+}
+
+void UploadImageLevels(const DecodedImage& image, GLenum format) {
+    const GLenum clientFormat = TextureFormat(image.components);
+    // Rows are tightly packed, which GL's default 4-byte alignment misreads
+    // for RGB and for the narrow levels
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    PixelUploadRing& ring = PixelUploadRing::Shared();
+    if (image.levels.empty()) {
+        const void* source = ring.Stage(image.pixels, size_t(image.width) * image.height * image.components);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, clientFormat, GL_UNSIGNED_BYTE,
+            source);
+    }
+    else {
+        for (size_t i = 0; i < image.levels.size(); ++i) {
+            const ImageLevel& level = image.levels[i];
+            const void* source = ring.Stage(level.pixels, level.size);
+            if (image.blockFormat != BlockFormat::None) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, GLint(i), format, level.width, level.height, 0,
+                    GLsizei(level.size), source);
+            }
+            else {
+                glTexImage2D(GL_TEXTURE_2D, GLint(i), format, level.width, level.height, 0, clientFormat,
+                    GL_UNSIGNED_BYTE, source);
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(image.levels.size() - 1));
+    }
+    ring.Finish();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
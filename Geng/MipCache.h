@@ -0,0 +1,55 @@
+// MipCache.h
+#pragma once
+#include "ImageDecoder.h"
+#include "BlockCompression.h"
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Finished mip chains stored as texcache/<key>.gtex. The key derives from
+// ImageContentHash, so each texture is decoded and filtered
+// once; later loads of the same bytes, under any path or from a pack, map
+// the levels and upload them as they are. Levels hold tightly packed 8-bit
+// rows in the layout glTexImage2D takes for the image's channel count, or
+// the BCn blocks of a compressed chain, which has an entry of its own.
+const uint32_t MIP_CACHE_VERSION = 2;
+const char MIP_CACHE_DIR[] = "texcache";
+
+uint64_t MipCacheKey(uint64_t contentHash);
+std::string MipCachePath(uint64_t key);
+// The entry for the chain of 'key' block-compressed at 'quality'.
+uint64_t CompressedMipCacheKey(uint64_t key, TextureCompression quality);
+
+// Filters image.pixels down to 1x1 with a 2x2 box into image.levels and frees
+// image.pixels. RGB(A) is averaged in linear light, treating color as sRGB;
+// alpha and one or two channel images are averaged as they are.
+void BuildMipChain(DecodedImage& image);
+
+bool WriteMipCache(uint64_t key, const DecodedImage& image);
+// Maps the chain for 'key' into image.levels; false if missing or malformed.
+bool OpenMipCache(uint64_t key, DecodedImage& image);
+
+// Like DecodeImageMemory/DecodeImageFile, but return a full chain in
+// image.levels: mapped from the cache, or decoded, built and then stored.
+// With 'compression', and a block format the driver supports, the chain is
+// block-compressed the same way, cached separately.
+bool DecodeImageMemoryMips(const unsigned char* bytes, size_t size, bool flipVertically, DecodedImage& image,
+    TextureCompression compression = TextureCompression::None);
+bool DecodeImageFileMips(const std::string& path, bool flipVertically, DecodedImage& image,
+    TextureCompression compression = TextureCompression::None);
+
+// The client format of 'components' tightly packed 8-bit channels: GL_RED,
+// GL_RG, GL_RGB or GL_RGBA.
+GLenum TextureFormat(int components);
+// The sized internal format those channels upload as: GL_R8, GL_RG8, GL_RGB8
+// or GL_RGBA8.
+GLenum TextureInternalFormat(int components);
+// The internal format 'image' uploads as, its block format when compressed.
+GLenum ImageInternalFormat(const DecodedImage& image);
+
+// Uploads to the bound GL_TEXTURE_2D through PixelUploadRing: every level of
+// image.levels, or just image.pixels as level 0, in which case the caller
+// generates the mipmaps. 'format' is the internal format, compressed when
+// image.blockFormat is set; the client format follows image.components.
+void UploadImageLevels(const DecodedImage& image, GLenum format);
@@ -0,0 +1,330 @@
+// ObjBenchmark.cpp
+#include "ObjBenchmark.h"
+#include "model_loader.h"
+#include "LoadReport.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+static const int SYNTHETIC_MATERIALS = 10;
+static const int BENCHMARK_RUNS = 3;
+
+// Rows of the grid are written one at a time: the next row of vertices,
+// then an o or g line, a usemtl and the row's quads. Odd rows index their
+// corners from the end of the lists read so far, so negative indices are
+// exercised across the whole file.
+bool WriteSyntheticObj(const std::string& path, size_t quads) {
+    const size_t columns = std::max<size_t>(1, size_t(std::sqrt(double(quads))));
+    const size_t rows = std::max<size_t>(1, quads / columns);
+    const size_t rowVertices = columns + 1;
+
+    FILE* out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        std::cerr << "ERROR: Failed to write synthetic OBJ: " << path << std::endl;
+        return false;
+    }
+    auto writeRowVertices = [&](size_t row) {
+        for (size_t c = 0; c < rowVertices; ++c) {
+            float x = float(c) * 0.5f;
+            float z = float(row) * 0.5f;
+            float y = 0.25f * float((c * 7 + row * 13) % 17) / 17.0f;
+            std::fprintf(out, "v %.6f %.6f %.6f\n", x, y, z);
+            std::fprintf(out, "vt %.6f %.6f\n", float(c) / float(columns), float(row) / float(rows));
+            std::fprintf(out, "vn %.6f %.6f %.6f\n", 0.0f, 1.0f, 0.0f);
+        }
+    };
+
+    writeRowVertices(0);
+    for (size_t row = 0; row < rows; ++row) {
+        writeRowVertices(row + 1);
+        std::fprintf(out, "%s row%zu\n", row % 2 ? "o" : "g", row);
+        std::fprintf(out, "usemtl material%zu\n", row % SYNTHETIC_MATERIALS);
+
+        const long long written = (long long)((row + 2) * rowVertices);
+        for (size_t c = 0; c < columns; ++c) {
+            long long corners[4] = {
+                (long long)(row * rowVertices + c + 1),
+                (long long)(row * rowVertices + c + 2),
+                (long long)((row + 1) * rowVertices + c + 2),
+                (long long)((row + 1) * rowVertices + c + 1),
+            };
+            if (row % 2) {
+                for (long long& corner : corners) corner -= written + 1;
+            }
+            std::fprintf(out, "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n",
+                corners[0], corners[0], corners[0], corners[1], corners[1], corners[1],
+                corners[2], corners[2], corners[2], corners[3], corners[3], corners[3]);
+        }
+    }
+    bool ok = std::ferror(out) == 0;
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::cerr << "ERROR: Failed to write synthetic OBJ: " << path << std::endl;
+    }
+    return ok;
+}
+
+// ---- The parser Model::LoadOBJ used before it read mapped files ----
+// Kept as it was, minus materials and GL, so the comparison stays honest.
+
+struct LegacyMesh {
+    std::string material;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+static bool LegacyProcessFace(std::istringstream& iss, const std::vector<glm::vec3>& positions,
+    const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& texCoords, LegacyMesh& mesh) {
+    std::vector<Vertex> faceVertices;
+    std::string vertexData;
+
+    while (iss >> vertexData) {
+        std::replace(vertexData.begin(), vertexData.end(), '/', ' ');
+        std::istringstream viss(vertexData);
+
+        Vertex vertex;
+        int posIdx = 0, texIdx = 0, normIdx = 0;
+
+        if (!(viss >> posIdx)) return false;
+        if (viss.peek() != EOF) viss >> texIdx;
+        if (viss.peek() != EOF) viss >> normIdx;
+
+        // The one change: negative indices, which the synthetic file uses
+        if (posIdx < 0) posIdx += int(positions.size()) + 1;
+        if (texIdx < 0) texIdx += int(texCoords.size()) + 1;
+        if (normIdx < 0) normIdx += int(normals.size()) + 1;
+
+        if (posIdx < 1 || posIdx > int(positions.size())) return false;
+        vertex.position = positions[posIdx - 1];
+        vertex.texCoord = texIdx > 0 && texIdx <= int(texCoords.size()) ? texCoords[texIdx - 1] : glm::vec2(0.0f);
+        vertex.normal = normIdx > 0 && normIdx <= int(normals.size()) ? normals[normIdx - 1] : glm::vec3(0.0f, 0.0f, 1.0f);
+        faceVertices.push_back(vertex);
+    }
+
+    if (faceVertices.size() < 3) return false;
+
+    for (size_t i = 1; i < faceVertices.size() - 1; ++i) {
+        mesh.vertices.push_back(faceVertices[0]);
+        mesh.vertices.push_back(faceVertices[i]);
+        mesh.vertices.push_back(faceVertices[i + 1]);
+
+        for (int j = 0; j < 3; ++j) {
+            mesh.indices.push_back(unsigned(mesh.indices.size()));
+        }
+    }
+    return true;
+}
+
+static bool LegacyLoadObj(const std::string& path, std::vector<LegacyMesh>& meshes) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to open OBJ file: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::string currentMtl;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string prefix;
+        iss >> prefix;
+
+        if (prefix == "v") {
+            glm::vec3 pos;
+            iss >> pos.x >> pos.y >> pos.z;
+            positions.push_back(pos);
+        }
+        else if (prefix == "vn") {
+            glm::vec3 norm;
+            iss >> norm.x >> norm.y >> norm.z;
+            normals.push_back(norm);
+        }
+        else if (prefix == "vt") {
+            glm::vec2 uv;
+            iss >> uv.x >> uv.y;
+            texCoords.push_back(uv);
+        }
+        else if (prefix == "usemtl") {
+            iss >> currentMtl;
+        }
+        else if (prefix == "f") {
+            if (currentMtl.empty()) {
+                currentMtl = "default_material";
+            }
+
+            LegacyMesh* mesh = nullptr;
+            for (auto& m : meshes) {
+                if (m.material == currentMtl) {
+                    mesh = &m;
+                    break;
+                }
+            }
+            if (!mesh) {
+                meshes.emplace_back();
+                mesh = &meshes.back();
+                mesh->material = currentMtl;
+            }
+
+            if (!LegacyProcessFace(iss, positions, normals, texCoords, *mesh)) {
+                std::cerr << "ERROR: Failed to process face: " << line << std::endl;
+            }
+        }
+    }
+    return !meshes.empty();
+}
+
+// ---- Checking ----
+
+// Every triangle corner of each material, in file order. Welding and o/g
+// groups change how meshes store them, but not this.
+typedef std::map<std::string, std::vector<Vertex>> CornersByMaterial;
+
+static CornersByMaterial LegacyCorners(const std::vector<LegacyMesh>& meshes) {
+    CornersByMaterial corners;
+    for (const auto& mesh : meshes) {
+        std::vector<Vertex>& out = corners[mesh.material];
+        for (unsigned int index : mesh.indices) out.push_back(mesh.vertices[index]);
+    }
+    return corners;
+}
+
+static CornersByMaterial ModelCorners(const Model& model) {
+    CornersByMaterial corners;
+    for (const auto& mesh : model.meshes) {
+        std::vector<Vertex>& out = corners[mesh.material.name];
+        const size_t count = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+        for (size_t i = 0; i < count; ++i) out.push_back(mesh.vertices[mesh.indices[i]]);
+    }
+    return corners;
+}
+
+static bool SameVertex(const Vertex& a, const Vertex& b) {
+    return a.position == b.position && a.normal == b.normal && a.texCoord == b.texCoord;
+}
+
+// Reports the first corner where 'actual' differs from the legacy parse
+static bool SameCorners(const CornersByMaterial& expected, const CornersByMaterial& actual, const char* name) {
+    if (expected.size() != actual.size()) {
+        std::cerr << "ERROR: " << name << " read " << actual.size() << " materials, expected "
+            << expected.size() << std::endl;
+        return false;
+    }
+    for (const auto& material : expected) {
+        auto found = actual.find(material.first);
+        if (found == actual.end()) {
+            std::cerr << "ERROR: " << name << " has no faces for material " << material.first << std::endl;
+            return false;
+        }
+        const std::vector<Vertex>& a = material.second;
+        const std::vector<Vertex>& b = found->second;
+        if (a.size() != b.size()) {
+            std::cerr << "ERROR: " << name << " read " << b.size() / 3 << " triangles of " << material.first
+                << ", expected " << a.size() / 3 << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (!SameVertex(a[i], b[i])) {
+                std::cerr << "ERROR: " << name << " differs from the legacy parse at corner " << i << " of "
+                    << material.first << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// ---- Timing ----
+
+// Best of BENCHMARK_RUNS, so a cold page cache on the first run does not count
+template <typename Fn>
+static double BestMs(Fn&& load) {
+    double best = 0.0;
+    for (int run = 0; run < BENCHMARK_RUNS; ++run) {
+        LoadTimer timer;
+        if (!load()) return -1.0;
+        double ms = timer.Lap();
+        best = run == 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+bool RunObjBenchmark(const std::string& path, size_t quads) {
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        std::cout << "Writing synthetic OBJ " << path << " (" << quads << " quads)..." << std::endl;
+        if (!WriteSyntheticObj(path, quads)) return false;
+    }
+    uint64_t fileBytes = uint64_t(std::filesystem::file_size(path, ec));
+
+    // The reference output, read once before any timing
+    std::vector<LegacyMesh> legacyMeshes;
+    if (!LegacyLoadObj(path, legacyMeshes)) return false;
+    const CornersByMaterial expected = LegacyCorners(legacyMeshes);
+    size_t legacyTriangles = 0;
+    for (const auto& mesh : legacyMeshes) legacyTriangles += mesh.indices.size() / 3;
+    legacyMeshes.clear();
+
+    double legacyMs = BestMs([&]() {
+        std::vector<LegacyMesh> meshes;
+        return LegacyLoadObj(path, meshes);
+    });
+    if (legacyMs < 0.0) return false;
+
+    // Both paths stop at CPU-side meshes; the cache and optimizations stay
+    // off so the new path does no work the old one skipped
+    ModelLoadOptions options;
+    options.useMeshCache = false;
+    options.optimizeMeshes = false;
+    options.lazyTextures = true;
+
+    struct Variant {
+        const char* name;
+        bool weld;
+        unsigned threads;
+    };
+    const Variant variants[] = {
+        { "mapped, unwelded, 1 thread", false, 1 },
+        { "mapped, welded, 1 thread", true, 1 },
+        { "mapped, welded, all threads", true, 0 },
+    };
+
+    // A variant that reads different geometry fails before it is timed
+    for (const Variant& variant : variants) {
+        options.weldVertices = variant.weld;
+        options.parseThreads = variant.threads;
+        Model model;
+        if (!model.LoadSource(path, options) || !SameCorners(expected, ModelCorners(model), variant.name)) {
+            return false;
+        }
+    }
+
+    // The speedup depends on the file size and on how many threads the pool has
+    std::cout << "OBJ load benchmark: " << path << " (" << fileBytes / (1024 * 1024) << " MB, "
+        << legacyTriangles << " triangles, " << ThreadPool::Shared().Size() + 1 << " threads), best of "
+        << BENCHMARK_RUNS << " runs\n";
+    std::cout << "  istringstream (before):      " << legacyMs << " ms\n";
+    for (const Variant& variant : variants) {
+        options.weldVertices = variant.weld;
+        options.parseThreads = variant.threads;
+        double ms = BestMs([&]() {
+            Model model;
+            return model.LoadSource(path, options);
+        });
+        if (ms < 0.0) return false;
+        std::cout << "  " << variant.name << ": " << std::string(28 - std::strlen(variant.name), ' ')
+            << ms << " ms (" << legacyMs / ms << "x)\n";
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+// ObjBenchmark.h
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Times Model::LoadSource against the getline/istringstream OBJ parser it
+// replaced, after checking that every variant reads the same triangle
+// corners (positions, normals, UVs, in file order per material) as the old
+// parser. 'path' is first written as a synthetic grid of about 'quads' faces
+// (v/vt/vn, a usemtl switch and an o/g group per row) unless it already
+// exists. Run as "Geng --bench-obj [file.obj] [quads]".
+//
+// The speedup depends on the machine, the file size and the thread count
+// it prints: measured runs range from about 5x to 10x, and 10x was only
+// reached single-threaded at the default 1M quads.
+const size_t OBJ_BENCHMARK_QUADS = 1000000;
+
+bool WriteSyntheticObj(const std::string& path, size_t quads);
+bool RunObjBenchmark(const std::string& path, size_t quads = OBJ_BENCHMARK_QUADS);
@@ -0,0 +1,213 @@
+// PixelUploadRing.cpp
+#include "PixelUploadRing.h"
+#include <cstdint>
+#include <cstring>
+
+// Offsets stay aligned for any pixel type and GL_UNPACK_ALIGNMENT
+static const size_t STAGE_ALIGNMENT = 16;
+static const GLuint64 FENCE_WAIT_NS = 100000000;
+
+PixelUploadRing& PixelUploadRing::Shared() {
+    static PixelUploadRing ring;
+    return ring;
+}
+
+const void* PixelUploadRing::Stage(const void* pixels, size_t size) {
+    FenceStaged();
+    // Copied by a batch already; ReleaseBatch fences it
+    auto copy = copies.find(pixels);
+    if (copy != copies.end() && copy->second.end - copy->second.begin == size) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, copyBuffer);
+        stats.copiedBytes += size;
+        return reinterpret_cast<const void*>(uintptr_t(copy->second.begin));
+    }
+    if (!pixels || size == 0 || size > RING_BYTES) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        stats.directBytes += size;
+        return pixels;
+    }
+
+    if (!buffer) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(RING_BYTES), nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+
+    size_t begin = (head + STAGE_ALIGNMENT - 1) & ~(STAGE_ALIGNMENT - 1);
+    if (begin + size > RING_BYTES) begin = 0;
+    if (WaitForRange(regions, begin, begin + size)) ++stats.waits;
+
+    // Unsynchronized: WaitForRange already made sure the GPU is done with it
+    void* target = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, GLintptr(begin), GLsizeiptr(size),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    bool copied = false;
+    if (target) {
+        std::memcpy(target, pixels, size);
+        copied = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    }
+    if (!copied) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        stats.directBytes += size;
+        return pixels;
+    }
+
+    head = begin + size;
+    staged.begin = begin;
+    staged.end = head;
+    hasStaged = true;
+    stats.stagedBytes += size;
+    return reinterpret_cast<const void*>(uintptr_t(begin));
+}
+
+void PixelUploadRing::Finish() {
+    FenceStaged();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool PixelUploadRing::MapBatch(PixelCopyBatch& batch) {
+    if (copyBusy || batch.sources.empty()) return false;
+
+    // Laid out as Stage would, from the copy ring's head
+    batch.offsets.clear();
+    size_t offset = (copyHead + STAGE_ALIGNMENT - 1) & ~(STAGE_ALIGNMENT - 1);
+    size_t first = offset;
+    for (const auto& source : batch.sources) {
+        offset = (offset + STAGE_ALIGNMENT - 1) & ~(STAGE_ALIGNMENT - 1);
+        batch.offsets.push_back(offset);
+        offset += source.second;
+    }
+    if (offset > RING_BYTES) {
+        // Start over from the beginning of the ring
+        if (offset - first > RING_BYTES) return false;
+        for (size_t& sourceOffset : batch.offsets) sourceOffset -= first;
+        offset -= first;
+        first = 0;
+    }
+
+    if (!copyBuffer) {
+        glGenBuffers(1, &copyBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, copyBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(RING_BYTES), nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, copyBuffer);
+    if (WaitForRange(copyRegions, first, offset)) ++stats.waits;
+    void* target = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, GLintptr(first), GLsizeiptr(offset - first),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!target) return false;
+
+    batch.data = static_cast<unsigned char*>(target);
+    batch.begin = first;
+    batch.end = offset;
+    copyHead = offset;
+    copyBusy = true;
+    std::lock_guard<std::mutex> lock(copyMutex);
+    copyBatch = &batch;
+    copied = false;
+    return true;
+}
+
+void PixelUploadRing::CopyBatch(const PixelCopyBatch& batch) {
+    {
+        std::lock_guard<std::mutex> lock(copyMutex);
+        if (&batch != copyBatch || copied) return;
+        copying = true;
+    }
+    for (size_t i = 0; i < batch.sources.size(); ++i) {
+        std::memcpy(batch.data + (batch.offsets[i] - batch.begin), batch.sources[i].first, batch.sources[i].second);
+    }
+    {
+        std::lock_guard<std::mutex> lock(copyMutex);
+        copying = false;
+        copied = true;
+    }
+    copyDone.notify_all();
+}
+
+bool PixelUploadRing::CloseCopyWindow() {
+    std::unique_lock<std::mutex> lock(copyMutex);
+    copyDone.wait(lock, [this]() { return !copying; });
+    copyBatch = nullptr;
+    return copied;
+}
+
+bool PixelUploadRing::UnmapBatch(PixelCopyBatch& batch) {
+    if (!batch.data) return false;
+    bool wasCopied = CloseCopyWindow();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, copyBuffer);
+    bool kept = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    batch.data = nullptr;
+    if (!kept || !wasCopied) return false;
+    for (size_t i = 0; i < batch.sources.size(); ++i) {
+        Region& copy = copies[batch.sources[i].first];
+        copy.begin = batch.offsets[i];
+        copy.end = batch.offsets[i] + batch.sources[i].second;
+    }
+    return true;
+}
+
+void PixelUploadRing::ReleaseBatch(PixelCopyBatch& batch) {
+    if (batch.data) UnmapBatch(batch);    // never uploaded from
+    Finish();
+    if (batch.end > batch.begin) {
+        Region region;
+        region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region.begin = batch.begin;
+        region.end = batch.end;
+        copyRegions.push_back(region);
+    }
+    copies.clear();
+    copyBusy = false;
+    batch.begin = batch.end = 0;
+}
+
+void PixelUploadRing::Release() {
+    CloseCopyWindow();
+    Finish();
+    for (const auto& region : regions) {
+        glDeleteSync(region.fence);
+    }
+    for (const auto& region : copyRegions) {
+        glDeleteSync(region.fence);
+    }
+    regions.clear();
+    copyRegions.clear();
+    copies.clear();
+    if (buffer) glDeleteBuffers(1, &buffer);
+    if (copyBuffer) glDeleteBuffers(1, &copyBuffer);     // unmaps a batch still held, no longer copied into
+    buffer = copyBuffer = 0;
+    head = copyHead = 0;
+    copyBusy = false;
+}
+
+void PixelUploadRing::FenceStaged() {
+    if (!hasStaged) return;
+    staged.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    regions.push_back(staged);
+    hasStaged = false;
+}
+
+// Returns whether it had to wait.
+bool PixelUploadRing::WaitForRange(std::deque<Region>& inFlight, size_t begin, size_t end) {
+    bool waited = false;
+    for (auto it = inFlight.begin(); it != inFlight.end(); ) {
+        bool overlaps = it->begin < end && begin < it->end;
+        // Signaled fences are dropped on the way, overlapping or not
+        GLenum status = glClientWaitSync(it->fence, 0, 0);
+        if (overlaps) {
+            while (status == GL_TIMEOUT_EXPIRED) {
+                waited = true;
+                status = glClientWaitSync(it->fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_NS);
+            }
+        }
+        if (status == GL_TIMEOUT_EXPIRED) {
+            ++it;
+            continue;
+        }
+        glDeleteSync(it->fence);
+        it = inFlight.erase(it);
+    }
+    return waited;
+}
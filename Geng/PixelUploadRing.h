@@ -0,0 +1,117 @@
+// PixelUploadRing.h
+#pragma once
+#include <glad/glad.h>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Staging memory for texture uploads. Pixels are copied into a ring of
+// GL_PIXEL_UNPACK_BUFFER memory and glTex(Sub)Image reads them from there,
+// so the call returns as soon as the copy is queued and the transfer
+// overlaps with rendering, instead of the driver copying (or waiting) on the
+// spot. Every staged range is fenced after the call that reads it, and ring
+// space is only written again once the GPU has passed that fence.
+//
+//     const void* source = PixelUploadRing::Shared().Stage(pixels, size);
+//     glTexImage2D(..., source);
+//     PixelUploadRing::Shared().Finish();
+//
+// Stage still copies on the GL thread. A loader with many uploads ahead of
+// it can move the copies out with a PixelCopyBatch on a second ring:
+// MapBatch on the GL thread, CopyBatch on any thread, UnmapBatch on the GL
+// thread. Until ReleaseBatch, Stage hands out the copies for the batch's
+// sources instead of copying them again. Model::LoadAsync and ReloadAsync
+// do this; the synchronous loaders (loadTexture, Skybox, Model::Load) and
+// lazy textures, which upload a couple per frame, still copy in Stage.
+//
+// GL thread only, apart from CopyBatch.
+struct PixelCopyBatch {
+    std::vector<std::pair<const void*, size_t>> sources;   // filled in by the caller
+    std::vector<size_t> offsets;    // of each source, from the start of the ring
+    unsigned char* data = nullptr;  // mapped at offsets[0] while the batch is mapped
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+class PixelUploadRing {
+public:
+    static PixelUploadRing& Shared();
+
+    static const size_t RING_BYTES = 32 << 20;
+
+    // Copies 'size' bytes into the ring and leaves it bound to
+    // GL_PIXEL_UNPACK_BUFFER. Returns what to pass as the pixels argument of
+    // the next glTex(Sub)Image call: an offset into the ring, or 'pixels'
+    // itself with nothing bound when it is null or does not fit.
+    const void* Stage(const void* pixels, size_t size);
+
+    // Fences the uploads staged since the last Finish and unbinds the ring.
+    void Finish();
+
+    // Lays out batch.sources in the copy ring and maps them. False, leaving
+    // the batch unmapped, when another batch holds the ring, the sources do
+    // not fit or mapping fails; the caller then uploads with Stage.
+    bool MapBatch(PixelCopyBatch& batch);
+    // Fills a mapped batch from its sources. Any thread. Does nothing once
+    // the batch is unmapped or the ring released, so a copy still queued
+    // when the context goes away never writes to freed memory.
+    void CopyBatch(const PixelCopyBatch& batch);
+    // Unmaps the batch, after waiting for a CopyBatch still running; from
+    // here Stage returns the copies. False when the driver lost the contents
+    // or the batch was never copied, in which case Stage copies as usual.
+    bool UnmapBatch(PixelCopyBatch& batch);
+    // After the last upload that reads the batch: fences it and frees the
+    // copy ring for the next one.
+    void ReleaseBatch(PixelCopyBatch& batch);
+
+    // Deletes the buffers and fences while the context is still current,
+    // waiting for a CopyBatch still writing to the mapped copy ring.
+    void Release();
+
+    struct Stats {
+        size_t stagedBytes = 0;
+        size_t directBytes = 0;     // too large for the ring, or mapping failed
+        size_t copiedBytes = 0;     // staged by a PixelCopyBatch, off the GL thread
+        size_t waits = 0;           // Stage or MapBatch calls that had to wait for the GPU
+    };
+    Stats GetStats() const { return stats; }
+
+private:
+    struct Region {
+        GLsync fence = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    void FenceStaged();
+    bool WaitForRange(std::deque<Region>& inFlight, size_t begin, size_t end);
+    // Ends the window in which CopyBatch may write to the mapped batch, once
+    // a copy in progress is done. Returns whether the batch was copied.
+    bool CloseCopyWindow();
+
+    GLuint buffer = 0;
+    size_t head = 0;
+    Region staged;                  // read by the last glTex call; fenced on the next Stage or Finish
+    bool hasStaged = false;
+    std::deque<Region> regions;     // in flight, oldest first
+
+    // The copy ring, which only one batch holds at a time
+    GLuint copyBuffer = 0;
+    size_t copyHead = 0;
+    std::deque<Region> copyRegions;
+    bool copyBusy = false;
+    std::unordered_map<const void*, Region> copies;     // source -> its copy, once unmapped
+
+    // Shared with the thread running CopyBatch
+    std::mutex copyMutex;
+    std::condition_variable copyDone;
+    const PixelCopyBatch* copyBatch = nullptr;  // the mapped batch, while it may be copied into
+    bool copying = false;
+    bool copied = false;
+
+    Stats stats;
+};
@@ -1,9 +1,19 @@
 #include "Skybox.h"
-#include <stb_image.h>
+#include "ImageDecoder.h"
+#include "LoadReport.h"
+#include "MipCache.h"
+#include "PixelUploadRing.h"
+#include "TextureCache.h"
 #include <iostream>
 
 Skybox::Skybox(const std::vector<std::string>& faces, unsigned int shaderID) : shader(shaderID) {
-    cubemapTexture = loadCubemap(faces);
+    // Shared like 2D textures, under a name built from all six faces
+    std::string key = "cubemap:";
+    for (const auto& face : faces) key += face + "|";
+    cubemapTexture = TextureCache::Shared().Acquire(key);
+    if (!cubemapTexture) {
+        cubemapTexture = TextureCache::Shared().AcquireOrCreate(key, 0, [&]() { return loadCubemap(faces); });
+    }
 
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
@@ -20,19 +30,36 @@ unsigned int Skybox::loadCubemap(const std::vector<std::string>& faces) {
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(false);
+    LoadTimer totalTimer;
+    AssetLoadRecord record;
+    record.kind = "Cubemap";
+    record.path = faces.empty() ? std::string() : faces[0];
+
+    // All six faces are read and decoded at once; cube map faces are not flipped.
+    // ioMs and parseMs add up the faces, so they can exceed the wall time.
+    std::vector<std::shared_ptr<DecodedImage>> images = DecodeImageFiles(faces, false);
+    LoadTimer timer;
+    // stb rows are tightly packed, and a staged face must not be read past its end
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     for (unsigned int i = 0; i < faces.size(); i++) {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
+        const DecodedImage& image = *images[i];
+        record.ioMs += image.ioMs;
+        record.parseMs += image.decodeMs;
+        record.bytesRead += image.fileBytes;
+        if (image.pixels) {
+            const void* source = PixelUploadRing::Shared().Stage(image.pixels,
+                size_t(image.width) * image.height * image.components);
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, TextureInternalFormat(image.components), image.width,
+                image.height, 0, TextureFormat(image.components), GL_UNSIGNED_BYTE, source);
+            record.gpuBytes += EstimateTextureBytes(image.width, image.height, image.components, false);
         }
         else {
             std::cout << "Failed to load cubemap texture at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
         }
     }
+    PixelUploadRing::Shared().Finish();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    record.uploadMs = timer.Lap();
 
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -40,6 +67,8 @@ unsigned int Skybox::loadCubemap(const std::vector<std::string>& faces) {
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
+    record.totalMs = totalTimer.Lap();
+    LoadReport::Shared().Add(record);
     return textureID;
 }
 
@@ -61,9 +90,10 @@ void Skybox::Render(const glm::mat4& view, const glm::mat4& projection) {
 }
 
 void Skybox::Cleanup() {
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteTextures(1, &cubemapTexture);
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    if (VBO) glDeleteBuffers(1, &VBO);
+    if (cubemapTexture) TextureCache::Shared().Release(cubemapTexture);
+    VAO = VBO = cubemapTexture = 0;
 }
 
 Skybox::~Skybox() {
@@ -0,0 +1,91 @@
+// TextureCache.cpp
+#include "TextureCache.h"
+#include "AssetPack.h"
+#include "TextureStreamer.h"
+#include <algorithm>
+
+TextureCache& TextureCache::Shared() {
+    static TextureCache cache;
+    return cache;
+}
+
+GLuint TextureCache::Acquire(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = byPath.find(NormalizeAssetPath(path));
+    if (found == byPath.end()) return 0;
+    ++entries[found->second].references;
+    ++sharedByPath;
+    return found->second;
+}
+
+GLuint TextureCache::AcquireOrCreate(const std::string& path, uint64_t contentHash,
+    const std::function<GLuint()>& create) {
+    std::string key = NormalizeAssetPath(path);
+    GLuint texture = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = contentHash ? byContent.find(contentHash) : byContent.end();
+        if (found != byContent.end()) {
+            texture = found->second;
+            ++sharedByContent;
+        }
+    }
+    if (!texture) {
+        texture = create();
+        if (!texture) return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[texture];
+    ++entry.references;
+    if (contentHash && !entry.contentHash) {
+        entry.contentHash = contentHash;
+        byContent[contentHash] = texture;
+    }
+    // A path whose file changed now names the new texture; the old one stays
+    // alive for whoever still holds it.
+    auto previous = byPath.find(key);
+    if (previous != byPath.end() && previous->second != texture) {
+        auto& stale = entries[previous->second].paths;
+        stale.erase(std::remove(stale.begin(), stale.end(), key), stale.end());
+    }
+    byPath[key] = texture;
+    if (std::find(entry.paths.begin(), entry.paths.end(), key) == entry.paths.end()) {
+        entry.paths.push_back(key);
+    }
+    return texture;
+}
+
+void TextureCache::Release(GLuint texture) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(texture);
+    if (found == entries.end() || --found->second.references > 0) return;
+
+    for (const auto& path : found->second.paths) {
+        byPath.erase(path);
+    }
+    auto content = byContent.find(found->second.contentHash);
+    if (content != byContent.end() && content->second == texture) {
+        byContent.erase(content);
+    }
+    entries.erase(found);
+    TextureStreamer::Shared().Forget(texture);
+    glDeleteTextures(1, &texture);
+}
+
+bool TextureCache::IsResident(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return byPath.find(NormalizeAssetPath(path)) != byPath.end();
+}
+
+TextureCache::Stats TextureCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.textures = entries.size();
+    for (const auto& entry : entries) {
+        stats.references += entry.second.references;
+    }
+    stats.sharedByPath = sharedByPath;
+    stats.sharedByContent = sharedByContent;
+    return stats;
+}
@@ -0,0 +1,58 @@
+// TextureCache.h
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide set of GL textures shared by every Model, Skybox and
+// loadTexture. A texture is found by its path (as NormalizeAssetPath spells
+// it) or by the hash of its encoded bytes, so the same image under two names
+// is uploaded once. Every Acquire adds a reference that must be dropped with
+// Release; the texture is deleted with the last one.
+//
+// Acquire, AcquireOrCreate and Release make GL calls and belong on the GL
+// thread. IsResident may be called from loader threads to skip decoding.
+class TextureCache {
+public:
+    static TextureCache& Shared();
+
+    // The texture loaded from 'path' with one more reference, or 0.
+    GLuint Acquire(const std::string& path);
+
+    // A texture whose contents hash to 'contentHash' (0 = unknown) is shared
+    // and 'path' becomes another name for it. Otherwise 'create' makes the
+    // texture. Either way the result carries one more reference; 0 if
+    // 'create' failed.
+    GLuint AcquireOrCreate(const std::string& path, uint64_t contentHash, const std::function<GLuint()>& create);
+
+    void Release(GLuint texture);
+
+    bool IsResident(const std::string& path) const;
+
+    struct Stats {
+        size_t textures = 0;
+        size_t references = 0;
+        size_t sharedByPath = 0;      // Acquire hits
+        size_t sharedByContent = 0;   // AcquireOrCreate calls that found the same bytes
+    };
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        unsigned references = 0;
+        uint64_t contentHash = 0;
+        std::vector<std::string> paths;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<GLuint, Entry> entries;
+    std::unordered_map<std::string, GLuint> byPath;
+    std::unordered_map<uint64_t, GLuint> byContent;
+    size_t sharedByPath = 0;
+    size_t sharedByContent = 0;
+};
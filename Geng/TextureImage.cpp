@@ -2,41 +2,58 @@
 #include "stb_image.h"
 
 #include "TextureImage.h"
+#include "MipCache.h"
+#include "TextureCache.h"
+#include "LoadReport.h"
 #include <glad/glad.h>
 #include <iostream>
 
 unsigned int loadTexture(const char* path) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    stbi_set_flip_vertically_on_load(true); // Add this for correct texture orientation
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (GLuint shared = TextureCache::Shared().Acquire(path)) {
+        return shared;
+    }
+
+    LoadTimer timer;
+    AssetLoadRecord record;
+    record.kind = "Texture";
+    record.path = path;
+
+    DecodedImage image;
+    DecodeImageFileMips(path, true, image); // flipped for correct texture orientation
+    record.ioMs = image.ioMs;
+    record.parseMs = image.decodeMs;
+    record.bytesRead = image.fileBytes;
+    timer.Lap();
+    int width = image.width, height = image.height, nrComponents = image.components;
+
+    unsigned int textureID = 0;
+    if (image.HasPixels()) {
+        textureID = TextureCache::Shared().AcquireOrCreate(path, image.contentHash, [&]() {
+            unsigned int created;
+            glGenTextures(1, &created);
+            glBindTexture(GL_TEXTURE_2D, created);
+            UploadImageLevels(image, ImageInternalFormat(image));
+            record.uploadMs = timer.Lap();
+            if (image.levels.empty()) {
+                glGenerateMipmap(GL_TEXTURE_2D);
+                record.mipMs = timer.Lap();
+            }
+            record.gpuBytes = EstimateTextureBytes(width, height, nrComponents, true);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            return created;
+        });
 
         std::cout << "Loaded texture: " << path << " (" << width << "x" << height << ")\n";
     }
     else {
         std::cerr << "Texture failed to load at path: " << path << std::endl;
     }
-    stbi_image_free(data);
 
+    record.totalMs = record.ioMs + record.parseMs + record.uploadMs + record.mipMs + timer.Lap();
+    LoadReport::Shared().Add(record);
     return textureID;
-}
\ No newline at end of file
+}
@@ -1,6 +1,8 @@
 #ifndef TEXTURE_IMAGE_H
 #define TEXTURE_IMAGE_H
 
+// Shared through TextureCache::Shared(): release the result with
+// TextureCache::Shared().Release(). Returns 0 if the image fails to load.
 unsigned int loadTexture(const char* filename);
 
 #endif
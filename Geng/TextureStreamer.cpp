@@ -0,0 +1,214 @@
+// TextureStreamer.cpp
+#include "TextureStreamer.h"
+#include "MipCache.h"
+#include "PixelUploadRing.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+TextureStreamer& TextureStreamer::Shared() {
+    static TextureStreamer streamer;
+    return streamer;
+}
+
+// The first level no larger than tailSize on either side.
+static size_t TailLevel(const DecodedImage& image, int tailSize) {
+    size_t level = 0;
+    while (level + 1 < image.levels.size() &&
+        (image.levels[level].width > tailSize || image.levels[level].height > tailSize)) {
+        ++level;
+    }
+    return level;
+}
+
+bool TextureStreamer::CanStream(const DecodedImage& image) const {
+    return !image.levels.empty() && TailLevel(image, settings.tailSize) > 0;
+}
+
+GLuint TextureStreamer::Create(const std::shared_ptr<DecodedImage>& image, GLenum format) {
+    Stream stream;
+    stream.image = image;
+    stream.format = format;
+    // A chain built by this load sits in levelStorage; the copy MipCache just
+    // wrote can be mapped instead, so the finer levels cost no heap
+    if (!image->levelFile.IsOpen() && image->mipCacheKey) {
+        auto mapped = std::make_shared<DecodedImage>();
+        if (OpenMipCache(image->mipCacheKey, *mapped) && mapped->levels.size() == image->levels.size() &&
+            mapped->blockFormat == image->blockFormat) {
+            mapped->path = image->path;
+            stream.image = mapped;
+        }
+    }
+    stream.tailLevel = TailLevel(*stream.image, settings.tailSize);
+    stream.residentLevel = stream.image->levels.size();     // nothing yet
+    stream.wantedLevel = stream.tailLevel;
+    stream.lastUsedFrame = frame;
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    Stream& added = streams[texture] = std::move(stream);
+    SetResidentLevel(texture, added, added.tailLevel);
+    return texture;
+}
+
+size_t TextureStreamer::ResidentBytes(GLuint texture) const {
+    auto found = streams.find(texture);
+    return found == streams.end() ? 0 : ChainBytes(found->second, found->second.residentLevel);
+}
+
+void TextureStreamer::Forget(GLuint texture) {
+    auto found = streams.find(texture);
+    if (found == streams.end()) return;
+    residentBytes -= ChainBytes(found->second, found->second.residentLevel);
+    streams.erase(found);
+    if (streams.empty()) pendingTextures = 0;
+}
+
+void TextureStreamer::Request(GLuint texture, float texels) {
+    auto found = streams.find(texture);
+    if (found == streams.end()) return;
+    Stream& stream = found->second;
+
+    const ImageLevel& full = stream.image->levels[0];
+    size_t level = 0;
+    if (texels <= 0.0f) {
+        level = stream.tailLevel;
+    }
+    else if (texels < float(std::max(full.width, full.height))) {
+        float ratio = float(std::max(full.width, full.height)) / texels;
+        level = std::min(stream.tailLevel, size_t(std::floor(std::log2(ratio))));
+    }
+    stream.wantedLevel = stream.requested ? std::min(stream.wantedLevel, level) : level;
+    stream.requested = true;
+    stream.lastUsedFrame = frame;
+}
+
+void TextureStreamer::Update() {
+    ++frame;
+    uploadedBytes = 0;
+    evictedTextures = 0;
+
+    std::vector<std::pair<GLuint, Stream*>> pending;
+    std::vector<std::pair<GLuint, Stream*>> evictable;
+    for (auto& entry : streams) {
+        Stream& stream = entry.second;
+        if (stream.requested && stream.wantedLevel < stream.residentLevel) {
+            pending.push_back({ entry.first, &stream });
+        }
+        bool idle = frame - stream.lastUsedFrame > settings.idleFrames;
+        if ((idle && stream.residentLevel < stream.tailLevel) ||
+            (stream.requested && stream.wantedLevel > stream.residentLevel)) {
+            evictable.push_back({ entry.first, &stream });
+        }
+    }
+    // Furthest from what is wanted first
+    std::sort(pending.begin(), pending.end(), [](const auto& a, const auto& b) {
+        return a.second->residentLevel - a.second->wantedLevel > b.second->residentLevel - b.second->wantedLevel;
+    });
+    // Idle textures before ones drawn small, least recently drawn first
+    std::sort(evictable.begin(), evictable.end(), [](const auto& a, const auto& b) {
+        if (a.second->requested != b.second->requested) return !a.second->requested;
+        return a.second->lastUsedFrame < b.second->lastUsedFrame;
+    });
+
+    size_t nextEvictable = 0;
+    auto makeRoom = [&](size_t bytes) {
+        while (residentBytes + bytes > settings.residentBudgetBytes && nextEvictable < evictable.size()) {
+            auto& victim = evictable[nextEvictable++];
+            size_t level = victim.second->requested ? victim.second->wantedLevel : victim.second->tailLevel;
+            SetResidentLevel(victim.first, *victim.second, level);
+            ++evictedTextures;
+        }
+        return residentBytes + bytes <= settings.residentBudgetBytes;
+    };
+
+    makeRoom(0);
+    for (auto& entry : pending) {
+        Stream& stream = *entry.second;
+        size_t current = ChainBytes(stream, stream.residentLevel);
+        // The finest wanted level this frame's upload budget covers; one step
+        // always goes through when nothing has been uploaded yet
+        size_t remaining = settings.uploadBytesPerFrame - std::min(uploadedBytes, settings.uploadBytesPerFrame);
+        size_t level = stream.wantedLevel;
+        while (level + 1 < stream.residentLevel && ChainBytes(stream, level) > remaining) {
+            ++level;
+        }
+        if (uploadedBytes > 0 && ChainBytes(stream, level) > remaining) continue;
+        // Coarser again until it fits the memory budget
+        while (level < stream.residentLevel && !makeRoom(ChainBytes(stream, level) - current)) {
+            ++level;
+        }
+        if (level == stream.residentLevel) continue;
+        SetResidentLevel(entry.first, stream, level);
+        uploadedBytes += ChainBytes(stream, level);
+    }
+
+    pendingTextures = 0;
+    for (auto& entry : streams) {
+        if (entry.second.requested && entry.second.wantedLevel < entry.second.residentLevel) ++pendingTextures;
+        entry.second.requested = false;
+    }
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const {
+    Stats stats;
+    stats.textures = streams.size();
+    stats.residentBytes = residentBytes;
+    stats.uploadedBytes = uploadedBytes;
+    stats.evictedTextures = evictedTextures;
+    stats.pendingTextures = pendingTextures;
+    for (const auto& entry : streams) {
+        stats.fullBytes += ChainBytes(entry.second, 0);
+    }
+    return stats;
+}
+
+size_t TextureStreamer::ChainBytes(const Stream& stream, size_t firstLevel) const {
+    size_t bytes = 0;
+    for (size_t i = firstLevel; i < stream.image->levels.size(); ++i) {
+        bytes += stream.image->levels[i].size;
+    }
+    return bytes;
+}
+
+// Re-specifies 'texture' as levels 'level' and coarser of its chain. Levels
+// past the new range are shrunk to nothing so their memory goes too.
+void TextureStreamer::SetResidentLevel(GLuint texture, Stream& stream, size_t level) {
+    const std::vector<ImageLevel>& levels = stream.image->levels;
+    if (level == stream.residentLevel) return;
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    PixelUploadRing& ring = PixelUploadRing::Shared();
+    const bool compressed = stream.image->blockFormat != BlockFormat::None;
+    const GLenum clientFormat = TextureFormat(stream.image->components);
+    for (size_t i = level; i < levels.size(); ++i) {
+        const void* source = ring.Stage(levels[i].pixels, levels[i].size);
+        if (compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, GLint(i - level), stream.format, levels[i].width,
+                levels[i].height, 0, GLsizei(levels[i].size), source);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, GLint(i - level), stream.format, levels[i].width, levels[i].height, 0,
+                clientFormat, GL_UNSIGNED_BYTE, source);
+        }
+    }
+    ring.Finish();
+    size_t count = levels.size() - level;
+    size_t previousCount = levels.size() - std::min(stream.residentLevel, levels.size());
+    for (size_t i = count; i < previousCount; ++i) {
+        if (compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, GLint(i), stream.format, 0, 0, 0, 0, nullptr);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, GLint(i), stream.format, 0, 0, 0, clientFormat, GL_UNSIGNED_BYTE,
+                nullptr);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(count - 1));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    residentBytes -= ChainBytes(stream, stream.residentLevel);
+    residentBytes += ChainBytes(stream, level);
+    stream.residentLevel = level;
+}
@@ -0,0 +1,88 @@
+// TextureStreamer.h
+#pragma once
+#include "ImageDecoder.h"
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+// Keeps only the mip levels a texture is drawn at in GL memory. A streamed
+// texture starts as the coarse tail of its mip chain; renderers report each
+// frame how many texels they need across the texture, and Update re-uploads
+// finer levels from the chain (mapped from MipCache) under a per-frame byte
+// budget. When resident levels exceed the memory budget, textures that were
+// not drawn recently, then textures drawn smaller than they are held, fall
+// back toward their tail.
+//
+// GL 3.3 has no sparse or immutable storage, so a texture's level 0 is
+// always its finest resident level and a level change re-specifies the
+// whole range. The texture name stays the same, so TextureCache and Models
+// keep pointing at it. Everything here runs on the GL thread.
+class TextureStreamer {
+public:
+    static TextureStreamer& Shared();
+
+    struct Settings {
+        size_t uploadBytesPerFrame = 4 << 20;
+        size_t residentBudgetBytes = 256 << 20;
+        int tailSize = 64;              // largest side the first upload keeps
+        unsigned idleFrames = 120;      // undrawn this long, a texture may be evicted
+    };
+    Settings settings;
+
+    // Whether 'image' has the mip chain streaming needs and is larger than
+    // its tail.
+    bool CanStream(const DecodedImage& image) const;
+
+    // Creates a texture holding the tail of image->levels and keeps the
+    // image to stream the rest from. 'format' is the internal format,
+    // compressed when the image is. The caller sets sampling parameters.
+    GLuint Create(const std::shared_ptr<DecodedImage>& image, GLenum format);
+
+    // GL memory held for 'texture', or 0 if it is not streamed.
+    size_t ResidentBytes(GLuint texture) const;
+
+    // The texture is about to be deleted.
+    void Forget(GLuint texture);
+
+    // 'texels' across the texture's width would be enough for one draw this
+    // frame. Does nothing for textures that are not streamed.
+    void Request(GLuint texture, float texels);
+
+    // Once per frame: uploads toward this frame's requests and evicts down to
+    // the budget.
+    void Update();
+
+    struct Stats {
+        size_t textures = 0;
+        size_t residentBytes = 0;
+        size_t fullBytes = 0;           // if every streamed texture held its whole chain
+        // Last Update
+        size_t pendingTextures = 0;     // drawn needing finer levels than they hold afterwards
+        size_t uploadedBytes = 0;
+        size_t evictedTextures = 0;
+    };
+    Stats GetStats() const;
+
+private:
+    struct Stream {
+        std::shared_ptr<DecodedImage> image;
+        GLenum format = GL_RGB8;
+        size_t residentLevel = 0;       // finest level in GL memory
+        size_t tailLevel = 0;
+        size_t wantedLevel = 0;         // finest level requested this frame
+        bool requested = false;
+        uint64_t lastUsedFrame = 0;
+    };
+
+    size_t ChainBytes(const Stream& stream, size_t firstLevel) const;
+    void SetResidentLevel(GLuint texture, Stream& stream, size_t level);
+
+    std::unordered_map<GLuint, Stream> streams;
+    uint64_t frame = 0;
+    size_t residentBytes = 0;
+    size_t pendingTextures = 0;
+    size_t uploadedBytes = 0;
+    size_t evictedTextures = 0;
+};
@@ -0,0 +1,100 @@
+// ThreadPool.cpp
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+std::future<void> ThreadPool::Submit(std::function<void()> job) {
+    std::packaged_task<void()> task(std::move(job));
+    std::future<void> result = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(task));
+    }
+    wake.notify_one();
+    return result;
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) return;
+            task = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn, unsigned maxThreads) {
+    if (count == 0) return;
+
+    // Helpers that are still queued when the caller runs out of work must not
+    // touch fn any more, so they check 'closed' before joining in.
+    struct State {
+        std::atomic<size_t> next{ 0 };
+        std::mutex mutex;
+        std::condition_variable done;
+        int running = 0;
+        bool closed = false;
+    };
+    auto state = std::make_shared<State>();
+    const std::function<void(size_t)>* body = &fn;
+
+    auto drain = [state, body, count]() {
+        for (size_t i = state->next++; i < count; i = state->next++) {
+            (*body)(i);
+        }
+    };
+
+    unsigned helpers = maxThreads == 0 ? Size() : std::min(Size(), maxThreads - 1);
+    helpers = unsigned(std::min<size_t>(helpers, count - 1));
+    for (unsigned h = 0; h < helpers; ++h) {
+        Submit([state, drain]() {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->closed) return;
+                ++state->running;
+            }
+            drain();
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                --state->running;
+            }
+            state->done.notify_all();
+        });
+    }
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->closed = true;
+    state->done.wait(lock, [&] { return state->running == 0; });
+}
+
+ThreadPool& ThreadPool::Shared() {
+    static ThreadPool pool;
+    return pool;
+}
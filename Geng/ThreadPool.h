@@ -0,0 +1,41 @@
+// ThreadPool.h
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from one FIFO queue. Loaders share the
+// process-wide instance from ThreadPool::Shared().
+class ThreadPool {
+public:
+    // threadCount == 0 uses one worker per hardware thread
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::future<void> Submit(std::function<void()> job);
+
+    // Runs fn(0..count-1) across at most maxThreads threads (0 = all) and
+    // returns when every call has finished. The calling thread takes part, so
+    // this is safe to call from inside a job.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& fn, unsigned maxThreads = 0);
+
+    unsigned Size() const { return unsigned(workers.size()); }
+
+    static ThreadPool& Shared();
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::packaged_task<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
@@ -0,0 +1,63 @@
+// VertexPacking.cpp
+#include "VertexPacking.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void PackVertices(const Vertex* vertices, size_t count, std::vector<PackedVertex>& packed,
+    glm::vec3& offset, glm::vec3& scale, PackingError& error) {
+    packed.resize(count);
+    error = PackingError();
+    if (count == 0) {
+        offset = glm::vec3(0.0f);
+        scale = glm::vec3(1.0f);
+        return;
+    }
+
+    glm::vec3 minPos(std::numeric_limits<float>::max());
+    glm::vec3 maxPos(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < count; ++i) {
+        minPos = glm::min(minPos, vertices[i].position);
+        maxPos = glm::max(maxPos, vertices[i].position);
+    }
+    offset = minPos;
+    scale = maxPos - minPos;
+
+    for (size_t i = 0; i < count; ++i) {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& out = packed[i];
+
+        glm::vec3 restored;
+        for (int axis = 0; axis < 3; ++axis) {
+            float t = scale[axis] > 0.0f ? (vertex.position[axis] - offset[axis]) / scale[axis] : 0.0f;
+            uint16_t q = uint16_t(std::lround(glm::clamp(t, 0.0f, 1.0f) * 65535.0f));
+            out.position[axis] = q;
+            restored[axis] = offset[axis] + (float(q) / 65535.0f) * scale[axis];
+        }
+        out.position[3] = 0;
+
+        // Matches GL_INT_2_10_10_10_REV: x in the low bits, w unused
+        glm::vec3 normal = vertex.normal;
+        float length = glm::length(normal);
+        normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        out.normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+
+        uint32_t uv = glm::packHalf2x16(vertex.texCoord);
+        out.texCoord[0] = uint16_t(uv & 0xFFFFu);
+        out.texCoord[1] = uint16_t(uv >> 16);
+
+        error.position = std::max(error.position, glm::length(restored - vertex.position));
+
+        glm::vec3 restoredNormal = glm::vec3(glm::unpackSnorm3x10_1x2(out.normal));
+        float restoredLength = glm::length(restoredNormal);
+        if (restoredLength > 0.0f) {
+            float cosAngle = glm::clamp(glm::dot(normal, restoredNormal / restoredLength), -1.0f, 1.0f);
+            error.normalDegrees = std::max(error.normalDegrees, glm::degrees(std::acos(cosAngle)));
+        }
+
+        glm::vec2 restoredUv = glm::unpackHalf2x16(uv);
+        glm::vec2 uvDelta = glm::abs(restoredUv - vertex.texCoord);
+        error.texCoord = std::max(error.texCoord, std::max(uvDelta.x, uvDelta.y));
+    }
+}
@@ -0,0 +1,11 @@
+// VertexPacking.h
+#pragma once
+#include "model_loader.h"
+#include <vector>
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+// Quantizes 'count' vertices into PackedVertex. 'offset' and 'scale' receive
+// the mesh bounds the vertex shader needs to restore positions.
+void PackVertices(const Vertex* vertices, size_t count, std::vector<PackedVertex>& packed,
+    glm::vec3& offset, glm::vec3& scale, PackingError& error);
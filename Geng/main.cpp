@@ -26,6 +26,14 @@ using namespace std;
 #include "CallBacks.h"
 #include "model_loader.h"
 #include "Skybox.h"
+#include "GpuUploadQueue.h"
+#include "AssetPack.h"
+#include "LoadReport.h"
+#include "FileWatcher.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "PixelUploadRing.h"
+#include "ObjBenchmark.h"
 
 // ================== Globals ==================
 float deltaTime = 0.0f;
@@ -56,6 +64,13 @@ glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
 Transformations transformer;
 Model AirPlane;
 Model TestLevel;
+GpuUploadQueue uploadQueue;
+FileWatcher assetWatcher;
+float UploadBudgetMs = 4.0f;
+int TextureBudgetMB = 256;
+int TextureStreamKBPerFrame = 4096;
+float LodPixelError = 1.0f;
+bool ShowLoadReport = false;
 
 glm::vec3 AirPlanePos = glm::vec3(0.0f, 0.0f, 0.0f);
 glm::vec3 CameraOffset = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -115,7 +130,20 @@ void processInput(GLFWwindow* window) {
 
 
 // ================== Main ==================
-int main() {
+int main(int argc, char** argv) {
+    // "Geng --pack out.gpak <files...>" builds an asset pack and exits
+    if (argc > 2 && std::string(argv[1]) == "--pack") {
+        return WriteAssetPack(argv[2], std::vector<std::string>(argv + 3, argv + argc)) ? 0 : 1;
+    }
+    // "Geng --bench-obj [file.obj] [quads]" times OBJ loading and exits
+    if (argc > 1 && std::string(argv[1]) == "--bench-obj") {
+        std::string path = argc > 2 ? argv[2] : "bench.obj";
+        size_t quads = argc > 3 ? size_t(std::stoull(argv[3])) : OBJ_BENCHMARK_QUADS;
+        return RunObjBenchmark(path, quads) ? 0 : 1;
+    }
+    // Optional: anything missing from the pack is read as a loose file
+    MountAssetPack("assets.gpak");
+
     // GLFW Init
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -152,15 +180,27 @@ int main() {
         glm::vec3(100.0f,  100.0f, 100.0f)
     };
 
-    if (!AirPlane.Load("Plane.obj")) {
-        std::cerr << "Failed to load model" << std::endl;
-        return -1;
-    }
-
-    if (!TestLevel.Load("TestLevel.obj")) {
-        std::cerr << "Failed to load model" << std::endl;
-        return -1;
-    }
+    ModelLoadOptions planeOptions;
+    planeOptions.lodLevels = 3;
+    planeOptions.streamTextures = true;
+    planeOptions.textureCompression = TextureCompression::High;
+    ModelLoadHandle airPlaneLoad = AirPlane.LoadAsync("Plane.obj", uploadQueue, planeOptions);
+    // The level is cut into clusters so the parts off screen can be culled
+    // and simplified on their own
+    ModelLoadOptions levelOptions;
+    levelOptions.clusterMaxTriangles = 4096;
+    levelOptions.lodLevels = 3;
+    levelOptions.residency = GeometryResidency::PositionsOnly;
+    // The level's small tiling textures go into arrays up front
+    levelOptions.lazyTextures = false;
+    levelOptions.arrayTextureMaxSize = 256;
+    levelOptions.streamTextures = true;
+    // Many large tiling textures: quicker to encode on first run
+    levelOptions.textureCompression = TextureCompression::Fast;
+    ModelLoadHandle testLevelLoad = TestLevel.LoadAsync("TestLevel.obj", uploadQueue, levelOptions);
+    // Edited models, MTLs and textures are reloaded while running
+    std::vector<ModelLoadHandle> reloads;
+    bool assetsWatched = false;
 
     for (const auto& pos : pointLightPositions) {
         std::cout << "Light position: " << pos.x << ", " << pos.y << ", " << pos.z << std::endl;
@@ -245,6 +285,51 @@ int main() {
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // Finish model loads: GPU uploads are spread over frames under a budget
+        uploadQueue.Drain(UploadBudgetMs);
+        // Texture levels for what last frame drew
+        TextureStreamer& streamer = TextureStreamer::Shared();
+        streamer.settings.residentBudgetBytes = size_t(TextureBudgetMB) << 20;
+        streamer.settings.uploadBytesPerFrame = size_t(TextureStreamKBPerFrame) << 10;
+        streamer.Update();
+        if (airPlaneLoad->GetStatus() == ModelLoadTask::Status::Failed ||
+            testLevelLoad->GetStatus() == ModelLoadTask::Status::Failed) {
+            std::cerr << "Failed to load model" << std::endl;
+            glfwSetWindowShouldClose(window, true);
+        }
+        if (!airPlaneLoad->IsFinished() || !testLevelLoad->IsFinished()) {
+            ImGui::Begin("Loading");
+            ImGui::ProgressBar(airPlaneLoad->Progress(), ImVec2(-1.0f, 0.0f), "Plane.obj");
+            ImGui::ProgressBar(testLevelLoad->Progress(), ImVec2(-1.0f, 0.0f), "TestLevel.obj");
+            ImGui::Text("Pending GPU uploads: %d", int(uploadQueue.Pending()));
+            ImGui::End();
+        }
+
+        // Hot reload. Files are registered once both loads are done, and again
+        // after each reload since that can bring in new textures.
+        bool rewatch = !assetsWatched && airPlaneLoad->GetStatus() == ModelLoadTask::Status::Done &&
+            testLevelLoad->GetStatus() == ModelLoadTask::Status::Done;
+        for (auto it = reloads.begin(); it != reloads.end(); ) {
+            if (!(*it)->IsFinished()) {
+                ++it;
+                continue;
+            }
+            rewatch = true;
+            it = reloads.erase(it);
+        }
+        if (rewatch) {
+            assetWatcher.Watch(AirPlane.WatchedFiles());
+            assetWatcher.Watch(TestLevel.WatchedFiles());
+            assetsWatched = true;
+        }
+        for (const auto& changed : assetWatcher.TakeChanges()) {
+            for (Model* model : { &AirPlane, &TestLevel }) {
+                if (ModelLoadHandle reload = model->ReloadAsync(changed, uploadQueue)) {
+                    reloads.push_back(reload);
+                }
+            }
+        }
+
 
         // Matrices
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 1980.0f / 1080.0f, 0.01f, 100.0f);
@@ -277,7 +362,8 @@ int main() {
         glUniformMatrix4fv(glGetUniformLocation(lightingShader, "model"), 1, GL_FALSE, glm::value_ptr(modelAirplane));
 
         // Render Cube
-        AirPlane.Render(lightingShader);
+        AirPlane.lodPixelError = LodPixelError;
+        AirPlane.Render(lightingShader, projection * view * modelAirplane);
 
         glm::mat4 modelTestLevel = glm::mat4(1.0f);
 
@@ -287,7 +373,8 @@ int main() {
         glUniformMatrix4fv(glGetUniformLocation(lightingShader, "model"), 1, GL_FALSE, glm::value_ptr(modelTestLevel));
 
 
-        TestLevel.Render(lightingShader);
+        TestLevel.lodPixelError = LodPixelError;
+        TestLevel.Render(lightingShader, projection * view * modelTestLevel);
 
         glUniform1f(glGetUniformLocation(lightingShader, "FogIntensity"), FogIntensity);
         glUniform3f(glGetUniformLocation(lightingShader, "fogColor"), FogColor[0], FogColor[1], FogColor[2]);
@@ -348,8 +435,83 @@ int main() {
         ImGui::Text("Fog");
         ImGui::SliderFloat("Fog Intensity", &FogIntensity, 0.1f, 5.0f);
         ImGui::ColorEdit3("Fog Color", FogColor);
+        ImGui::Text("Loading");
+        ImGui::SliderFloat("Upload Budget (ms)", &UploadBudgetMs, 0.5f, 16.0f);
+        ImGui::SliderInt("Texture Budget (MB)", &TextureBudgetMB, 16, 1024);
+        ImGui::SliderInt("Texture Streaming (KB/frame)", &TextureStreamKBPerFrame, 256, 16384);
+        TextureStreamer::Stats streamStats = TextureStreamer::Shared().GetStats();
+        ImGui::Text("Streamed: %d textures, %.1f of %.1f MB resident, %d want more",
+            int(streamStats.textures), streamStats.residentBytes / 1048576.0, streamStats.fullBytes / 1048576.0,
+            int(streamStats.pendingTextures));
+        PixelUploadRing::Stats ringStats = PixelUploadRing::Shared().GetStats();
+        ImGui::Text("Staged uploads: %.1f MB, %.1f MB copied by loaders, %.1f MB direct, %d waits",
+            ringStats.stagedBytes / 1048576.0, ringStats.copiedBytes / 1048576.0,
+            ringStats.directBytes / 1048576.0, int(ringStats.waits));
+        ImGui::Checkbox("Load Report", &ShowLoadReport);
+        TextureCache::Stats textureStats = TextureCache::Shared().GetStats();
+        ImGui::Text("Textures: %d (%d refs), reused %d by path, %d by content", int(textureStats.textures),
+            int(textureStats.references), int(textureStats.sharedByPath), int(textureStats.sharedByContent));
+        ImGui::Text("Culling");
+        ImGui::Text("Level: %d drawn, %d culled", int(TestLevel.renderStats.drawnMeshes),
+            int(TestLevel.renderStats.culledMeshes));
+        ImGui::Text("Waiting for textures: %d meshes",
+            int(AirPlane.renderStats.placeholderMeshes + TestLevel.renderStats.placeholderMeshes));
+        ImGui::Text("Texture binds: %d", int(AirPlane.renderStats.textureBinds + TestLevel.renderStats.textureBinds));
+        ImGui::Text("LOD");
+        ImGui::SliderFloat("LOD Pixel Error", &LodPixelError, 0.25f, 8.0f);
+        const char* lodNames[] = { "Plane", "Level" };
+        const Model* lodModels[] = { &AirPlane, &TestLevel };
+        for (int i = 0; i < 2; ++i) {
+            const ModelRenderStats& drawn = lodModels[i]->renderStats;
+            ImGui::Text("%s: %d of %d triangles", lodNames[i], int(drawn.drawnTriangles), int(drawn.fullTriangles));
+            ImGui::Text("  meshes per LOD: %d / %d / %d / %d / %d", int(drawn.lodMeshes[0]), int(drawn.lodMeshes[1]),
+                int(drawn.lodMeshes[2]), int(drawn.lodMeshes[3]), int(drawn.lodMeshes[4]));
+        }
         ImGui::End();
 
+        if (ShowLoadReport) {
+            ImGui::Begin("Load Report", &ShowLoadReport);
+            const char* columns[] = { "Asset", "Kind", "Total ms", "I/O ms", "Parse ms", "Mips ms", "Upload ms", "Read KB", "GPU KB" };
+            if (ImGui::BeginTable("loads", 9, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable)) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                for (const char* column : columns) ImGui::TableSetupColumn(column);
+                ImGui::TableHeadersRow();
+
+                AssetLoadRecord total;
+                for (const auto& record : LoadReport::Shared().Records()) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::TextUnformatted(record.path.c_str());
+                    ImGui::TableNextColumn(); ImGui::Text("%s%s", record.kind.c_str(), record.fromCache ? " (cached)" : "");
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", record.totalMs);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", record.ioMs);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", record.parseMs);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", record.mipMs);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f", record.uploadMs);
+                    ImGui::TableNextColumn(); ImGui::Text("%d", int(record.bytesRead / 1024));
+                    ImGui::TableNextColumn(); ImGui::Text("%d", int(record.gpuBytes / 1024));
+                    // Models already include their textures' wall time, so only the phases add up
+                    total.ioMs += record.ioMs;
+                    total.parseMs += record.parseMs;
+                    total.mipMs += record.mipMs;
+                    total.uploadMs += record.uploadMs;
+                    total.bytesRead += record.bytesRead;
+                    total.gpuBytes += record.gpuBytes;
+                }
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextUnformatted("Total");
+                ImGui::TableNextColumn();
+                ImGui::TableNextColumn();
+                ImGui::TableNextColumn(); ImGui::Text("%.1f", total.ioMs);
+                ImGui::TableNextColumn(); ImGui::Text("%.1f", total.parseMs);
+                ImGui::TableNextColumn(); ImGui::Text("%.1f", total.mipMs);
+                ImGui::TableNextColumn(); ImGui::Text("%.1f", total.uploadMs);
+                ImGui::TableNextColumn(); ImGui::Text("%d", int(total.bytesRead / 1024));
+                ImGui::TableNextColumn(); ImGui::Text("%d", int(total.gpuBytes / 1024));
+                ImGui::EndTable();
+            }
+            ImGui::End();
+        }
+
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
@@ -363,11 +525,17 @@ int main() {
     ImGui::DestroyContext();
 
     // ================== Cleanup ==================
+    airPlaneLoad->Cancel();
+    testLevelLoad->Cancel();
     skybox.Cleanup();  // or remove if relying on destructor
     AirPlane.Cleanup();
     TestLevel.Cleanup();
     glDeleteProgram(lightingShader);
     glDeleteProgram(lampShader);
+    PixelUploadRing::Shared().Release();
+
+    // Kept per run so startup regressions can be diffed across builds
+    LoadReport::Shared().WriteJson("load_report.json");
 
     glfwTerminate();
     return 0;
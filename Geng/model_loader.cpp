@@ -1,159 +1,1728 @@
 // model_loader.cpp
 #include "model_loader.h"
-#include <fstream>
+#include "MappedFile.h"
+#include "AssetPack.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "GpuUploadQueue.h"
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
+#include "GltfLoader.h"
+#include "LoadReport.h"
+#include "ContentHash.h"
+#include "MipCache.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "PixelUploadRing.h"
 #include <sstream>
 #include <iostream>
 #include <algorithm>
-#include "stb_image.h"
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <array>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-bool Model::Load(const std::string& path) {
-    return LoadOBJ(path);
+// ---- In-place OBJ scanning helpers ----
+// These work directly on the mapped file and never allocate.
+
+static inline bool IsBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static std::string_view NextToken(const char*& p, const char* end) {
+    while (p < end && IsBlank(*p)) ++p;
+    const char* start = p;
+    while (p < end && !IsBlank(*p)) ++p;
+    return std::string_view(start, p - start);
+}
+
+static bool ParseFloat(const char*& p, const char* end, float& out) {
+    while (p < end && IsBlank(*p)) ++p;
+    if (p < end && *p == '+') ++p;
+    auto result = std::from_chars(p, end, out);
+    if (result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+}
+
+static bool ParseInt(const char*& p, const char* end, int& out) {
+    if (p < end && *p == '+') ++p;
+    auto result = std::from_chars(p, end, out);
+    if (result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+}
+
+// ---- Vertex welding ----
+// Open-addressing table from a resolved (v, vt, vn) triplet to the index of the
+// vertex already emitted for it in one mesh.
+struct VertexWeldMap {
+    struct Slot {
+        int pos = 0, tex = 0, norm = 0;     // pos == 0 marks an empty slot
+        unsigned int index = 0;
+    };
+    std::vector<Slot> slots;
+    size_t count = 0;
+
+    VertexWeldMap() : slots(1024) {}
+
+    static size_t Hash(int pos, int tex, int norm) {
+        uint64_t h = uint64_t(uint32_t(pos)) * 0x9E3779B97F4A7C15ull;
+        h ^= uint64_t(uint32_t(tex)) * 0xC2B2AE3D27D4EB4Full;
+        h ^= uint64_t(uint32_t(norm)) * 0x165667B19E3779F9ull;
+        return size_t(h ^ (h >> 29));
+    }
+
+    // Returns the slot for the triplet; an empty slot means it was not seen yet.
+    Slot& Find(int pos, int tex, int norm) {
+        size_t mask = slots.size() - 1;
+        for (size_t i = Hash(pos, tex, norm) & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (slot.pos == 0 || (slot.pos == pos && slot.tex == tex && slot.norm == norm))
+                return slot;
+        }
+    }
+
+    void Insert(Slot& slot, int pos, int tex, int norm, unsigned int index) {
+        slot.pos = pos;
+        slot.tex = tex;
+        slot.norm = norm;
+        slot.index = index;
+        if (++count * 2 > slots.size()) Grow();
+    }
+
+    void Grow() {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (const Slot& slot : old) {
+            if (slot.pos == 0) continue;
+            size_t i = Hash(slot.pos, slot.tex, slot.norm) & mask;
+            while (slots[i].pos != 0) i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+};
+
+// Largest mesh drawn with GL_UNSIGNED_SHORT; keeps index 0xFFFF free so
+// primitive restart could be enabled later.
+static const size_t MAX_SHORT_INDEX_VERTICES = 0xFFFF;
+
+static size_t IndexSize(GLenum indexType) {
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+}
+
+static void ComputeBounds(Mesh& mesh) {
+    if (mesh.vertices.empty()) {
+        mesh.boundsMin = mesh.boundsMax = glm::vec3(0.0f);
+        return;
+    }
+    mesh.boundsMin = mesh.boundsMax = mesh.vertices[0].position;
+    glm::vec2 uvMin = mesh.vertices[0].texCoord;
+    glm::vec2 uvMax = uvMin;
+    for (const auto& vertex : mesh.vertices) {
+        mesh.boundsMin = glm::min(mesh.boundsMin, vertex.position);
+        mesh.boundsMax = glm::max(mesh.boundsMax, vertex.position);
+        uvMin = glm::min(uvMin, vertex.texCoord);
+        uvMax = glm::max(uvMax, vertex.texCoord);
+    }
+    mesh.uvExtent = std::max(uvMax.x - uvMin.x, uvMax.y - uvMin.y);
+}
+
+static uint64_t HashMeshContent(const Mesh& mesh) {
+    uint64_t hash = HashBytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+    hash = HashBytes(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int), hash);
+    for (const auto& level : mesh.lods) {
+        hash = HashBytes(&level.firstIndex, sizeof(level.firstIndex), hash);
+        hash = HashBytes(&level.indexCount, sizeof(level.indexCount), hash);
+    }
+    return hash;
+}
+
+static TextureCompression CompressionFor(const ModelLoadOptions& options, const std::string& texturePath) {
+    auto found = options.textureCompressionByPath.find(texturePath);
+    return found != options.textureCompressionByPath.end() ? found->second : options.textureCompression;
+}
+
+// TextureCache names a model texture by path and by content. Both carry the
+// compression it was asked for, so a path loaded with None never shares a
+// block-compressed texture and the reverse. Uncompressed textures keep the
+// plain names loadTexture uses.
+static std::string TextureCacheName(const ModelLoadOptions& options, const std::string& texturePath) {
+    switch (CompressionFor(options, texturePath)) {
+    case TextureCompression::Fast: return texturePath + "#bc-fast";
+    case TextureCompression::High: return texturePath + "#bc-high";
+    default: return texturePath;
+    }
+}
+
+static uint64_t TextureCacheContentKey(const ModelLoadOptions& options, const DecodedImage& image) {
+    TextureCompression compression = CompressionFor(options, image.path);
+    if (!image.contentHash || compression == TextureCompression::None) return image.contentHash;
+    uint32_t setting = uint32_t(compression);
+    return HashBytes(&setting, sizeof(setting), image.contentHash);
+}
+
+// The file a texture path is read from.
+static std::string TextureFile(const std::string& texturePath) {
+    return IsGlbImagePath(texturePath) ? GlbImageFile(texturePath) : texturePath;
+}
+
+// False when the embedded image still hashes to what was uploaded for it,
+// so a reload of its .glb can leave the texture alone.
+static bool GlbImageChanged(const std::string& texturePath, uint64_t residentHash, const GlbFile* glb) {
+    std::vector<unsigned char> bytes;
+    if (!residentHash || !glb || !ReadGlbImage(texturePath, bytes, glb)) return true;
+    return ImageContentHash(bytes.data(), bytes.size(), false) != residentHash;
+}
+
+// The pixels UploadTexture will stage for 'images', in upload order, as far
+// as they fit one PixelCopyBatch.
+static void AddBatchSources(const std::vector<std::shared_ptr<DecodedImage>>& images, PixelCopyBatch& batch) {
+    size_t total = 0;
+    for (const auto& image : images) {
+        std::vector<std::pair<const void*, size_t>> sources;
+        if (image->levels.empty()) {
+            sources.push_back({ image->pixels, size_t(image->width) * image->height * image->components });
+        }
+        for (const auto& level : image->levels) {
+            sources.push_back({ level.pixels, level.size });
+        }
+        size_t bytes = 0;
+        for (const auto& source : sources) bytes += (source.second + 15) & ~size_t(15);
+        if (total + bytes > PixelUploadRing::RING_BYTES) return;
+        total += bytes;
+        batch.sources.insert(batch.sources.end(), sources.begin(), sources.end());
+    }
+}
+
+// Copies the pixels of 'images' into upload memory on the pool, between a
+// GL job that maps it and the jobs that upload from it, so the GL thread
+// only issues the calls. 'pushUploads' queues those jobs between UnmapBatch
+// and ReleaseBatch of the batch it is given; without one (nothing to copy,
+// the copy ring busy or the task cancelled) Stage copies as usual.
+static void PushCopiedUploads(GpuUploadQueue& queue, const std::shared_ptr<ModelLoadTask>& task,
+    const std::vector<std::shared_ptr<DecodedImage>>& images,
+    const std::function<void(std::shared_ptr<PixelCopyBatch>)>& pushUploads) {
+    auto batch = std::make_shared<PixelCopyBatch>();
+    AddBatchSources(images, *batch);
+    if (batch->sources.empty()) {
+        pushUploads(nullptr);
+        return;
+    }
+    queue.Push([task, batch, pushUploads]() {
+        if (task->IsCancelRequested() || !PixelUploadRing::Shared().MapBatch(*batch)) {
+            pushUploads(nullptr);
+            return;
+        }
+        ThreadPool::Shared().Submit([batch, pushUploads]() {
+            PixelUploadRing::Shared().CopyBatch(*batch);
+            pushUploads(batch);
+        });
+    });
+}
+
+// Lazy textures uploaded per Render call at most
+static const size_t TEXTURE_UPLOADS_PER_RENDER = 2;
+
+// True when the box lies entirely outside one of the six clip planes of
+// 'clip' (Gribb/Hartmann plane extraction).
+static bool BoxOutsideFrustum(const glm::mat4& clip, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i) {
+        rows[i] = glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+    }
+    for (int i = 0; i < 6; ++i) {
+        glm::vec4 plane = (i & 1) ? rows[3] - rows[i / 2] : rows[3] + rows[i / 2];
+        // The box corner furthest along the plane normal
+        glm::vec3 corner(plane.x >= 0.0f ? boxMax.x : boxMin.x,
+            plane.y >= 0.0f ? boxMax.y : boxMin.y,
+            plane.z >= 0.0f ? boxMax.z : boxMin.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) return true;
+    }
+    return false;
+}
+
+// Approximate on-screen diameter in pixels of the box's bounding sphere.
+// Unlike the box's projected corners it changes smoothly with distance,
+// which keeps LOD selection steady up close. Infinite once the camera is inside.
+static float ProjectedSpherePixels(const glm::mat4& clip, const glm::vec3& boxMin, const glm::vec3& boxMax,
+    float viewportWidth, float viewportHeight) {
+    glm::vec3 center = (boxMin + boxMax) * 0.5f;
+    float radius = glm::length(boxMax - boxMin) * 0.5f;
+    float depth = (clip * glm::vec4(center, 1.0f)).w;
+
+    // Pixels per model unit at unit depth, taking the model's largest axis scale
+    float pixelScale = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        glm::vec2 screen(clip[axis][0] * viewportWidth * 0.5f, clip[axis][1] * viewportHeight * 0.5f);
+        pixelScale = std::max(pixelScale, glm::length(screen));
+    }
+    // Measured from the sphere's nearest point, so it grows without bound
+    // (rather than jumping) as the camera closes in
+    float depthScale = glm::length(glm::vec3(clip[0][3], clip[1][3], clip[2][3]));
+    float distance = depth - radius * depthScale;
+    if (distance <= 0.0f) return std::numeric_limits<float>::infinity();
+    return 2.0f * radius * pixelScale / distance;
+}
+
+// Levels store their error relative to the mesh extent, which spans about
+// 'pixels' on screen.
+static unsigned SelectLod(const Mesh& mesh, float pixels, float pixelError, float hysteresis) {
+    auto coarsestWithin = [&](float limit) {
+        unsigned lod = 0;
+        for (unsigned i = 1; i < mesh.lods.size(); ++i) {
+            if (mesh.lods[i].error * pixels <= limit) lod = i;
+        }
+        return lod;
+    };
+
+    unsigned current = std::min(mesh.currentLod, unsigned(mesh.lods.size() - 1));
+    if (mesh.lods[current].error * pixels > pixelError * (1.0f + hysteresis)) {
+        return coarsestWithin(pixelError);
+    }
+    return std::max(current, coarsestWithin(pixelError * (1.0f - hysteresis)));
+}
+
+// ---- Chunked OBJ parsing ----
+// The file is cut into newline-aligned chunks that are scanned in parallel.
+// Each chunk keeps its own attribute lists and records faces and material
+// statements in file order; LoadOBJ then stitches them back together.
+
+// Chunks stay well below 4 GB so face offsets fit in 32 bits.
+static const size_t OBJ_MIN_CHUNK_BYTES = size_t(1) << 20;
+static const size_t OBJ_MAX_CHUNK_BYTES = size_t(256) << 20;
+
+struct ObjStatement {
+    enum Kind { Faces, UseMtl, MtlLib, Group };
+    Kind kind = Faces;
+    std::string_view name;          // material, library or o/g name
+    glm::ivec3 attribCounts{ 0 };   // chunk-local v/vt/vn counts while these faces were read
+    size_t firstFace = 0;
+    size_t faceCount = 0;
+};
+
+struct ObjChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    glm::ivec3 base{ 0 };           // v/vt/vn read by all earlier chunks
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+
+    std::vector<glm::ivec3> corners;        // (v, vt, vn) as written; v == 0 never resolves
+    std::vector<uint32_t> faceCornerEnd;    // one past each face's last corner
+    std::vector<uint32_t> faceLine;         // offset of each face's line, for error messages
+    std::vector<ObjStatement> statements;
+};
+
+static std::vector<ObjChunk> SplitObjChunks(const char* data, size_t size, size_t targetChunks) {
+    size_t chunkBytes = std::max(OBJ_MIN_CHUNK_BYTES, size / std::max<size_t>(targetChunks, 1) + 1);
+    chunkBytes = std::min(chunkBytes, OBJ_MAX_CHUNK_BYTES);
+
+    std::vector<ObjChunk> chunks;
+    const char* cursor = data;
+    const char* fileEnd = data + size;
+    while (cursor < fileEnd) {
+        const char* chunkEnd = fileEnd;
+        if (size_t(fileEnd - cursor) > chunkBytes) {
+            const char* newline = static_cast<const char*>(
+                memchr(cursor + chunkBytes, '\n', fileEnd - (cursor + chunkBytes)));
+            chunkEnd = newline ? newline + 1 : fileEnd;
+        }
+        chunks.emplace_back();
+        chunks.back().begin = cursor;
+        chunks.back().end = chunkEnd;
+        cursor = chunkEnd;
+    }
+    return chunks;
+}
+
+static void ParseObjChunk(ObjChunk& chunk) {
+    const char* cursor = chunk.begin;
+    while (cursor < chunk.end) {
+        const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', chunk.end - cursor));
+        if (!lineEnd) lineEnd = chunk.end;
+        const char* p = cursor;
+        const char* end = lineEnd;
+        const char* lineStart = cursor;
+        cursor = lineEnd + 1;
+
+        std::string_view prefix = NextToken(p, end);
+
+        if (prefix == "v") {
+            glm::vec3 pos(0.0f);
+            ParseFloat(p, end, pos.x);
+            ParseFloat(p, end, pos.y);
+            ParseFloat(p, end, pos.z);
+            chunk.positions.push_back(pos);
+        }
+        else if (prefix == "vn") {
+            glm::vec3 norm(0.0f);
+            ParseFloat(p, end, norm.x);
+            ParseFloat(p, end, norm.y);
+            ParseFloat(p, end, norm.z);
+            chunk.normals.push_back(norm);
+        }
+        else if (prefix == "vt") {
+            glm::vec2 uv(0.0f);
+            ParseFloat(p, end, uv.x);
+            ParseFloat(p, end, uv.y);
+            chunk.texCoords.push_back(uv);
+        }
+        else if (prefix == "f") {
+            glm::ivec3 counts(int(chunk.positions.size()), int(chunk.texCoords.size()), int(chunk.normals.size()));
+            if (chunk.statements.empty() || chunk.statements.back().kind != ObjStatement::Faces ||
+                chunk.statements.back().attribCounts != counts) {
+                ObjStatement faces;
+                faces.attribCounts = counts;
+                faces.firstFace = chunk.faceCornerEnd.size();
+                chunk.statements.push_back(faces);
+            }
+
+            for (std::string_view corner = NextToken(p, end); !corner.empty(); corner = NextToken(p, end)) {
+                const char* c = corner.data();
+                const char* cEnd = c + corner.size();
+                glm::ivec3 idx(0);
+
+                // v, v/vt, v//vn or v/vt/vn
+                if (!ParseInt(c, cEnd, idx.x)) {
+                    chunk.corners.push_back(glm::ivec3(0));
+                    break;
+                }
+                if (c < cEnd && *c == '/') {
+                    ++c;
+                    if (c < cEnd && *c != '/') ParseInt(c, cEnd, idx.y);
+                    if (c < cEnd && *c == '/') {
+                        ++c;
+                        ParseInt(c, cEnd, idx.z);
+                    }
+                }
+                chunk.corners.push_back(idx);
+            }
+            chunk.faceCornerEnd.push_back(uint32_t(chunk.corners.size()));
+            chunk.faceLine.push_back(uint32_t(lineStart - chunk.begin));
+            ++chunk.statements.back().faceCount;
+        }
+        else if (prefix == "usemtl" || prefix == "mtllib") {
+            ObjStatement statement;
+            statement.kind = prefix == "usemtl" ? ObjStatement::UseMtl : ObjStatement::MtlLib;
+            statement.name = NextToken(p, end);
+            chunk.statements.push_back(statement);
+        }
+        else if (prefix == "o" || prefix == "g") {
+            // The rest of the line, so "g wall north" stays one group
+            while (p < end && IsBlank(*p)) ++p;
+            const char* nameEnd = end;
+            while (nameEnd > p && IsBlank(nameEnd[-1])) --nameEnd;
+            ObjStatement statement;
+            statement.kind = ObjStatement::Group;
+            statement.name = std::string_view(p, nameEnd - p);
+            chunk.statements.push_back(statement);
+        }
+    }
+}
+
+bool Model::Load(const std::string& path, const ModelLoadOptions& loadOptions) {
+    auto start = std::chrono::steady_clock::now();
+    Cleanup();
+    DetectBlockFormats();
+    if (!LoadSource(path, loadOptions)) {
+        return false;
+    }
+
+    LoadTimer uploadTimer;
+    CreateBuffers();
+    for (auto& mesh : meshes) {
+        UploadMesh(mesh);
+        ReleaseGeometry(mesh);
+    }
+    stats.uploadMs = uploadTimer.Lap();
+    if (!options.lazyTextures) {
+        std::vector<std::string> decode;
+        for (const auto& texturePath : pendingTextures) {
+            if (!AcquireTexture(texturePath)) decode.push_back(texturePath);
+        }
+        std::vector<std::shared_ptr<DecodedImage>> images = DecodeTextures(decode, options);
+        PackTextures(images);
+        for (const auto& image : images) {
+            UploadTexture(image);
+        }
+    }
+    pendingTextures.clear();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.loadMs = elapsed.count();
+    PrintLoadSummary(path);
+    ReportLoad(path);
+    return true;
+}
+
+ModelLoadHandle Model::LoadAsync(const std::string& path, GpuUploadQueue& uploads,
+    const ModelLoadOptions& loadOptions) {
+    using Status = ModelLoadTask::Status;
+    auto task = std::make_shared<ModelLoadTask>();
+    Model* target = this;
+    GpuUploadQueue* queue = &uploads;
+    DetectBlockFormats();   // here on the GL thread, before loader threads compress
+
+    ThreadPool::Shared().Submit([task, target, queue, path, loadOptions]() {
+        auto start = std::chrono::steady_clock::now();
+
+        // Everything CPU-side goes into a private Model so the target can keep
+        // rendering on the GL thread while this one fills in.
+        auto staging = std::make_shared<Model>();
+        staging->cancelFlag = &task->cancelRequested;
+        bool loaded = !task->IsCancelRequested() && staging->LoadSource(path, loadOptions);
+        if (task->IsCancelRequested()) {
+            task->status = Status::Cancelled;
+            return;
+        }
+        if (!loaded) {
+            task->status = Status::Failed;
+            return;
+        }
+        staging->cancelFlag = nullptr;
+        task->progress = 0.5f;
+        if (staging->options.lazyTextures) {
+            staging->pendingTextures.clear();   // Render requests them
+        }
+
+        // Textures another model already uploaded are only looked up again
+        // on the GL thread
+        std::vector<std::string> decode, shared;
+        for (const auto& texturePath : staging->pendingTextures) {
+            bool resident = TextureCache::Shared().IsResident(TextureCacheName(staging->options, texturePath));
+            (resident ? shared : decode).push_back(texturePath);
+        }
+        std::vector<std::shared_ptr<DecodedImage>> images =
+            DecodeTextures(decode, staging->options, &task->cancelRequested);
+        if (task->IsCancelRequested()) {
+            task->status = Status::Cancelled;
+            return;
+        }
+        staging->pendingTextures.clear();
+        task->progress = 0.8f;
+        task->status = Status::Uploading;
+
+        // One GL job per mesh and per texture keeps each step small enough to
+        // fit a frame budget. Jobs run in push order on the GL thread.
+        const float uploadStep = 0.2f / float(staging->meshes.size() + images.size() + 1);
+        queue->Push([task, target, staging]() {
+            if (task->IsCancelRequested()) return;
+            target->Cleanup();
+            target->options = staging->options;
+            target->stats = staging->stats;
+            LoadTimer uploadTimer;
+            target->CreateBuffers();
+            staging->stats.uploadMs += uploadTimer.Lap();
+        });
+        for (size_t i = 0; i < staging->meshes.size(); ++i) {
+            queue->Push([task, target, staging, i, uploadStep]() {
+                if (task->IsCancelRequested()) return;
+                Mesh& mesh = staging->meshes[i];
+                LoadTimer uploadTimer;
+                target->UploadMesh(mesh);
+                staging->stats.uploadMs += uploadTimer.Lap();
+                target->ReleaseGeometry(mesh);
+                target->meshes.push_back(std::move(mesh));
+                task->progress = task->progress + uploadStep;
+            });
+        }
+        if (staging->options.arrayTextureMaxSize > 0) {
+            auto packing = std::make_shared<std::vector<std::shared_ptr<DecodedImage>>>(images);
+            queue->Push([task, target, packing]() {
+                if (task->IsCancelRequested()) return;
+                target->PackTextures(*packing);
+            });
+        }
+        auto finish = [task, target, staging, path, start, shared]() {
+            if (task->IsCancelRequested()) {
+                task->status = Status::Cancelled;
+                return;
+            }
+            for (const auto& texturePath : shared) {
+                if (!target->AcquireTexture(texturePath)) {
+                    target->RequestTexture(texturePath);   // released since the check
+                }
+            }
+            target->options = staging->options;
+            target->stats = staging->stats;
+            target->sourceFiles = staging->sourceFiles;
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            target->stats.loadMs = elapsed.count();
+            target->PrintLoadSummary(path);
+            target->ReportLoad(path);
+
+            task->progress = 1.0f;
+            task->status = Status::Done;
+        };
+        // The texture jobs and 'finish', reading from 'batch' when it was copied
+        auto pushUploads = [task, target, queue, images, uploadStep, finish](std::shared_ptr<PixelCopyBatch> batch) {
+            if (batch) queue->Push([batch]() { PixelUploadRing::Shared().UnmapBatch(*batch); });
+            for (const auto& image : images) {
+                queue->Push([task, target, image, uploadStep]() {
+                    if (task->IsCancelRequested()) return;
+                    if (target->loadedTextures.find(image->path) == target->loadedTextures.end() &&
+                        target->arrayLayers.find(image->path) == target->arrayLayers.end()) {
+                        target->UploadTexture(image);
+                    }
+                    task->progress = task->progress + uploadStep;
+                });
+            }
+            if (batch) queue->Push([batch]() { PixelUploadRing::Shared().ReleaseBatch(*batch); });
+            queue->Push(finish);
+        };
+
+        if (staging->options.streamTextures) {
+            pushUploads(nullptr);
+            return;
+        }
+        PushCopiedUploads(*queue, task, images, pushUploads);
+    });
+
+    return task;
+}
+
+std::vector<std::string> Model::WatchedFiles() const {
+    std::vector<std::string> files = sourceFiles;
+    for (const auto& mesh : meshes) {
+        if (mesh.material.diffuseTexture.empty()) continue;
+        std::string file = TextureFile(mesh.material.diffuseTexture);
+        if (std::find(files.begin(), files.end(), file) == files.end()) {
+            files.push_back(file);
+        }
+    }
+    return files;
+}
+
+ModelLoadHandle Model::ReloadAsync(const std::string& path, GpuUploadQueue& uploads) {
+    using Status = ModelLoadTask::Status;
+    enum class ReloadKind { Geometry, Materials, Texture };
+
+    if (sourceFiles.empty()) return nullptr;
+    ReloadKind kind = ReloadKind::Texture;
+    std::vector<std::string> knownTextures;
+    std::unordered_map<std::string, uint64_t> knownHashes = textureHashes;
+    std::unordered_set<std::string> usedMaterials;
+    for (const auto& mesh : meshes) usedMaterials.insert(mesh.material.name);
+    bool usesPath = false;
+    for (const auto& texture : loadedTextures) {
+        knownTextures.push_back(texture.first);
+        usesPath = usesPath || TextureFile(texture.first) == path;
+    }
+    for (const auto& texture : arrayLayers) {
+        knownTextures.push_back(texture.first);
+        usesPath = usesPath || TextureFile(texture.first) == path;
+    }
+    if (path == sourceFiles[0]) {
+        kind = ReloadKind::Geometry;
+    }
+    else if (std::find(sourceFiles.begin(), sourceFiles.end(), path) != sourceFiles.end()) {
+        kind = ReloadKind::Materials;
+    }
+    else if (!usesPath) {
+        return nullptr;
+    }
+
+    // Saving twice in a row queues two reloads; only the latest is applied.
+    unsigned generation = ++reloadGenerations[path];
+    auto task = std::make_shared<ModelLoadTask>();
+    Model* target = this;
+    GpuUploadQueue* queue = &uploads;
+    std::string modelPath = sourceFiles[0];
+    ModelLoadOptions reloadOptions = options;
+
+    ThreadPool::Shared().Submit([=]() {
+        auto start = std::chrono::steady_clock::now();
+        auto staging = std::make_shared<Model>();
+        auto materials = std::make_shared<std::vector<Material>>();
+        bool loaded = true;
+        if (kind == ReloadKind::Geometry) {
+            loaded = staging->LoadSource(modelPath, reloadOptions);
+        }
+        else if (kind == ReloadKind::Materials) {
+            staging->options = reloadOptions;
+            loaded = staging->LoadMTL(path, *materials);
+        }
+        if (!loaded) {
+            task->status = Status::Failed;
+            return;
+        }
+        task->progress = 0.5f;
+
+        // Textures that are new, or whose pixels live in the changed file
+        std::vector<std::string> decode;
+        if (kind == ReloadKind::Texture) {
+            for (const auto& texture : knownTextures) {
+                if (TextureFile(texture) == path) decode.push_back(texture);
+            }
+        }
+        else {
+            // SwapMaterials only applies materials a mesh uses, so textures
+            // of the others would be uploaded just to be released again
+            for (const auto& material : *materials) {
+                if (!usedMaterials.count(material.name)) continue;
+                staging->QueueTexture(material.diffuseTexture);
+            }
+            // Opened once for every embedded image it has
+            std::shared_ptr<const GlbFile> glb = IsGlbPath(path) ? OpenGlbFile(path) : nullptr;
+            for (const auto& texture : staging->pendingTextures) {
+                bool known = std::find(knownTextures.begin(), knownTextures.end(), texture) != knownTextures.end();
+                if (known && IsGlbImagePath(texture) && TextureFile(texture) == path) {
+                    // Rewriting a .glb rewrites every image in it; only the
+                    // ones whose bytes differ need decoding again
+                    auto resident = knownHashes.find(texture);
+                    if (GlbImageChanged(texture, resident != knownHashes.end() ? resident->second : 0, glb.get())) {
+                        decode.push_back(texture);
+                    }
+                }
+                else if (known ? TextureFile(texture) == path : !reloadOptions.lazyTextures) {
+                    decode.push_back(texture);
+                }
+            }
+        }
+        std::vector<std::shared_ptr<DecodedImage>> images = DecodeTextures(decode, reloadOptions);
+        task->progress = 0.8f;
+        task->status = Status::Uploading;
+
+        auto apply = [=]() {
+            auto latest = target->reloadGenerations.find(path);
+            if (latest == target->reloadGenerations.end() || latest->second != generation) {
+                task->status = Status::Cancelled;
+                return;
+            }
+            size_t uploadedMeshes = 0;
+            LoadTimer uploadTimer;
+            if (kind == ReloadKind::Geometry) {
+                uploadedMeshes = target->SwapMeshes(*staging);
+            }
+            else if (kind == ReloadKind::Materials) {
+                target->SwapMaterials(*materials);
+            }
+            for (const auto& image : images) {
+                target->ReplaceTexture(image);
+            }
+            target->ReleaseUnusedTextures();
+            target->stats.reloadedTextures = images.size();
+            double uploadMs = uploadTimer.Lap();
+
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (kind == ReloadKind::Geometry) {
+                target->stats.uploadMs = uploadMs;
+                target->stats.loadMs = elapsed.count();
+                target->ReportLoad(modelPath);
+            }
+            std::cout << "Reloaded " << path;
+            if (path != modelPath) std::cout << " for " << modelPath;
+            std::cout << ": ";
+            if (kind == ReloadKind::Geometry) {
+                std::cout << uploadedMeshes << " of " << target->meshes.size() << " meshes re-uploaded, ";
+            }
+            std::cout << images.size() << " textures, " << elapsed.count() << " ms" << std::endl;
+
+            task->progress = 1.0f;
+            task->status = Status::Done;
+        };
+        if (reloadOptions.streamTextures) {
+            queue->Push(apply);
+            return;
+        }
+        PushCopiedUploads(*queue, task, images, [queue, apply](std::shared_ptr<PixelCopyBatch> batch) {
+            if (batch) queue->Push([batch]() { PixelUploadRing::Shared().UnmapBatch(*batch); });
+            queue->Push(apply);
+            if (batch) queue->Push([batch]() { PixelUploadRing::Shared().ReleaseBatch(*batch); });
+        });
+    });
+
+    return task;
+}
+
+// Fills meshes, stats and pendingTextures without touching GL, so it can run
+// on any thread.
+bool Model::LoadSource(const std::string& path, const ModelLoadOptions& loadOptions) {
+    options = loadOptions;
+    stats = ModelLoadStats();
+    LoadTimer timer;
+
+    bool loaded = options.useMeshCache && LoadMeshCache(path);
+    if (!loaded) {
+        loaded = IsGlbPath(path) ? LoadGLB(path) : LoadOBJ(path);
+        if (loaded && !LoadCancelled()) {
+            ClusterMeshes();
+        }
+        if (loaded && options.optimizeMeshes && !LoadCancelled()) {
+            OptimizeMeshes();
+        }
+        if (loaded && !LoadCancelled()) {
+            SplitLargeMeshes();
+        }
+        if (loaded && options.lodLevels > 0 && !LoadCancelled()) {
+            BuildLods();
+        }
+        // Everything a cache hit reads back instead of recomputing
+        if (loaded) {
+            ThreadPool::Shared().ParallelFor(meshes.size(), [&](size_t m) {
+                Mesh& mesh = meshes[m];
+                if (mesh.lods.empty()) {
+                    mesh.lods.push_back({ 0, mesh.indices.size(), 0.0f });
+                }
+                ComputeBounds(mesh);
+                mesh.contentHash = HashMeshContent(mesh);
+            });
+            if (options.vertexFormat == VertexFormat::Packed16) {
+                PackMeshes();
+            }
+        }
+        if (loaded && options.useMeshCache && !LoadCancelled()) {
+            WriteMeshCache(path, sourceFiles, CacheFlags(), meshes);
+        }
+    }
+
+    if (loaded) {
+        for (auto& mesh : meshes) {
+            stats.uniqueVertices += mesh.VertexCount();
+            stats.triangleCorners += mesh.lods[0].indexCount;
+            QueueTexture(mesh.material.diffuseTexture);
+        }
+        LayoutMeshes();
+    }
+    stats.parseMs = std::max(0.0, timer.Lap() - stats.ioMs);
+    return loaded;
+}
+
+void Model::ClusterMeshes() {
+    if (options.clusterMaxTriangles == 0 && options.clusterMaxExtent <= 0.0f) return;
+
+    std::vector<std::vector<MeshPart>> clusters(meshes.size());
+    ThreadPool::Shared().ParallelFor(meshes.size(), [&](size_t m) {
+        if (LoadCancelled()) return;
+        ClusterMesh(meshes[m].vertices, meshes[m].indices, options.clusterMaxTriangles,
+            options.clusterMaxExtent, clusters[m]);
+    }, options.parseThreads);
+
+    std::vector<Mesh> result;
+    for (size_t m = 0; m < meshes.size(); ++m) {
+        if (clusters[m].size() <= 1) {
+            result.push_back(std::move(meshes[m]));
+            continue;
+        }
+        for (auto& part : clusters[m]) {
+            Mesh piece;
+            piece.vertices = std::move(part.vertices);
+            piece.indices = std::move(part.indices);
+            piece.material = meshes[m].material;
+            piece.group = meshes[m].group;
+            result.push_back(std::move(piece));
+        }
+        ++stats.clusteredMeshes;
+    }
+    meshes.swap(result);
+}
+
+// Cuts meshes too big for 16-bit indices into parts that fit, when the
+// smaller index buffer outweighs the vertices duplicated along the cuts.
+void Model::SplitLargeMeshes() {
+    const size_t vertexSize = options.vertexFormat == VertexFormat::Packed16 ? sizeof(PackedVertex) : sizeof(Vertex);
+    std::vector<Mesh> result;
+    result.reserve(meshes.size());
+
+    for (auto& mesh : meshes) {
+        if (mesh.vertices.size() <= MAX_SHORT_INDEX_VERTICES) {
+            result.push_back(std::move(mesh));
+            continue;
+        }
+
+        std::vector<MeshPart> parts;
+        SplitMesh(mesh.vertices, mesh.indices, MAX_SHORT_INDEX_VERTICES, parts);
+        size_t splitVertices = 0;
+        for (const auto& part : parts) splitVertices += part.vertices.size();
+
+        size_t wholeBytes = mesh.vertices.size() * vertexSize + mesh.indices.size() * sizeof(unsigned int);
+        size_t splitBytes = splitVertices * vertexSize + mesh.indices.size() * sizeof(uint16_t);
+        if (splitBytes >= wholeBytes) {
+            result.push_back(std::move(mesh));
+            continue;
+        }
+
+        for (auto& part : parts) {
+            Mesh piece;
+            piece.vertices = std::move(part.vertices);
+            piece.indices = std::move(part.indices);
+            piece.material = mesh.material;
+            piece.group = mesh.group;
+            result.push_back(std::move(piece));
+        }
+        ++stats.splitMeshes;
+    }
+    meshes.swap(result);
+}
+
+// Appends simplified index ranges to every mesh. Each level is simplified
+// from the full mesh so errors do not compound from level to level.
+void Model::BuildLods() {
+    const unsigned levels = std::min(options.lodLevels, MAX_MESH_LODS - 1);
+    ThreadPool::Shared().ParallelFor(meshes.size(), [&](size_t m) {
+        if (LoadCancelled()) return;
+        Mesh& mesh = meshes[m];
+        const std::vector<unsigned int> full = mesh.indices;
+        mesh.lods.assign(1, MeshLod{ 0, full.size(), 0.0f });
+
+        std::vector<unsigned int> simplified;
+        for (unsigned level = 1; level <= levels; ++level) {
+            const MeshLod& previous = mesh.lods.back();
+            size_t target = size_t(double(previous.indexCount / 3) * options.lodReduction) * 3;
+            float error = SimplifyMesh(mesh.vertices, full, target, options.lodMaxError, simplified);
+
+            // A level that barely removes anything is not worth switching to
+            if (simplified.empty() || simplified.size() * 20 > previous.indexCount * 17) break;
+            if (options.optimizeMeshes) {
+                OptimizeVertexCache(simplified, mesh.vertices.size());
+            }
+            mesh.lods.push_back({ mesh.indices.size(), simplified.size(), error });
+            mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+        }
+    }, options.parseThreads);
+}
+
+void Model::PackMeshes() {
+    ThreadPool::Shared().ParallelFor(meshes.size(), [&](size_t m) {
+        Mesh& mesh = meshes[m];
+        PackVertices(mesh.VertexData(), mesh.VertexCount(), mesh.packedVertices, mesh.positionOffset,
+            mesh.positionScale, mesh.packingError);
+    }, options.parseThreads);
+    AddPackingStats();
+}
+
+void Model::AddPackingStats() {
+    float largestExtent = 0.0f;
+    for (const auto& mesh : meshes) {
+        const glm::vec3& extent = mesh.positionScale;
+        largestExtent = std::max(largestExtent, std::max(extent.x, std::max(extent.y, extent.z)));
+        stats.packedPositionError = std::max(stats.packedPositionError, mesh.packingError.position);
+        stats.packedNormalErrorDegrees = std::max(stats.packedNormalErrorDegrees, mesh.packingError.normalDegrees);
+        stats.packedTexCoordError = std::max(stats.packedTexCoordError, mesh.packingError.texCoord);
+    }
+    if (largestExtent > 0.0f) {
+        stats.packedPositionError /= largestExtent;
+    }
+}
+
+void Model::PrintLoadSummary(const std::string& path) const {
+    std::cout << "Loaded model: " << path << " (" << meshes.size() << " meshes, "
+        << stats.uniqueVertices << " vertices from " << stats.triangleCorners << " corners, "
+        << stats.meshLookups << " material lookups, " << stats.loadMs << " ms" << (stats.fromCache ? ", cached" : "") << ")\n";
+    std::cout << "  meshes: " << stats.ioMs << " ms I/O, " << stats.parseMs << " ms parse, "
+        << stats.uploadMs << " ms upload, " << stats.bytesRead / 1024 << " KB read\n";
+    if (stats.optimized) {
+        std::cout << "  optimized: ACMR " << stats.acmrBefore << " -> " << stats.acmrAfter
+            << ", ATVR " << stats.atvrBefore << " -> " << stats.atvrAfter;
+        if (options.analyzeOverdraw) {
+            std::cout << ", overdraw " << stats.overdrawBefore << " -> " << stats.overdrawAfter;
+        }
+        std::cout << "\n";
+    }
+    if (options.vertexFormat == VertexFormat::Packed16) {
+        std::cout << "  packed vertices: max position error " << stats.packedPositionError * 100.0f
+            << "% of extent, normal " << stats.packedNormalErrorDegrees << " deg, UV "
+            << stats.packedTexCoordError << "\n";
+    }
+    size_t shortIndexMeshes = 0;
+    size_t residentBytes = 0;
+    for (const auto& mesh : meshes) {
+        if (mesh.indexType == GL_UNSIGNED_SHORT) ++shortIndexMeshes;
+        residentBytes += mesh.vertices.size() * sizeof(Vertex) + mesh.positions.size() * sizeof(glm::vec3)
+            + mesh.indices.size() * sizeof(unsigned int);
+    }
+    std::cout << "  buffers: " << stats.vertexBytes / 1024 << " KB vertices, " << stats.indexBytes / 1024
+        << " KB indices, 16-bit in " << shortIndexMeshes << " of " << meshes.size() << " meshes";
+    if (stats.splitMeshes > 0) {
+        std::cout << " (" << stats.splitMeshes << " large meshes split to fit)";
+    }
+    if (stats.clusteredMeshes > 0) {
+        std::cout << ", " << stats.clusteredMeshes << " meshes clustered";
+    }
+    if (stats.glbPrimitives > 0) {
+        std::cout << "\n  glTF: " << stats.glbPrimitives << " triangle primitives, "
+            << stats.glbDirectPrimitives << " copied straight from the BIN chunk";
+    }
+    std::cout << "\n  kept in RAM after upload: " << residentBytes / 1024 << " KB\n";
+
+    size_t levels = 0;
+    for (const auto& mesh : meshes) levels = std::max(levels, mesh.lods.size());
+    if (levels > 1) {
+        std::cout << "  LOD triangles:";
+        for (size_t level = 0; level < levels; ++level) {
+            size_t triangles = 0;
+            for (const auto& mesh : meshes) {
+                triangles += mesh.lods[std::min(level, mesh.lods.size() - 1)].indexCount / 3;
+            }
+            std::cout << (level ? " -> " : " ") << triangles;
+        }
+        std::cout << "\n";
+    }
+}
+
+void Model::ReportLoad(const std::string& path) const {
+    AssetLoadRecord record;
+    record.kind = "Model";
+    record.path = path;
+    record.totalMs = stats.loadMs;
+    record.ioMs = stats.ioMs;
+    record.parseMs = stats.parseMs;
+    record.uploadMs = stats.uploadMs;
+    record.bytesRead = stats.bytesRead;
+    record.gpuBytes = stats.vertexBytes + stats.indexBytes;
+    record.fromCache = stats.fromCache;
+    LoadReport::Shared().Add(record);
+}
+
+uint32_t Model::CacheFlags() const {
+    uint32_t flags = (options.weldVertices ? 1u : 0u) | (options.optimizeMeshes ? 2u : 0u) |
+        (options.splitGroups ? 4u : 0u);
+
+    // The upper bits fingerprint the cluster and LOD settings
+    if (options.clusterMaxTriangles > 0 || options.clusterMaxExtent > 0.0f || options.lodLevels > 0) {
+        uint32_t hash = uint32_t(options.clusterMaxTriangles) * 0x9E3779B1u;
+        for (float value : { options.clusterMaxExtent, float(options.lodLevels), options.lodReduction, options.lodMaxError }) {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            hash = (hash ^ bits) * 0x85EBCA77u;
+        }
+        flags |= 8u | (hash << 4);
+    }
+    return flags;
+}
+
+void Model::OptimizeMeshes() {
+    struct MeshReport {
+        VertexCacheStats before, after;
+        float overdrawBefore = 0.0f, overdrawAfter = 0.0f;
+    };
+    std::vector<MeshReport> reports(meshes.size());
+
+    ThreadPool::Shared().ParallelFor(meshes.size(), [&](size_t m) {
+        if (LoadCancelled()) return;
+        Mesh& mesh = meshes[m];
+        MeshReport& report = reports[m];
+
+        report.before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+        if (options.analyzeOverdraw) report.overdrawBefore = AnalyzeOverdraw(mesh.indices, mesh.vertices);
+
+        OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+        OptimizeOverdraw(mesh.indices, mesh.vertices);
+        OptimizeVertexFetch(mesh.vertices, mesh.indices);
+
+        report.after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+        if (options.analyzeOverdraw) report.overdrawAfter = AnalyzeOverdraw(mesh.indices, mesh.vertices);
+    }, options.parseThreads);
+
+    double triangles = 0.0, vertices = 0.0;
+    double acmrBefore = 0.0, acmrAfter = 0.0, atvrBefore = 0.0, atvrAfter = 0.0;
+    double overdrawBefore = 0.0, overdrawAfter = 0.0;
+    for (size_t m = 0; m < meshes.size(); ++m) {
+        double tris = double(meshes[m].indices.size() / 3);
+        double verts = double(meshes[m].vertices.size());
+        triangles += tris;
+        vertices += verts;
+        acmrBefore += reports[m].before.acmr * tris;
+        acmrAfter += reports[m].after.acmr * tris;
+        atvrBefore += reports[m].before.atvr * verts;
+        atvrAfter += reports[m].after.atvr * verts;
+        overdrawBefore += reports[m].overdrawBefore * tris;
+        overdrawAfter += reports[m].overdrawAfter * tris;
+    }
+    if (triangles > 0.0) {
+        stats.acmrBefore = float(acmrBefore / triangles);
+        stats.acmrAfter = float(acmrAfter / triangles);
+        stats.overdrawBefore = float(overdrawBefore / triangles);
+        stats.overdrawAfter = float(overdrawAfter / triangles);
+    }
+    if (vertices > 0.0) {
+        stats.atvrBefore = float(atvrBefore / vertices);
+        stats.atvrAfter = float(atvrAfter / vertices);
+    }
+    stats.optimized = true;
+}
+
+// The meshes point into the mapped cache until ReleaseGeometry, so a hit
+// copies nothing and redoes none of the bounds, hashing or packing.
+bool Model::LoadMeshCache(const std::string& path) {
+    LoadTimer ioTimer;
+    auto file = std::make_shared<MappedFile>();
+    std::vector<CachedMeshView> views;
+    std::vector<std::string> cachedSources;
+    if (!OpenMeshCache(path, CacheFlags(), *file, views, cachedSources) || views.empty()) {
+        stats.ioMs += ioTimer.Lap();
+        return false;
+    }
+    stats.ioMs += ioTimer.Lap();
+    stats.bytesRead += file->Size();
+
+    const bool wantPacked = options.vertexFormat == VertexFormat::Packed16;
+    bool allPacked = true;
+    sourceFiles = cachedSources;
+    meshes.resize(views.size());
+    for (size_t i = 0; i < views.size(); ++i) {
+        const CachedMeshView& view = views[i];
+        Mesh& mesh = meshes[i];
+        mesh.material = view.material;
+        mesh.group = view.group;
+        mesh.lods = view.lods;
+        mesh.boundsMin = view.boundsMin;
+        mesh.boundsMax = view.boundsMax;
+        mesh.uvExtent = view.uvExtent;
+        mesh.contentHash = view.contentHash;
+        mesh.mapping = file;
+        mesh.mappedVertices = view.vertices;
+        mesh.mappedVertexCount = view.vertexCount;
+        mesh.mappedIndices = view.indices;
+        mesh.mappedIndexCount = view.indexCount;
+        if (wantPacked && view.packedVertices) {
+            mesh.mappedPackedVertices = view.packedVertices;
+            mesh.positionOffset = view.positionOffset;
+            mesh.positionScale = view.positionScale;
+            mesh.packingError = view.packingError;
+        }
+        allPacked = allPacked && view.packedVertices;
+    }
+    if (wantPacked) {
+        // A cache written by a Float32 load has no packed copy to reuse
+        if (allPacked) AddPackingStats();
+        else PackMeshes();
+    }
+    stats.fromCache = true;
+    return true;
 }
 
 void Model::Render(GLuint shaderProgram) {
+    DrawMeshes(shaderProgram, nullptr);
+}
+
+void Model::Render(GLuint shaderProgram, const glm::mat4& modelViewProjection) {
+    DrawMeshes(shaderProgram, &modelViewProjection);
+}
+
+const Model::MeshUniforms& Model::UniformsFor(GLuint shaderProgram) {
+    auto found = meshUniforms.find(shaderProgram);
+    if (found != meshUniforms.end()) return found->second;
+
+    MeshUniforms& uniforms = meshUniforms[shaderProgram];
+    uniforms.diffuseLayer = glGetUniformLocation(shaderProgram, "diffuseLayer");
+    uniforms.diffuseArray = glGetUniformLocation(shaderProgram, "diffuseArray");
+    uniforms.materialAmbient = glGetUniformLocation(shaderProgram, "material.ambient");
+    uniforms.materialDiffuse = glGetUniformLocation(shaderProgram, "material.diffuse");
+    uniforms.materialSpecular = glGetUniformLocation(shaderProgram, "material.specular");
+    uniforms.materialShininess = glGetUniformLocation(shaderProgram, "material.shininess");
+    uniforms.positionOffset = glGetUniformLocation(shaderProgram, "positionOffset");
+    uniforms.positionScale = glGetUniformLocation(shaderProgram, "positionScale");
+    return uniforms;
+}
+
+void Model::DrawMeshes(GLuint shaderProgram, const glm::mat4* cullMatrix) {
+    renderStats = ModelRenderStats();
+    GLint viewport[4] = { 0, 0, 0, 0 };
+    if (cullMatrix) {
+        glGetIntegerv(GL_VIEWPORT, viewport);
+    }
+
+    ResolveTextures();
+    const MeshUniforms& uniforms = UniformsFor(shaderProgram);
+    glUniform1i(uniforms.diffuseArray, 2);
+    GLuint boundTexture = 0;
+    GLuint boundArray = 0;
+    glBindVertexArray(VAO);
     for (auto& mesh : meshes) {
-        // Bind textures
-        GLuint diffuseTex = 0;
+        if (cullMatrix && BoxOutsideFrustum(*cullMatrix, mesh.boundsMin, mesh.boundsMax)) {
+            ++renderStats.culledMeshes;
+            continue;
+        }
+
+        MeshLod full{ 0, mesh.IndexCount(), 0.0f };
+        if (!mesh.lods.empty()) full = mesh.lods[0];
+        unsigned lod = 0;
+        float pixels = std::numeric_limits<float>::infinity();
+        if (cullMatrix) {
+            pixels = ProjectedSpherePixels(*cullMatrix, mesh.boundsMin, mesh.boundsMax,
+                float(viewport[2]), float(viewport[3]));
+        }
+        if (cullMatrix && mesh.lods.size() > 1) {
+            lod = SelectLod(mesh, pixels, lodPixelError, lodHysteresis);
+        }
+        mesh.currentLod = lod;
+        const MeshLod& level = mesh.currentLod > 0 ? mesh.lods[mesh.currentLod] : full;
+
+        ++renderStats.drawnMeshes;
+        ++renderStats.lodMeshes[mesh.currentLod];
+        renderStats.drawnTriangles += level.indexCount / 3;
+        renderStats.fullTriangles += full.indexCount / 3;
+
+        // Bind textures, skipping binds the previous mesh already made
+        GLint layer = -1;
         if (!mesh.material.diffuseTexture.empty()) {
+            GLuint diffuseTex = 0;
             auto it = loadedTextures.find(mesh.material.diffuseTexture);
+            auto packed = arrayLayers.find(mesh.material.diffuseTexture);
             if (it != loadedTextures.end()) {
                 diffuseTex = it->second;
+                // One texture repeat covers pixels / uvExtent of the screen
+                TextureStreamer::Shared().Request(diffuseTex, pixels / std::max(mesh.uvExtent, 1e-3f));
+            }
+            else if (packed != arrayLayers.end()) {
+                layer = packed->second.layer;
+                if (packed->second.array != boundArray) {
+                    boundArray = packed->second.array;
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D_ARRAY, boundArray);
+                    ++renderStats.textureBinds;
+                }
+            }
+            else {
+                RequestTexture(mesh.material.diffuseTexture);
+                diffuseTex = PlaceholderTexture();
+                ++renderStats.placeholderMeshes;
+            }
+            if (diffuseTex && diffuseTex != boundTexture) {
+                boundTexture = diffuseTex;
                 glActiveTexture(GL_TEXTURE0);
                 glBindTexture(GL_TEXTURE_2D, diffuseTex);
-                glUniform1i(glGetUniformLocation(shaderProgram, "material.diffuse"), 0);
-
                 // Use same texture for specular if no separate specular map
                 glActiveTexture(GL_TEXTURE1);
                 glBindTexture(GL_TEXTURE_2D, diffuseTex);
-                glUniform1i(glGetUniformLocation(shaderProgram, "material.specular"), 1);
+                ++renderStats.textureBinds;
             }
+            glUniform1i(uniforms.materialDiffuse, 0);
+            glUniform1i(uniforms.materialSpecular, 1);
         }
+        glUniform1i(uniforms.diffuseLayer, layer);
 
         // Set material properties
-        glUniform3fv(glGetUniformLocation(shaderProgram, "material.ambient"), 1,
-            glm::value_ptr(mesh.material.ambient));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "material.diffuse"), 1,
-            glm::value_ptr(mesh.material.diffuse));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "material.specular"), 1,
-            glm::value_ptr(mesh.material.specular));
-        glUniform1f(glGetUniformLocation(shaderProgram, "material.shininess"), 10);
+        glUniform3fv(uniforms.materialAmbient, 1, glm::value_ptr(mesh.material.ambient));
+        glUniform3fv(uniforms.materialDiffuse, 1, glm::value_ptr(mesh.material.diffuse));
+        glUniform3fv(uniforms.materialSpecular, 1, glm::value_ptr(mesh.material.specular));
+        glUniform1f(uniforms.materialShininess, 10);
 //            mesh.material.shininess);
+        glUniform3fv(uniforms.positionOffset, 1, glm::value_ptr(mesh.positionOffset));
+        glUniform3fv(uniforms.positionScale, 1, glm::value_ptr(mesh.positionScale));
 
         // Draw the mesh
-        glBindVertexArray(mesh.VAO);
-        glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
+        size_t offset = mesh.indexOffset + level.firstIndex * IndexSize(mesh.indexType);
+        glDrawElementsBaseVertex(GL_TRIANGLES, GLsizei(level.indexCount), mesh.indexType,
+            (void*)offset, mesh.baseVertex);
     }
 }
 
 void Model::Cleanup() {
-    for (auto& mesh : meshes) {
-        glDeleteVertexArrays(1, &mesh.VAO);
-    }
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    if (VBO) glDeleteBuffers(1, &VBO);
+    if (EBO) glDeleteBuffers(1, &EBO);
+    VAO = VBO = EBO = 0;
     for (auto& tex : loadedTextures) {
-        glDeleteTextures(1, &tex.second);
+        TextureCache::Shared().Release(tex.second);
     }
+    if (placeholderTexture) glDeleteTextures(1, &placeholderTexture);
+    placeholderTexture = 0;
+    if (!textureArrays.empty()) glDeleteTextures(GLsizei(textureArrays.size()), textureArrays.data());
+    textureArrays.clear();
+    arrayLayers.clear();
+    textureHashes.clear();
+    meshUniforms.clear();
     meshes.clear();
     loadedTextures.clear();
+    reloadGenerations.clear();   // drops reloads still in flight
+    requestedTextures.clear();
+    textureInbox = std::make_shared<TextureInbox>();
+}
+
+// Takes over a reparsed copy of this model. While every mesh keeps its place in
+// the shared buffers, only meshes whose content changed are re-uploaded;
+// otherwise the buffers are rebuilt. Returns the number of meshes uploaded.
+size_t Model::SwapMeshes(Model& staged) {
+    bool inPlace = VAO != 0 && staged.meshes.size() == meshes.size() &&
+        staged.options.vertexFormat == options.vertexFormat &&
+        staged.stats.vertexBytes == stats.vertexBytes &&
+        staged.stats.indexBytes == stats.indexBytes;
+    for (size_t i = 0; inPlace && i < meshes.size(); ++i) {
+        inPlace = staged.meshes[i].baseVertex == meshes[i].baseVertex &&
+            staged.meshes[i].indexOffset == meshes[i].indexOffset &&
+            staged.meshes[i].indexType == meshes[i].indexType;
+    }
+
+    size_t uploaded = 0;
+    if (inPlace) {
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            Mesh& fresh = staged.meshes[i];
+            if (fresh.contentHash == meshes[i].contentHash) {
+                meshes[i].material = fresh.material;
+                meshes[i].group = fresh.group;
+                continue;
+            }
+            UploadMesh(fresh);
+            ReleaseGeometry(fresh);
+            fresh.currentLod = std::min(meshes[i].currentLod, unsigned(fresh.lods.size() - 1));
+            meshes[i] = std::move(fresh);
+            ++uploaded;
+        }
+    }
+    else {
+        if (VAO) glDeleteVertexArrays(1, &VAO);
+        if (VBO) glDeleteBuffers(1, &VBO);
+        if (EBO) glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+        stats = staged.stats;
+        CreateBuffers();
+        for (auto& mesh : staged.meshes) {
+            UploadMesh(mesh);
+            ReleaseGeometry(mesh);
+        }
+        meshes = std::move(staged.meshes);
+        uploaded = meshes.size();
+    }
+    options = staged.options;
+    stats = staged.stats;
+    sourceFiles = staged.sourceFiles;
+    return uploaded;
+}
+
+// A material keeps its name across edits, so meshes are matched by name.
+void Model::SwapMaterials(const std::vector<Material>& materials) {
+    for (auto& mesh : meshes) {
+        for (const auto& material : materials) {
+            if (material.name == mesh.material.name) {
+                mesh.material = material;
+                break;
+            }
+        }
+    }
+}
+
+static size_t ImageGpuBytes(const DecodedImage& image) {
+    if (image.blockFormat == BlockFormat::None) {
+        return EstimateTextureBytes(image.width, image.height, image.components, true);
+    }
+    size_t bytes = 0;
+    for (const auto& level : image.levels) bytes += level.size;
+    return bytes;
+}
+
+// Writes every level of 'image' into one layer of the bound array, or level 0
+// only when it has no stored chain.
+static void UploadArrayLayer(const DecodedImage& image, int layer) {
+    GLenum format = ImageInternalFormat(image);
+    GLenum clientFormat = TextureFormat(image.components);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    PixelUploadRing& ring = PixelUploadRing::Shared();
+    if (image.levels.empty()) {
+        const void* source = ring.Stage(image.pixels, size_t(image.width) * image.height * image.components);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, image.width, image.height, 1, clientFormat,
+            GL_UNSIGNED_BYTE, source);
+    }
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        const ImageLevel& level = image.levels[i];
+        const void* source = ring.Stage(level.pixels, level.size);
+        if (image.blockFormat != BlockFormat::None) {
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, GLint(i), 0, 0, layer, level.width, level.height, 1,
+                format, GLsizei(level.size), source);
+        }
+        else {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, GLint(i), 0, 0, layer, level.width, level.height, 1,
+                clientFormat, GL_UNSIGNED_BYTE, source);
+        }
+    }
+    ring.Finish();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// Moves small images that share a size, format and level count into one
+// GL_TEXTURE_2D_ARRAY each and removes them from 'images'. Sizes that only
+// one image has are left alone, since a one-layer array saves no binds.
+// Layers keep their own UVs and GL_REPEAT, which an atlas could not.
+void Model::PackTextures(std::vector<std::shared_ptr<DecodedImage>>& images) {
+    const int maxSize = options.arrayTextureMaxSize;
+    if (maxSize <= 0) return;
+
+    std::map<std::array<size_t, 4>, std::vector<std::shared_ptr<DecodedImage>>> groups;
+    for (const auto& image : images) {
+        if (image->width > maxSize || image->height > maxSize) continue;
+        if (arrayLayers.count(image->path) || loadedTextures.count(image->path)) continue;
+        groups[{ size_t(image->width), size_t(image->height), size_t(image->components),
+            image->levels.size() << 8 | size_t(image->blockFormat) }].push_back(image);
+    }
+
+    for (auto& group : groups) {
+        std::vector<std::shared_ptr<DecodedImage>>& members = group.second;
+        if (members.size() < 2) continue;
+        const DecodedImage& first = *members[0];
+        GLenum format = ImageInternalFormat(first);
+
+        AssetLoadRecord record;
+        record.kind = "TextureArray";
+        record.path = first.path + " (+" + std::to_string(members.size() - 1) + ")";
+        LoadTimer timer;
+
+        GLuint array;
+        glGenTextures(1, &array);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+        size_t levelCount = std::max<size_t>(1, first.levels.size());
+        for (size_t level = 0; level < levelCount; ++level) {
+            int width = std::max(1, first.width >> level);
+            int height = std::max(1, first.height >> level);
+            if (first.blockFormat != BlockFormat::None) {
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, GLint(level), format, width, height,
+                    GLsizei(members.size()), 0, GLsizei(first.levels[level].size * members.size()), nullptr);
+            }
+            else {
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, GLint(level), format, width, height, GLsizei(members.size()), 0,
+                    TextureFormat(first.components), GL_UNSIGNED_BYTE, nullptr);
+            }
+        }
+        for (size_t layer = 0; layer < members.size(); ++layer) {
+            const DecodedImage& image = *members[layer];
+            UploadArrayLayer(image, int(layer));
+            arrayLayers[image.path] = { array, int(layer), image.width, image.height, image.components,
+                image.levels.size(), image.blockFormat };
+            textureHashes[image.path] = image.contentHash;
+            record.ioMs += image.ioMs;
+            record.parseMs += image.decodeMs;
+            record.bytesRead += image.fileBytes;
+        }
+        record.uploadMs = timer.Lap();
+        if (first.levels.empty()) {
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            record.mipMs = timer.Lap();
+        }
+        else {
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, GLint(first.levels.size() - 1));
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        textureArrays.push_back(array);
+
+        record.totalMs = record.ioMs + record.parseMs + record.uploadMs + record.mipMs;
+        record.gpuBytes = ImageGpuBytes(first) * members.size();
+        LoadReport::Shared().Add(record);
+    }
+
+    images.erase(std::remove_if(images.begin(), images.end(), [this](const std::shared_ptr<DecodedImage>& image) {
+        return arrayLayers.count(image->path) > 0;
+    }), images.end());
+}
+
+void Model::ReplaceTexture(const std::shared_ptr<DecodedImage>& decoded) {
+    const DecodedImage& image = *decoded;
+    // A packed texture is rewritten in its layer while it still fits there;
+    // otherwise it moves out to a texture of its own
+    auto packed = arrayLayers.find(image.path);
+    if (packed != arrayLayers.end()) {
+        const ArrayLayer& slot = packed->second;
+        if (slot.width == image.width && slot.height == image.height &&
+            slot.components == image.components && slot.levels == image.levels.size() &&
+            slot.blockFormat == image.blockFormat) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, slot.array);
+            UploadArrayLayer(image, slot.layer);
+            if (image.levels.empty()) glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            textureHashes[image.path] = image.contentHash;
+            return;
+        }
+        arrayLayers.erase(packed);
+    }
+
+    auto previous = loadedTextures.find(image.path);
+    GLuint old = previous != loadedTextures.end() ? previous->second : 0;
+    UploadTexture(decoded);
+    if (old) TextureCache::Shared().Release(old);
+}
+
+void Model::ReleaseUnusedTextures() {
+    for (auto it = loadedTextures.begin(); it != loadedTextures.end(); ) {
+        bool used = std::any_of(meshes.begin(), meshes.end(), [&](const Mesh& mesh) {
+            return mesh.material.diffuseTexture == it->first;
+        });
+        if (used) {
+            ++it;
+            continue;
+        }
+        TextureCache::Shared().Release(it->second);
+        requestedTextures.erase(it->first);
+        textureHashes.erase(it->first);
+        it = loadedTextures.erase(it);
+    }
+    // Unused layers stay allocated until Cleanup
+    for (auto it = arrayLayers.begin(); it != arrayLayers.end(); ) {
+        bool used = std::any_of(meshes.begin(), meshes.end(), [&](const Mesh& mesh) {
+            return mesh.material.diffuseTexture == it->first;
+        });
+        if (!used) textureHashes.erase(it->first);
+        it = used ? std::next(it) : arrayLayers.erase(it);
+    }
+}
+
+void Model::PrefetchTextures() {
+    for (const auto& mesh : meshes) {
+        if (!mesh.material.diffuseTexture.empty() &&
+            loadedTextures.find(mesh.material.diffuseTexture) == loadedTextures.end()) {
+            RequestTexture(mesh.material.diffuseTexture);
+        }
+    }
+}
+
+// Takes a reference to a texture already in TextureCache::Shared().
+GLuint Model::AcquireTexture(const std::string& path) {
+    auto loaded = loadedTextures.find(path);
+    if (loaded != loadedTextures.end()) return loaded->second;
+    GLuint texture = TextureCache::Shared().Acquire(TextureCacheName(options, path));
+    if (texture) loadedTextures[path] = texture;
+    return texture;
+}
+
+// Decodes on ThreadPool::Shared(); ResolveTextures uploads the result. A
+// texture that fails to decode is not retried, and keeps the placeholder.
+void Model::RequestTexture(const std::string& path) {
+    if (AcquireTexture(path) || !requestedTextures.insert(path).second) return;
+    std::shared_ptr<TextureInbox> inbox = textureInbox;
+    bool useMipCache = options.useMipCache;
+    TextureCompression compression = CompressionFor(options, path);
+    ThreadPool::Shared().Submit([inbox, path, useMipCache, compression]() {
+        auto image = std::make_shared<DecodedImage>();
+        if (!DecodeTexture(path, useMipCache, compression, *image)) return;
+        std::lock_guard<std::mutex> lock(inbox->mutex);
+        inbox->ready.push_back(image);
+    });
+}
+
+// Uploads a few finished decodes per call, so a burst of newly visible
+// textures is spread over frames.
+void Model::ResolveTextures() {
+    std::vector<std::shared_ptr<DecodedImage>> ready;
+    {
+        std::lock_guard<std::mutex> lock(textureInbox->mutex);
+        if (textureInbox->ready.empty()) return;
+        size_t count = std::min(textureInbox->ready.size(), TEXTURE_UPLOADS_PER_RENDER);
+        ready.assign(textureInbox->ready.begin(), textureInbox->ready.begin() + count);
+        textureInbox->ready.erase(textureInbox->ready.begin(), textureInbox->ready.begin() + count);
+    }
+    for (const auto& image : ready) {
+        if (loadedTextures.find(image->path) == loadedTextures.end()) {
+            UploadTexture(image);
+        }
+    }
+}
+
+// Mid grey, since the shader takes diffuse and specular color from the texture
+GLuint Model::PlaceholderTexture() {
+    if (placeholderTexture) return placeholderTexture;
+    const unsigned char grey[4] = { 128, 128, 128, 255 };
+    glGenTextures(1, &placeholderTexture);
+    glBindTexture(GL_TEXTURE_2D, placeholderTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return placeholderTexture;
 }
 
 bool Model::LoadOBJ(const std::string& path) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    LoadTimer ioTimer;
+    AssetFile file;
+    if (!file.Open(path)) {
         std::cerr << "ERROR: Failed to open OBJ file: " << path << std::endl;
         return false;
     }
+    stats.ioMs += ioTimer.Lap();
+    stats.bytesRead += file.Size();
 
+    sourceFiles.assign(1, path);
     std::string baseDir = path.substr(0, path.find_last_of("/\\") + 1);
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texCoords;
+
+    ThreadPool& pool = ThreadPool::Shared();
+    unsigned threads = options.parseThreads ? options.parseThreads : pool.Size() + 1;
+    // Serially the file is one chunk, up to OBJ_MAX_CHUNK_BYTES, so there is
+    // nothing to stitch; the chunked result must match it exactly
+    size_t targetChunks = threads == 1 ? 1 : size_t(threads) * 4;
+    std::vector<ObjChunk> chunks = SplitObjChunks(file.Data(), file.Size(), targetChunks);
+    pool.ParallelFor(chunks.size(), [&](size_t i) {
+        if (!LoadCancelled()) ParseObjChunk(chunks[i]);
+    }, threads);
+    if (LoadCancelled()) return false;
+
+    // OBJ indices are global, so lay the chunk attribute lists end to end
+    glm::ivec3 total(0);
+    for (auto& chunk : chunks) {
+        chunk.base = total;
+        total += glm::ivec3(int(chunk.positions.size()), int(chunk.texCoords.size()), int(chunk.normals.size()));
+    }
+    std::vector<glm::vec3> positions(total.x);
+    std::vector<glm::vec3> normals(total.z);
+    std::vector<glm::vec2> texCoords(total.y);
+    pool.ParallelFor(chunks.size(), [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.base.x);
+        std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.base.y);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.base.z);
+    }, threads);
+
+    // Replay material and group statements in file order and hand every run
+    // of faces to the mesh its usemtl (and o/g, with splitGroups) selects.
+    struct FaceRun {
+        const ObjChunk* chunk;
+        const ObjStatement* faces;
+    };
+    std::vector<std::vector<FaceRun>> meshRuns;
     std::vector<Material> materials;
     std::string currentMtl;
+    std::string currentGroup;
+    std::string meshKey;
 
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string prefix;
-        iss >> prefix;
+    // Names are hashed once per usemtl or o/g switch rather than compared per
+    // face; consecutive face runs under the same statements reuse the mesh.
+    std::unordered_map<std::string, size_t> materialIndex;   // name -> materials[]
+    std::unordered_map<std::string, size_t> meshIndex;       // group '\n' material -> meshes[]
+    const size_t noMesh = size_t(-1);
+    size_t currentMesh = noMesh;
 
-        if (prefix == "v") {
-            glm::vec3 pos;
-            iss >> pos.x >> pos.y >> pos.z;
-            positions.push_back(pos);
-        }
-        else if (prefix == "vn") {
-            glm::vec3 norm;
-            iss >> norm.x >> norm.y >> norm.z;
-            normals.push_back(norm);
-        }
-        else if (prefix == "vt") {
-            glm::vec2 uv;
-            iss >> uv.x >> uv.y;
-            texCoords.push_back(uv);
-        }
-        else if (prefix == "usemtl") {
-            iss >> currentMtl;
-        }
-        else if (prefix == "f") {
-            if (currentMtl.empty()) {
-                currentMtl = "default_material";
+    for (const auto& chunk : chunks) {
+        for (const auto& statement : chunk.statements) {
+            if (statement.kind == ObjStatement::UseMtl) {
+                currentMtl = statement.name;
+                currentMesh = noMesh;
+                continue;
             }
-
-            // Find or create mesh for this material
-            Mesh* mesh = nullptr;
-            for (auto& m : meshes) {
-                if (m.material.name == currentMtl) {
-                    mesh = &m;
-                    break;
+            if (statement.kind == ObjStatement::Group) {
+                if (options.splitGroups) {
+                    currentGroup = statement.name;
+                    currentMesh = noMesh;
                 }
+                continue;
             }
-
-            if (!mesh) {
-                meshes.emplace_back();
-                mesh = &meshes.back();
-                mesh->material = Material();
-                for (const auto& mat : materials) {
-                    if (mat.name == currentMtl) {
-                        mesh->material = mat;
-                        break;
-                    }
+            if (statement.kind == ObjStatement::MtlLib) {
+                std::string mtlFile(statement.name);
+                size_t firstNew = materials.size();
+                if (LoadMTL(baseDir + mtlFile, materials)) {
+                    sourceFiles.push_back(baseDir + mtlFile);
                 }
-                if (mesh->material.name.empty()) {
-                    mesh->material.name = currentMtl;
-                    mesh->material.diffuse = glm::vec3(1.0f, 0.0f, 1.0f);
+                // First definition of a name wins, as with a front-to-back search
+                for (size_t i = firstNew; i < materials.size(); ++i) {
+                    materialIndex.emplace(materials[i].name, i);
                 }
+                continue;
             }
 
-            if (!ProcessFace(iss, positions, normals, texCoords, *mesh)) {
-                std::cerr << "ERROR: Failed to process face: " << line << std::endl;
+            ++stats.faceRuns;
+            if (currentMesh == noMesh) {
+                if (currentMtl.empty()) {
+                    currentMtl = "default_material";
+                }
+                ++stats.meshLookups;
+
+                // Find or create mesh for this group and material
+                meshKey.assign(currentGroup).append(1, '\n').append(currentMtl);
+                auto found = meshIndex.find(meshKey);
+                if (found != meshIndex.end()) {
+                    currentMesh = found->second;
+                }
+                else {
+                    currentMesh = meshes.size();
+                    meshIndex.emplace(meshKey, currentMesh);
+                    meshes.emplace_back();
+                    meshRuns.emplace_back();
+                    Mesh* mesh = &meshes.back();
+                    mesh->material = Material();
+                    mesh->group = currentGroup;
+
+                    auto mat = materialIndex.find(currentMtl);
+                    if (mat != materialIndex.end()) {
+                        mesh->material = materials[mat->second];
+                    }
+                    else {
+                        mesh->material.name = currentMtl;
+                        mesh->material.diffuse = glm::vec3(1.0f, 0.0f, 1.0f);
+                    }
+                }
             }
-        }
-        else if (prefix == "mtllib") {
-            std::string mtlFile;
-            iss >> mtlFile;
-            LoadMTL(baseDir + mtlFile, materials);
+            meshRuns[currentMesh].push_back({ &chunk, &statement });
         }
     }
 
-    // Create VAOs for all meshes
-    for (auto& mesh : meshes) {
-        mesh.VAO = SetupMeshVAO(mesh);
+    // Meshes are independent of each other, so each one is built on its own thread
+    std::vector<std::vector<const char*>> failedFaces(meshes.size());
+    pool.ParallelFor(meshes.size(), [&](size_t m) {
+        if (LoadCancelled()) return;
+        Mesh& mesh = meshes[m];
+        VertexWeldMap weldMap;
+
+        for (const FaceRun& run : meshRuns[m]) {
+            const ObjChunk& chunk = *run.chunk;
+            glm::ivec3 available = chunk.base + run.faces->attribCounts;
+
+            for (size_t f = run.faces->firstFace; f < run.faces->firstFace + run.faces->faceCount; ++f) {
+                uint32_t first = f == 0 ? 0 : chunk.faceCornerEnd[f - 1];
+                uint32_t last = chunk.faceCornerEnd[f];
+                if (!ProcessFace(chunk.corners.data() + first, last - first, positions, normals, texCoords,
+                        available, mesh, options.weldVertices ? &weldMap : nullptr)) {
+                    failedFaces[m].push_back(chunk.begin + chunk.faceLine[f]);
+                }
+            }
+        }
+    }, threads);
+
+    if (LoadCancelled()) return false;
+
+    std::vector<const char*> failedLines;
+    for (const auto& lines : failedFaces) {
+        failedLines.insert(failedLines.end(), lines.begin(), lines.end());
+    }
+    std::sort(failedLines.begin(), failedLines.end());
+    const char* fileEnd = file.Data() + file.Size();
+    for (const char* line : failedLines) {
+        const char* lineEnd = static_cast<const char*>(memchr(line, '\n', fileEnd - line));
+        std::cerr << "ERROR: Failed to process face: "
+            << std::string_view(line, (lineEnd ? lineEnd : fileEnd) - line) << std::endl;
     }
 
     return !meshes.empty();
 }
 
+// The glTF data is binary already; it still goes through clustering,
+// optimization and LODs like an OBJ, so the mesh cache applies to it too.
+bool Model::LoadGLB(const std::string& path) {
+    sourceFiles.assign(1, path);
+    GlbLoadStats glbStats;
+    if (!LoadGlb(path, options.splitGroups, meshes, glbStats)) {
+        return false;
+    }
+    stats.ioMs += glbStats.ioMs;
+    stats.bytesRead += glbStats.bytesRead;
+    stats.glbPrimitives = glbStats.primitives;
+    stats.glbDirectPrimitives = glbStats.directPrimitives;
+    return true;
+}
+
 bool Model::LoadMTL(const std::string& path, std::vector<Material>& materials) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    LoadTimer timer;
+    AssetLoadRecord record;
+    record.kind = "MTL";
+    record.path = path;
+    AssetFile source;
+    if (!source.Open(path)) {
         std::cerr << "ERROR: Failed to open MTL file: " << path << std::endl;
         return false;
     }
+    record.ioMs = timer.Lap();
+    record.bytesRead = source.Size();
+    stats.ioMs += record.ioMs;
+    stats.bytesRead += record.bytesRead;
+    std::istringstream file(std::string(source.Data(), source.Size()));
 
     std::string baseDir = path.substr(0, path.find_last_of("/\\") + 1);
     Material* currentMtl = nullptr;
@@ -182,16 +1751,41 @@ bool Model::LoadMTL(const std::string& path, std::vector<Material>& materials) {
                 std::string texFile;
                 iss >> texFile;
                 currentMtl->diffuseTexture = baseDir + texFile;
-                LoadTexture(currentMtl->diffuseTexture); // Preload texture
             }
         }
     }
 
+    record.parseMs = timer.Lap();
+    record.totalMs = record.ioMs + record.parseMs;
+    LoadReport::Shared().Add(record);
     return !materials.empty();
 }
 
-GLuint Model::SetupMeshVAO(const Mesh& mesh) {
-    GLuint VAO, VBO, EBO;
+// Assigns every mesh its range in the shared buffers. 32-bit ranges are
+// aligned to 4 bytes so mixed index types can share one EBO.
+void Model::LayoutMeshes() {
+    const size_t vertexSize = options.vertexFormat == VertexFormat::Packed16 ? sizeof(PackedVertex) : sizeof(Vertex);
+    size_t vertexCount = 0;
+    size_t indexBytes = 0;
+
+    for (auto& mesh : meshes) {
+        mesh.indexType = mesh.VertexCount() <= MAX_SHORT_INDEX_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        const size_t indexSize = IndexSize(mesh.indexType);
+        indexBytes = (indexBytes + indexSize - 1) / indexSize * indexSize;
+
+        mesh.baseVertex = GLint(vertexCount);
+        mesh.indexOffset = indexBytes;
+        vertexCount += mesh.VertexCount();
+        indexBytes += mesh.IndexCount() * indexSize;
+    }
+
+    stats.vertexBytes = vertexCount * vertexSize;
+    stats.indexBytes = indexBytes;
+}
+
+// Allocates the shared buffers at the size LayoutMeshes worked out; the
+// meshes are filled in afterwards by UploadMesh.
+void Model::CreateBuffers() {
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
@@ -199,117 +1793,315 @@ GLuint Model::SetupMeshVAO(const Mesh& mesh) {
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), &mesh.vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, stats.vertexBytes, nullptr, GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), &mesh.indices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, stats.indexBytes, nullptr, GL_STATIC_DRAW);
+
+    if (options.vertexFormat == VertexFormat::Packed16) {
+        // Normalized formats; the vertex shader rescales positions to the mesh bounds
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoord));
+    }
+    else {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
+    }
 
     glBindVertexArray(0);
-    return VAO;
 }
 
-GLuint Model::LoadTexture(const std::string& path) {
-    if (path.empty()) return 0;
-    if (loadedTextures.find(path) != loadedTextures.end()) {
-        return loadedTextures[path];
+void Model::UploadMesh(Mesh& mesh) {
+    // GL_COPY_WRITE_BUFFER leaves the VAO's element binding alone
+    glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    const PackedVertex* packed = mesh.packedVertices.empty() ? mesh.mappedPackedVertices : mesh.packedVertices.data();
+    if (packed) {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, mesh.baseVertex * sizeof(PackedVertex),
+            mesh.VertexCount() * sizeof(PackedVertex), packed);
+        // The packed copy only exists to be uploaded
+        std::vector<PackedVertex>().swap(mesh.packedVertices);
+        mesh.mappedPackedVertices = nullptr;
+    }
+    else {
+        mesh.positionOffset = glm::vec3(0.0f);
+        mesh.positionScale = glm::vec3(1.0f);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, mesh.baseVertex * sizeof(Vertex),
+            mesh.VertexCount() * sizeof(Vertex), mesh.VertexData());
     }
 
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    stbi_set_flip_vertically_on_load(true);
+    // The CPU copy stays 32-bit; only the EBO range is narrowed, which takes
+    // one pass over the indices even when they come straight from the cache
+    glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    const unsigned int* indices = mesh.IndexData();
+    if (mesh.indexType == GL_UNSIGNED_SHORT) {
+        std::vector<uint16_t> shortIndices(indices, indices + mesh.IndexCount());
+        glBufferSubData(GL_COPY_WRITE_BUFFER, mesh.indexOffset,
+            shortIndices.size() * sizeof(uint16_t), shortIndices.data());
+    }
+    else {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, mesh.indexOffset,
+            mesh.IndexCount() * sizeof(unsigned int), indices);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
 
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
+// Frees whatever the residency policy does not keep, once the mesh is on the GPU.
+// A mesh still reading from the mesh cache copies out what is kept and lets go
+// of the mapping, so the cache file can be rewritten on the next reload.
+void Model::ReleaseGeometry(Mesh& mesh) {
+    if (mesh.mapping) {
+        if (options.residency == GeometryResidency::KeepAll) {
+            mesh.vertices.assign(mesh.mappedVertices, mesh.mappedVertices + mesh.mappedVertexCount);
+            mesh.indices.assign(mesh.mappedIndices, mesh.mappedIndices + mesh.mappedIndexCount);
+        }
+        else if (options.residency == GeometryResidency::PositionsOnly) {
+            mesh.positions.resize(mesh.mappedVertexCount);
+            for (size_t i = 0; i < mesh.mappedVertexCount; ++i) {
+                mesh.positions[i] = mesh.mappedVertices[i].position;
+            }
+            size_t fullCount = mesh.lods.empty() ? mesh.mappedIndexCount : mesh.lods[0].indexCount;
+            mesh.indices.assign(mesh.mappedIndices, mesh.mappedIndices + fullCount);
+        }
+        mesh.mapping.reset();
+        mesh.mappedVertices = nullptr;
+        mesh.mappedIndices = nullptr;
+        mesh.mappedPackedVertices = nullptr;
+        mesh.mappedVertexCount = mesh.mappedIndexCount = 0;
+        return;
+    }
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    switch (options.residency) {
+    case GeometryResidency::KeepAll:
+        return;
+    case GeometryResidency::PositionsOnly:
+        mesh.positions.resize(mesh.vertices.size());
+        for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+            mesh.positions[i] = mesh.vertices[i].position;
+        }
+        // Coarser levels only live on the GPU
+        if (!mesh.lods.empty()) mesh.indices.resize(mesh.lods[0].indexCount);
+        mesh.indices.shrink_to_fit();
+        break;
+    case GeometryResidency::DropAfterUpload:
+        std::vector<unsigned int>().swap(mesh.indices);
+        break;
+    }
+    std::vector<Vertex>().swap(mesh.vertices);
+}
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void Model::QueueTexture(const std::string& path) {
+    if (path.empty()) return;
+    if (std::find(pendingTextures.begin(), pendingTextures.end(), path) == pendingTextures.end()) {
+        pendingTextures.push_back(path);
+    }
+}
 
-        stbi_image_free(data);
-        loadedTextures[path] = textureID;
+// 'glb' is the .glb an embedded image path points into, already opened.
+bool Model::DecodeTexture(const std::string& path, bool useMipCache, TextureCompression compression,
+    DecodedImage& image, const GlbFile* glb) {
+    if (IsGlbImagePath(path)) {
+        // glTF UVs start at the top left, so these stay in file row order
+        image.path = path;
+        LoadTimer timer;
+        std::vector<unsigned char> bytes;
+        if (ReadGlbImage(path, bytes, glb)) {
+            image.ioMs = timer.Lap();
+            image.fileBytes = bytes.size();
+            if (useMipCache) DecodeImageMemoryMips(bytes.data(), bytes.size(), false, image, compression);
+            else DecodeImageMemory(bytes.data(), bytes.size(), false, image);
+        }
+    }
+    else if (useMipCache) {
+        DecodeImageFileMips(path, true, image, compression);
     }
     else {
+        DecodeImageFile(path, true, image);
+    }
+    if (!image.HasPixels()) {
         std::cerr << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-        return 0;
+        return false;
+    }
+    // Without the cache the chain is built and compressed again on every load
+    if (!useMipCache && compression != TextureCompression::None && image.pixels) {
+        LoadTimer timer;
+        BuildMipChain(image);
+        CompressMipChain(image, compression);
+        image.decodeMs += timer.Lap();
+    }
+    return true;
+}
+
+// Decodes on ThreadPool::Shared() and the calling thread. Returns the images
+// that decoded, in the order of 'paths'.
+std::vector<std::shared_ptr<DecodedImage>> Model::DecodeTextures(const std::vector<std::string>& paths,
+    const ModelLoadOptions& options, const std::atomic<bool>* cancel) {
+    // Each .glb is opened and its JSON parsed once for all of its images
+    std::unordered_map<std::string, std::shared_ptr<const GlbFile>> glbFiles;
+    for (const auto& path : paths) {
+        if (IsGlbImagePath(path) && !glbFiles.count(GlbImageFile(path))) {
+            glbFiles[GlbImageFile(path)] = OpenGlbFile(GlbImageFile(path));
+        }
+    }
+    std::vector<std::shared_ptr<DecodedImage>> images(paths.size());
+    ThreadPool::Shared().ParallelFor(paths.size(), [&](size_t i) {
+        if (cancel && cancel->load()) return;
+        auto image = std::make_shared<DecodedImage>();
+        const GlbFile* glb = nullptr;
+        if (IsGlbImagePath(paths[i])) {
+            glb = glbFiles[GlbImageFile(paths[i])].get();
+            if (!glb) return;   // the .glb failed to open; already reported
+        }
+        if (DecodeTexture(paths[i], options.useMipCache, CompressionFor(options, paths[i]), *image, glb)) {
+            images[i] = image;
+        }
+    });
+    images.erase(std::remove(images.begin(), images.end(), nullptr), images.end());
+    return images;
+}
+
+// Shares the texture through TextureCache::Shared(), so identical bytes
+// under another path or in another model are not uploaded again.
+GLuint Model::UploadTexture(const std::shared_ptr<DecodedImage>& image) {
+    bool stream = options.streamTextures;
+    GLuint textureID = TextureCache::Shared().AcquireOrCreate(TextureCacheName(options, image->path),
+        TextureCacheContentKey(options, *image),
+        [&image, stream]() { return CreateTexture(image, stream); });
+    loadedTextures[image->path] = textureID;
+    textureHashes[image->path] = image->contentHash;
+    return textureID;
+}
+
+// With 'stream', a texture that has a mip chain starts as its tail and
+// TextureStreamer brings in the rest as draws ask for it.
+GLuint Model::CreateTexture(const std::shared_ptr<DecodedImage>& decoded, bool stream) {
+    const DecodedImage& image = *decoded;
+    GLenum format = ImageInternalFormat(image);
+
+    AssetLoadRecord record;
+    record.kind = "Texture";
+    record.path = image.path;
+    record.ioMs = image.ioMs;
+    record.parseMs = image.decodeMs;
+    record.bytesRead = image.fileBytes;
+    LoadTimer timer;
+
+    GLuint textureID;
+    if (stream && TextureStreamer::Shared().CanStream(image)) {
+        textureID = TextureStreamer::Shared().Create(decoded, format);
+        record.kind = "StreamedTexture";
+    }
+    else {
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        UploadImageLevels(image, format);
+    }
+    record.uploadMs = timer.Lap();
+    if (image.levels.empty()) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        record.mipMs = timer.Lap();
     }
 
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Decoding may have run on another thread, so the total is the sum of the phases
+    record.totalMs = record.ioMs + record.parseMs + record.uploadMs + record.mipMs;
+    record.gpuBytes = ImageGpuBytes(image);
+    if (record.kind == "StreamedTexture") {
+        record.gpuBytes = TextureStreamer::Shared().ResidentBytes(textureID);
+    }
+    LoadReport::Shared().Add(record);
     return textureID;
 }
 
-bool Model::ProcessFace(std::istringstream& iss,
+bool Model::ProcessFace(const glm::ivec3* corners, size_t cornerCount,
     const std::vector<glm::vec3>& positions,
     const std::vector<glm::vec3>& normals,
     const std::vector<glm::vec2>& texCoords,
-    Mesh& mesh) {
-    std::vector<Vertex> faceVertices;
-    std::string vertexData;
+    const glm::ivec3& available,
+    Mesh& mesh, VertexWeldMap* weldMap) {
+    // Every corner is checked before anything is emitted, so a bad face
+    // leaves no welded vertices or partial triangles behind.
+    if (cornerCount < 3) return false;
+    for (size_t corner = 0; corner < cornerCount; ++corner) {
+        int posIdx = corners[corner].x;
+        if (posIdx < 0) posIdx += available.x + 1;
+        if (posIdx < 1 || posIdx > available.x) return false;
+    }
 
-    while (iss >> vertexData) {
-        std::replace(vertexData.begin(), vertexData.end(), '/', ' ');
-        std::istringstream viss(vertexData);
+    // Triangulate as a fan, so no per-face storage is needed.
+    Vertex first, previous;
+    unsigned int firstIdx = 0, previousIdx = 0;
 
-        Vertex vertex;
-        int posIdx = 0, texIdx = 0, normIdx = 0;
+    for (size_t corner = 0; corner < cornerCount; ++corner) {
+        int posIdx = corners[corner].x;
+        int texIdx = corners[corner].y;
+        int normIdx = corners[corner].z;
 
-        if (!(viss >> posIdx)) return false;
-        if (viss.peek() != EOF) viss >> texIdx;
-        if (viss.peek() != EOF) viss >> normIdx;
+        // Negative indices are relative to the end of the lists read so far,
+        // and only what was read before this face may be referenced.
+        if (posIdx < 0) posIdx += available.x + 1;
+        if (texIdx < 0) texIdx += available.y + 1;
+        if (normIdx < 0) normIdx += available.z + 1;
 
-        if (posIdx < 1 || posIdx > positions.size()) return false;
-        vertex.position = positions[posIdx - 1];
+        if (texIdx < 1 || texIdx > available.y) texIdx = 0;
+        if (normIdx < 1 || normIdx > available.z) normIdx = 0;
 
-        if (texIdx > 0 && texIdx <= texCoords.size()) {
-            vertex.texCoord = texCoords[texIdx - 1];
-        }
-        else {
-            vertex.texCoord = glm::vec2(0.0f);
-        }
+        Vertex vertex;
+        unsigned int vertexIdx = 0;
+        VertexWeldMap::Slot* slot = weldMap ? &weldMap->Find(posIdx, texIdx, normIdx) : nullptr;
 
-        if (normIdx > 0 && normIdx <= normals.size()) {
-            vertex.normal = normals[normIdx - 1];
+        if (slot && slot->pos != 0) {
+            vertexIdx = slot->index;
         }
         else {
-            vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
-        }
+            vertex.position = positions[posIdx - 1];
+            vertex.texCoord = texIdx ? texCoords[texIdx - 1] : glm::vec2(0.0f);
+            vertex.normal = normIdx ? normals[normIdx - 1] : glm::vec3(0.0f, 0.0f, 1.0f);
 
-        faceVertices.push_back(vertex);
-    }
-
-    if (faceVertices.size() < 3) return false;
+            if (slot) {
+                vertexIdx = unsigned(mesh.vertices.size());
+                mesh.vertices.push_back(vertex);
+                weldMap->Insert(*slot, posIdx, texIdx, normIdx, vertexIdx);
+            }
+        }
 
-    for (size_t i = 1; i < faceVertices.size() - 1; ++i) {
-        mesh.vertices.push_back(faceVertices[0]);
-        mesh.vertices.push_back(faceVertices[i]);
-        mesh.vertices.push_back(faceVertices[i + 1]);
+        if (corner == 0) {
+            first = vertex;
+            firstIdx = vertexIdx;
+        }
+        else if (corner >= 2) {
+            if (weldMap) {
+                mesh.indices.push_back(firstIdx);
+                mesh.indices.push_back(previousIdx);
+                mesh.indices.push_back(vertexIdx);
+            }
+            else {
+                mesh.vertices.push_back(first);
+                mesh.vertices.push_back(previous);
+                mesh.vertices.push_back(vertex);
 
-        for (int j = 0; j < 3; ++j) {
-            mesh.indices.push_back(mesh.indices.size());
+                for (int j = 0; j < 3; ++j) {
+                    mesh.indices.push_back(unsigned(mesh.indices.size()));
+                }
+            }
         }
+        previous = vertex;
+        previousIdx = vertexIdx;
     }
-
     return true;
-}
\ No newline at end of file
+}
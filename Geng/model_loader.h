@@ -2,9 +2,18 @@
 #pragma once
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "ImageDecoder.h"
+#include "BlockCompression.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 struct Vertex {
     glm::vec3 position;
@@ -12,6 +21,73 @@ struct Vertex {
     glm::vec2 texCoord;
 };
 
+// Compact 16-byte layout used when a model loads with VertexFormat::Packed16.
+// Positions are unsigned normalized within the mesh bounds, normals are
+// signed normalized 10:10:10:2 and texture coordinates are half floats.
+struct PackedVertex {
+    uint16_t position[4];   // xyz + padding
+    uint32_t normal;
+    uint16_t texCoord[2];
+};
+
+// Largest error introduced by packing one mesh.
+struct PackingError {
+    float position = 0.0f;          // model units
+    float normalDegrees = 0.0f;
+    float texCoord = 0.0f;          // UV units
+};
+
+enum class VertexFormat {
+    Float32,    // Vertex, 32 bytes
+    Packed16    // PackedVertex, 16 bytes
+};
+
+// CPU-side geometry a Model keeps once its meshes are on the GPU.
+enum class GeometryResidency {
+    KeepAll,            // vertices and indices, as loaded
+    PositionsOnly,      // a compact position stream and the full-detail indices
+    DropAfterUpload     // nothing; GPU only
+};
+
+// Non-owning view of positions stored with a fixed stride, so the same loop
+// reads full Vertex arrays and compact position streams without copying.
+class PositionSpan {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = glm::vec3;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const glm::vec3*;
+        using reference = const glm::vec3&;
+
+        Iterator(const unsigned char* p, size_t stride) : p(p), stride(stride) {}
+        const glm::vec3& operator*() const { return *reinterpret_cast<const glm::vec3*>(p); }
+        Iterator& operator++() { p += stride; return *this; }
+        Iterator operator++(int) { Iterator old = *this; p += stride; return old; }
+        bool operator==(const Iterator& o) const { return p == o.p; }
+        bool operator!=(const Iterator& o) const { return p != o.p; }
+    private:
+        const unsigned char* p;
+        size_t stride;
+    };
+
+    PositionSpan() = default;
+    PositionSpan(const glm::vec3* first, size_t count, size_t stride)
+        : data(reinterpret_cast<const unsigned char*>(first)), count(count), stride(stride) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const glm::vec3& operator[](size_t i) const { return *reinterpret_cast<const glm::vec3*>(data + i * stride); }
+    Iterator begin() const { return Iterator(data, stride); }
+    Iterator end() const { return Iterator(data + count * stride, stride); }
+
+private:
+    const unsigned char* data = nullptr;
+    size_t count = 0;
+    size_t stride = sizeof(glm::vec3);
+};
+
 struct Material {
     std::string name;
     glm::vec3 ambient;
@@ -21,39 +97,370 @@ struct Material {
     std::string diffuseTexture;
 };
 
+// Options applied while a model is being loaded.
+struct ModelLoadOptions {
+    // Share identical (v, vt, vn) corners through the index buffer. Turning this
+    // off stores every triangle corner separately, which is handy when debugging.
+    bool weldVertices = true;
+    // Reuse <model>.gmesh when it is newer than the sources, and write it after
+    // every successful parse.
+    bool useMeshCache = true;
+    // Threads used to parse the OBJ text: 0 = all of ThreadPool::Shared() plus
+    // the caller, 1 = parse serially on the calling thread, as a single chunk
+    // unless the file is larger than 256 MB.
+    unsigned parseThreads = 0;
+    // Reorder each mesh for vertex cache hits, less overdraw and linear vertex
+    // fetch after parsing. The cache stores the optimized order.
+    bool optimizeMeshes = true;
+    // GPU vertex layout. Packed16 halves vertex memory and fetch bandwidth;
+    // the CPU-side vertices stay full precision either way.
+    VertexFormat vertexFormat = VertexFormat::Float32;
+    // Also rasterize every mesh in software to report overdraw before and
+    // after optimizing. Slow on big levels, so off by default.
+    bool analyzeOverdraw = false;
+    // What stays in RAM after upload; see GeometryResidency.
+    GeometryResidency residency = GeometryResidency::KeepAll;
+    // Keep each OBJ o/g group (glTF node) in its own meshes so they can be
+    // culled separately. Off merges every face of a material into one mesh.
+    bool splitGroups = true;
+    // Cut meshes into spatially compact clusters of at most this many
+    // triangles and/or this bounding box edge length. 0 disables each limit.
+    size_t clusterMaxTriangles = 0;
+    float clusterMaxExtent = 0.0f;
+    // Simplified levels built below each mesh (at most MAX_MESH_LODS - 1).
+    // Each level aims for lodReduction of the previous level's triangles and
+    // stops early at lodMaxError, relative to the mesh's largest extent.
+    unsigned lodLevels = 0;
+    float lodReduction = 0.5f;
+    float lodMaxError = 0.05f;
+    // Leave textures out of the load. Each is decoded on ThreadPool::Shared()
+    // the first time Render binds it, and a 1x1 placeholder is drawn until it
+    // arrives, so textures of culled meshes cost nothing. Off decodes every
+    // referenced texture as part of the load.
+    bool lazyTextures = true;
+    // Load textures as finished mip chains from MipCache, building the cache
+    // entry on first use, instead of decoding and calling glGenerateMipmap.
+    bool useMipCache = true;
+    // Without lazyTextures, textures no larger than this on either side are
+    // grouped by size and format into GL_TEXTURE_2D_ARRAY layers, so meshes
+    // using different ones share a bind. 0 turns packing off. Packed textures
+    // belong to the model and are not shared through TextureCache.
+    int arrayTextureMaxSize = 0;
+    // Upload textures that have a mip chain as its coarse tail and let
+    // TextureStreamer::Shared() add finer levels as they are drawn larger.
+    // Needs useMipCache. The owner calls TextureStreamer::Update every frame.
+    bool streamTextures = false;
+    // Block-compress texture mip chains (BC1 for RGB, BC3 for RGBA, BC4/BC5
+    // for one and two channels) where the driver samples the format. With
+    // useMipCache the blocks are cached beside the chain; without it the
+    // chain is built and encoded on every load.
+    TextureCompression textureCompression = TextureCompression::None;
+    // Per texture path as the material names it, overriding textureCompression
+    std::unordered_map<std::string, TextureCompression> textureCompressionByPath;
+};
+
+// Counters filled in by the last Load call.
+struct ModelLoadStats {
+    size_t triangleCorners = 0;   // vertices an unwelded load would have stored
+    size_t uniqueVertices = 0;    // vertices actually stored across all meshes
+    size_t faceRuns = 0;          // runs of consecutive faces sharing one usemtl
+    size_t meshLookups = 0;       // material name -> mesh resolutions (one per usemtl switch)
+    double loadMs = 0.0;
+    bool fromCache = false;
+
+    // Filled when optimizeMeshes ran on freshly parsed meshes; averaged over
+    // all meshes weighted by triangles (ACMR, overdraw) or vertices (ATVR).
+    bool optimized = false;
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
+    float atvrBefore = 0.0f, atvrAfter = 0.0f;
+    float overdrawBefore = 0.0f, overdrawAfter = 0.0f;
+
+    // Worst-case quantization error when vertexFormat is Packed16
+    float packedPositionError = 0.0f;       // relative to the largest mesh extent
+    float packedNormalErrorDegrees = 0.0f;
+    float packedTexCoordError = 0.0f;       // absolute, in UV units
+
+    size_t clusteredMeshes = 0;   // meshes cut into spatial clusters
+    size_t splitMeshes = 0;       // meshes cut into parts so each fits 16-bit indices
+    size_t vertexBytes = 0;       // size of the model's shared VBO
+    size_t indexBytes = 0;        // size of the model's shared EBO
+
+    size_t glbPrimitives = 0;         // glTF triangle primitives read
+    size_t glbDirectPrimitives = 0;   // of those, already in Vertex layout and block copied
+
+    // Where the mesh part of loadMs went; textures are reported on their own
+    // (see LoadReport.h)
+    double ioMs = 0.0;            // opening and mapping or unpacking source files
+    double parseMs = 0.0;         // the rest of LoadSource: parsing and mesh processing
+    double uploadMs = 0.0;        // buffer creation and mesh uploads
+    size_t bytesRead = 0;         // size of every file opened
+
+    size_t reloadedTextures = 0;  // textures the last ReloadAsync decoded and replaced
+};
+
+// Full detail plus up to four simplified levels
+const unsigned MAX_MESH_LODS = 5;
+
+// What the last Render call drew.
+struct ModelRenderStats {
+    size_t drawnMeshes = 0;
+    size_t culledMeshes = 0;
+    size_t drawnTriangles = 0;
+    size_t fullTriangles = 0;               // what the drawn meshes cost at full detail
+    size_t lodMeshes[MAX_MESH_LODS] = {};   // drawn meshes per level
+    size_t placeholderMeshes = 0;           // drawn while their texture is still loading
+    size_t textureBinds = 0;
+};
+
+struct VertexWeldMap;
+struct GlbFile;
+class GpuUploadQueue;
+class MappedFile;
+
+// Shared state of one Model::LoadAsync call. The loader thread and the GL
+// thread update it; anyone holding the handle may poll or cancel.
+class ModelLoadTask {
+public:
+    enum class Status { Loading, Uploading, Done, Failed, Cancelled };
+
+    float Progress() const { return progress.load(); }
+    Status GetStatus() const { return status.load(); }
+    bool IsFinished() const {
+        Status s = status.load();
+        return s == Status::Done || s == Status::Failed || s == Status::Cancelled;
+    }
+
+    // Stops the load at the next parse, decode or upload step. Meshes that
+    // were already uploaded stay in the model until Cleanup.
+    void Cancel() { cancelRequested = true; }
+    bool IsCancelRequested() const { return cancelRequested.load(); }
+
+private:
+    friend class Model;
+    std::atomic<float> progress{ 0.0f };
+    std::atomic<Status> status{ Status::Loading };
+    std::atomic<bool> cancelRequested{ false };
+};
+
+using ModelLoadHandle = std::shared_ptr<ModelLoadTask>;
+
+// A range of Mesh::indices drawing the mesh at one level of detail.
+struct MeshLod {
+    size_t firstIndex = 0;
+    size_t indexCount = 0;
+    float error = 0.0f;     // relative to the mesh's largest extent
+};
+
 struct Mesh {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     Material material;
-    GLuint VAO;
+    std::string group;                    // OBJ o/g or glTF node name, empty outside any group
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    // lods[0] is the full mesh; coarser levels follow it in 'indices' and
+    // index the same vertices. currentLod is what Render drew last.
+    std::vector<MeshLod> lods;
+    unsigned currentLod = 0;
+
+    // Where the mesh lives in its Model's shared buffers
+    GLint baseVertex = 0;
+    size_t indexOffset = 0;               // bytes into the EBO
+    GLenum indexType = GL_UNSIGNED_INT;   // GL_UNSIGNED_SHORT when the range holds 16-bit indices
+
+    // Packed16 only: GPU copy staged until upload, and the dequantization
+    // the vertex shader applies (position = offset + packed * scale).
+    std::vector<PackedVertex> packedVertices;
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    PackingError packingError;
+
+    // Loaded from the mesh cache: vertices, indices and (Packed16) packed
+    // vertices are read from the mapped file until upload instead of being
+    // copied into the vectors above. ReleaseGeometry drops the mapping.
+    std::shared_ptr<const MappedFile> mapping;
+    const Vertex* mappedVertices = nullptr;
+    size_t mappedVertexCount = 0;
+    const unsigned int* mappedIndices = nullptr;
+    size_t mappedIndexCount = 0;
+    const PackedVertex* mappedPackedVertices = nullptr;
+
+    // PositionsOnly residency: the positions 'vertices' held before it was freed
+    std::vector<glm::vec3> positions;
+
+    // Of vertices, indices and LODs as loaded, so a reload can skip meshes
+    // that did not change
+    uint64_t contentHash = 0;
+
+    // Largest span of the texture coordinates, in texture repeats. With the
+    // mesh's screen size it tells how many texels a draw can show.
+    float uvExtent = 1.0f;
+
+    // The vertices and indices wherever they currently live
+    size_t VertexCount() const { return mapping ? mappedVertexCount : vertices.size(); }
+    const Vertex* VertexData() const { return mapping ? mappedVertices : vertices.data(); }
+    size_t IndexCount() const { return mapping ? mappedIndexCount : indices.size(); }
+    const unsigned int* IndexData() const { return mapping ? mappedIndices : indices.data(); }
+
+    // Whichever of the vertices and 'positions' is resident; empty once dropped
+    PositionSpan Positions() const {
+        if (VertexCount() > 0) {
+            return PositionSpan(&VertexData()[0].position, VertexCount(), sizeof(Vertex));
+        }
+        return PositionSpan(positions.data(), positions.size(), sizeof(glm::vec3));
+    }
 };
 
 class Model {
 public:
     std::vector<Mesh> meshes;
-    std::unordered_map<std::string, GLuint> loadedTextures;
+    std::unordered_map<std::string, GLuint> loadedTextures;   // each holds a TextureCache reference
+    ModelLoadOptions options;
+    ModelLoadStats stats;
+    ModelRenderStats renderStats;
+    // Render(shader, mvp) draws the coarsest level whose error covers at most
+    // lodPixelError pixels. A level only changes once its error is
+    // lodHysteresis past that threshold, so meshes do not flicker between levels.
+    float lodPixelError = 1.0f;
+    float lodHysteresis = 0.25f;
+    std::vector<std::string> sourceFiles;   // model file followed by the MTLs it pulled in
     std::vector<glm::vec3> GetVertexPositions() const {
+        size_t count = 0;
+        for (const auto& mesh : meshes) count += mesh.Positions().size();
         std::vector<glm::vec3> positions;
+        positions.reserve(count);
         for (const auto& mesh : meshes) {
-            for (const auto& vertex : mesh.vertices) {
-                positions.push_back(vertex.position);
-            }
+            PositionSpan span = mesh.Positions();
+            positions.insert(positions.end(), span.begin(), span.end());
         }
         return positions;
     }
+    // Visits every resident position without allocating
+    template <typename Fn>
+    void ForEachPosition(Fn&& fn) const {
+        for (const auto& mesh : meshes) {
+            for (const glm::vec3& position : mesh.Positions()) fn(position);
+        }
+    }
 
-    bool Load(const std::string& path);
+    bool Load(const std::string& path, const ModelLoadOptions& loadOptions = ModelLoadOptions());
+    // Parses and decodes on ThreadPool::Shared() and pushes one GL job per
+    // mesh (and texture, without lazyTextures) to 'uploads'. Meshes appear in 'meshes' as their jobs
+    // run, so the model can be drawn while it streams in. The Model and the
+    // queue must outlive the load. Like Load, replaces what the Model held.
+    ModelLoadHandle LoadAsync(const std::string& path, GpuUploadQueue& uploads,
+        const ModelLoadOptions& loadOptions = ModelLoadOptions());
+    // Hot reload for a model whose load has finished. 'path' may be the model
+    // itself, one of its MTLs or a texture file; only that file is re-read, on
+    // ThreadPool::Shared(), and the result is swapped in by a single job on
+    // 'uploads' so no frame sees half of it. Unchanged meshes and textures are
+    // left alone. Returns nullptr if nothing loaded from 'path' is resident.
+    ModelLoadHandle ReloadAsync(const std::string& path, GpuUploadQueue& uploads);
+    // The CPU half of Load: reads and processes the meshes, leaving them for
+    // Load or LoadAsync to upload. Makes no GL calls.
+    bool LoadSource(const std::string& path, const ModelLoadOptions& loadOptions = ModelLoadOptions());
+    // Every file ReloadAsync accepts, for a FileWatcher
+    std::vector<std::string> WatchedFiles() const;
+    // With lazyTextures, starts decoding every texture the meshes use instead
+    // of waiting for them to be drawn, e.g. while a loading screen is up.
+    void PrefetchTextures();
     void Render(GLuint shaderProgram);
+    // Skips meshes whose bounds fall outside the frustum of the given
+    // projection * view * model matrix.
+    void Render(GLuint shaderProgram, const glm::mat4& modelViewProjection);
     void Cleanup();
 
 private:
+    // All meshes share one VAO/VBO/EBO and are drawn as base-vertex ranges
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLuint EBO = 0;
+    std::vector<std::string> pendingTextures;   // referenced by materials, not yet loaded
+    const std::atomic<bool>* cancelFlag = nullptr;  // set while loading for LoadAsync
+    // Latest ReloadAsync per file; an older reload that finishes late is dropped
+    std::unordered_map<std::string, unsigned> reloadGenerations;
+
+    // Lazy textures decode on pool threads and wait here for the GL thread.
+    // Cleanup swaps in a new inbox, so decodes still running are dropped.
+    struct TextureInbox {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<DecodedImage>> ready;
+    };
+    std::shared_ptr<TextureInbox> textureInbox = std::make_shared<TextureInbox>();
+    std::unordered_set<std::string> requestedTextures;
+    GLuint placeholderTexture = 0;
+
+    // Textures moved into an array by PackTextures, by path
+    struct ArrayLayer {
+        GLuint array = 0;
+        int layer = 0;
+        int width = 0;
+        int height = 0;
+        int components = 0;
+        size_t levels = 0;      // stored levels; 0 when the array builds its own mipmaps
+        BlockFormat blockFormat = BlockFormat::None;
+    };
+    std::unordered_map<std::string, ArrayLayer> arrayLayers;
+    std::vector<GLuint> textureArrays;
+    // ImageContentHash of each resident texture, so reloading a .glb can skip
+    // the embedded images that did not change. Missing when acquired by path.
+    std::unordered_map<std::string, uint64_t> textureHashes;
+
+    // Uniforms DrawMeshes sets, looked up once per shader program
+    struct MeshUniforms {
+        GLint diffuseLayer = -1;
+        GLint diffuseArray = -1;
+        GLint materialAmbient = -1;
+        GLint materialDiffuse = -1;     // the shaders use it as both sampler and color
+        GLint materialSpecular = -1;
+        GLint materialShininess = -1;
+        GLint positionOffset = -1;
+        GLint positionScale = -1;
+    };
+    std::unordered_map<GLuint, MeshUniforms> meshUniforms;
+    const MeshUniforms& UniformsFor(GLuint shaderProgram);
+
+    bool LoadCancelled() const { return cancelFlag && cancelFlag->load(); }
+
+    void PrintLoadSummary(const std::string& path) const;
+    void ReportLoad(const std::string& path) const;
     bool LoadOBJ(const std::string& path);
+    bool LoadGLB(const std::string& path);
+    void ClusterMeshes();
+    void OptimizeMeshes();
+    void SplitLargeMeshes();
+    void BuildLods();
+    void PackMeshes();
+    void AddPackingStats();
+    bool LoadMeshCache(const std::string& path);
+    uint32_t CacheFlags() const;
     bool LoadMTL(const std::string& path, std::vector<Material>& materials);
-    GLuint SetupMeshVAO(const Mesh& mesh);
-    GLuint LoadTexture(const std::string& path);
-    bool ProcessFace(std::istringstream& iss,
+    void LayoutMeshes();
+    void DrawMeshes(GLuint shaderProgram, const glm::mat4* cullMatrix);
+    void CreateBuffers();
+    void UploadMesh(Mesh& mesh);
+    void ReleaseGeometry(Mesh& mesh);
+    size_t SwapMeshes(Model& staged);
+    void SwapMaterials(const std::vector<Material>& materials);
+    void ReplaceTexture(const std::shared_ptr<DecodedImage>& decoded);
+    void ReleaseUnusedTextures();
+    void RequestTexture(const std::string& path);
+    void ResolveTextures();
+    GLuint PlaceholderTexture();
+    void PackTextures(std::vector<std::shared_ptr<DecodedImage>>& images);
+    void QueueTexture(const std::string& path);
+    static bool DecodeTexture(const std::string& path, bool useMipCache, TextureCompression compression,
+        DecodedImage& image, const GlbFile* glb = nullptr);
+    static std::vector<std::shared_ptr<DecodedImage>> DecodeTextures(const std::vector<std::string>& paths,
+        const ModelLoadOptions& options, const std::atomic<bool>* cancel = nullptr);
+    GLuint UploadTexture(const std::shared_ptr<DecodedImage>& image);
+    static GLuint CreateTexture(const std::shared_ptr<DecodedImage>& decoded, bool stream);
+    GLuint AcquireTexture(const std::string& path);
+    bool ProcessFace(const glm::ivec3* corners, size_t cornerCount,
         const std::vector<glm::vec3>& positions,
         const std::vector<glm::vec3>& normals,
         const std::vector<glm::vec2>& texCoords,
-        Mesh& mesh);
+        const glm::ivec3& available,
+        Mesh& mesh, VertexWeldMap* weldMap);
 };
\ No newline at end of file
@@ -16,9 +16,14 @@
     uniform mat4 view;
     uniform mat4 projection;
 
+    // Packed meshes store positions normalized to their bounds
+    uniform vec3 positionOffset = vec3(0.0);
+    uniform vec3 positionScale = vec3(1.0);
+
     void main()
     {
-        FragPos = vec3(model * vec4(aPos, 1.0));
+        vec3 position = positionOffset + aPos * positionScale;
+        FragPos = vec3(model * vec4(position, 1.0));
         Normal = mat3(transpose(inverse(model))) * aNormal; // Important
         gl_Position = projection * view * vec4(FragPos, 1.0);
         TexCoords = aTexCoords;
@@ -75,6 +80,20 @@
     uniform vec3 viewPos;
     uniform float dirIntensity;
 
+    // Small textures packed into GL_TEXTURE_2D_ARRAY layers; -1 samples material's maps
+    uniform sampler2DArray diffuseArray;
+    uniform int diffuseLayer = -1;
+
+    vec3 DiffuseColor() {
+        if (diffuseLayer >= 0) return texture(diffuseArray, vec3(TexCoords, float(diffuseLayer))).rgb;
+        return texture(material.diffuse, TexCoords).rgb;
+    }
+
+    vec3 SpecularColor() {
+        if (diffuseLayer >= 0) return texture(diffuseArray, vec3(TexCoords, float(diffuseLayer))).rgb;
+        return texture(material.specular, TexCoords).rgb;
+    }
+
     out vec4 FragColor;
 
     in vec3 Normal;
@@ -131,9 +150,9 @@
         vec3 reflectDir = reflect(-lightDir, normal);
         float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
         // Combine results
-        vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-        vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
-        vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
+        vec3 ambient = light.ambient * DiffuseColor();
+        vec3 diffuse = light.diffuse * diff * DiffuseColor();
+        vec3 specular = light.specular * spec * SpecularColor();
         return (ambient + diffuse + specular) * dirIntensity;
     }
 
@@ -151,9 +170,9 @@
         float attenuation = 1.0 / (light.constant + light.linear * distance + 
                         light.quadratic * (distance * distance));
         // Combine results
-        vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-        vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
-        float specIntensity = rgbToGray(texture(material.specular, TexCoords).rgb);
+        vec3 ambient = light.ambient * DiffuseColor();
+        vec3 diffuse = light.diffuse * diff * DiffuseColor();
+        float specIntensity = rgbToGray(SpecularColor());
         vec3 specular = light.specular * spec * vec3(specIntensity);
         ambient *= attenuation;
         diffuse *= attenuation;
@@ -180,8 +199,8 @@
         float attenuation = 1.0 / (light.constant + light.linear * distance + 
                         light.quadratic * (distance * distance));
         // Combine results
-        vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-        vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
+        vec3 ambient = light.ambient * DiffuseColor();
+        vec3 diffuse = light.diffuse * diff * DiffuseColor();
         vec3 specular = light.specular * spec * vec3(1.0);
         ambient *= attenuation * intensity;
         diffuse *= attenuation * intensity;
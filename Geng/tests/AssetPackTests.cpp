@@ -0,0 +1,175 @@
+// AssetPackTests.cpp
+#include "TestFramework.h"
+#include "AssetPack.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+static std::vector<char> ReadBytes(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void WriteBytes(const std::string& path, const std::vector<char>& bytes, size_t size) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), std::streamsize(size));
+}
+
+// Sources for a pack: compressible text, incompressible noise and an empty
+// file. Returns their paths and contents.
+static std::vector<std::string> WritePackSources(std::vector<std::vector<char>>& contents) {
+    std::vector<std::string> paths = {
+        TestTempPath("pack_text.obj"), TestTempPath("pack_noise.bin"), TestTempPath("pack_empty.mtl"),
+    };
+    std::string text;
+    for (int i = 0; i < 4000; ++i) text += "v " + std::to_string(i % 37) + " 0.5 1.0\n";
+    std::mt19937 rng(3);
+    std::vector<char> noise(50000);
+    for (char& c : noise) c = char(rng());
+
+    contents = { std::vector<char>(text.begin(), text.end()), noise, std::vector<char>() };
+    for (size_t i = 0; i < paths.size(); ++i) WriteBytes(paths[i], contents[i], contents[i].size());
+    return paths;
+}
+
+// Packs the sources, then deletes them so AssetFile can only read the pack
+static std::string BuildPack(const std::string& name, std::vector<std::string>& paths,
+    std::vector<std::vector<char>>& contents) {
+    paths = WritePackSources(contents);
+    std::string packPath = TestTempPath(name);
+    if (!WriteAssetPack(packPath, paths)) return std::string();
+    for (const auto& path : paths) std::filesystem::remove(path);
+    return packPath;
+}
+
+TEST(AssetPackReadsEveryEntry) {
+    std::vector<std::string> paths;
+    std::vector<std::vector<char>> contents;
+    std::string packPath = BuildPack("round_trip.gpak", paths, contents);
+    REQUIRE(!packPath.empty());
+    REQUIRE(MountAssetPack(packPath));
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        AssetFile file;
+        CHECK(file.Open(paths[i]));
+        CHECK(file.IsOpen() && file.FromPack());
+        REQUIRE(file.Size() == contents[i].size());
+        CHECK(memcmp(file.Data(), contents[i].data(), contents[i].size()) == 0);
+    }
+    UnmountAssetPacks();
+}
+
+// Entry as stored in the pack's directory, located by its bytes
+static size_t EntryOffset(const std::vector<char>& bytes, const AssetPackEntry& entry) {
+    const char* begin = reinterpret_cast<const char*>(&entry);
+    auto found = std::search(bytes.begin(), bytes.end(), begin, begin + sizeof(entry));
+    return found == bytes.end() ? 0 : size_t(found - bytes.begin());
+}
+
+TEST(AssetPackOpensEmptyCompressedEntry) {
+    std::vector<std::string> paths;
+    std::vector<std::vector<char>> contents;
+    std::string packPath = BuildPack("empty_lz.gpak", paths, contents);
+    REQUIRE(!packPath.empty());
+
+    // Another writer may store an empty file as an LZ entry
+    AssetPackEntry entry;
+    {
+        AssetPack pack;
+        REQUIRE(pack.Open(packPath));
+        const AssetPackEntry* empty = pack.Find(paths[2]);
+        REQUIRE(empty && empty->rawSize == 0);
+        entry = *empty;
+    }
+    std::vector<char> bytes = ReadBytes(packPath);
+    size_t offset = EntryOffset(bytes, entry);
+    REQUIRE(offset != 0);
+    entry.compression = 1;
+    memcpy(bytes.data() + offset, &entry, sizeof(entry));
+    WriteBytes(packPath, bytes, bytes.size());
+
+    REQUIRE(MountAssetPack(packPath));
+    AssetFile file;
+    CHECK(file.Open(paths[2]));
+    CHECK(file.IsOpen() && file.FromPack());
+    CHECK(file.Size() == 0);
+    UnmountAssetPacks();
+}
+
+TEST(AssetPackRejectsTruncation) {
+    std::vector<std::string> paths;
+    std::vector<std::vector<char>> contents;
+    std::string packPath = BuildPack("truncated.gpak", paths, contents);
+    REQUIRE(!packPath.empty());
+    const std::vector<char> bytes = ReadBytes(packPath);
+
+    std::string cutPath = TestTempPath("truncated_cut.gpak");
+    for (size_t size = 0; size < bytes.size(); size += 1 + size / 32) {
+        WriteBytes(cutPath, bytes, size);
+        AssetPack pack;
+        if (pack.Open(cutPath)) {
+            ReportFailure(__FILE__, __LINE__, "pack truncated to " + std::to_string(size) + " bytes opened");
+            break;
+        }
+    }
+}
+
+TEST(AssetPackRejectsCorruption) {
+    std::vector<std::string> paths;
+    std::vector<std::vector<char>> contents;
+    std::string packPath = BuildPack("corrupt.gpak", paths, contents);
+    REQUIRE(!packPath.empty());
+    const std::vector<char> bytes = ReadBytes(packPath);
+
+    AssetPackEntry text, noise;
+    {
+        AssetPack pack;
+        REQUIRE(pack.Open(packPath));
+        REQUIRE(pack.Find(paths[0]) && pack.Find(paths[1]));
+        text = *pack.Find(paths[0]);
+        noise = *pack.Find(paths[1]);
+    }
+    REQUIRE(text.compression == 1 && noise.compression == 0);
+
+    std::string badPath = TestTempPath("corrupt_bad.gpak");
+    auto opensWith = [&](size_t offset, const void* value, size_t size) {
+        std::vector<char> corrupt = bytes;
+        memcpy(corrupt.data() + offset, value, size);
+        WriteBytes(badPath, corrupt, corrupt.size());
+        AssetPack pack;
+        return pack.Open(badPath);
+    };
+    const uint32_t badVersion = ASSET_PACK_VERSION + 1, badSlots = 3;
+    CHECK(!opensWith(0, "GPAX", 4));
+    CHECK(!opensWith(4, &badVersion, sizeof(badVersion)));
+    CHECK(!opensWith(12, &badSlots, sizeof(badSlots)));
+
+    auto opensWithEntry = [&](const AssetPackEntry& original, AssetPackEntry changed) {
+        return opensWith(EntryOffset(bytes, original), &changed, sizeof(changed));
+    };
+    AssetPackEntry changed = noise;
+    changed.offset = bytes.size();
+    changed.storedSize = 1;
+    CHECK(!opensWithEntry(noise, changed));
+    changed = noise;
+    changed.rawSize += 1;               // stored entries must be their raw size
+    CHECK(!opensWithEntry(noise, changed));
+    changed = text;
+    changed.compression = 2;
+    CHECK(!opensWithEntry(text, changed));
+    changed = text;
+    changed.nameLength = 1u << 30;
+    CHECK(!opensWithEntry(text, changed));
+
+    // A damaged LZ stream opens, but the entry fails to read
+    std::vector<char> damaged = bytes;
+    memset(damaged.data() + text.offset, 0xFF, 64);
+    WriteBytes(badPath, damaged, damaged.size());
+    AssetPack pack;
+    REQUIRE(pack.Open(badPath));
+    std::vector<char> buffer;
+    const char* data = nullptr;
+    CHECK(!pack.Read(*pack.Find(paths[0]), buffer, data));
+}
@@ -0,0 +1,236 @@
+// BlockCompressionTests.cpp
+#include "TestFramework.h"
+#include "GlStub.h"
+#include "BlockCompression.h"
+#include "TextureCache.h"
+#include "model_loader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+// ---- Reference decoder, written from the S3TC and RGTC specifications ----
+
+static void DecodeColorBlock(const unsigned char* block, bool allowThreeColor, float out[16][3]) {
+    const uint16_t c0 = uint16_t(block[0] | block[1] << 8);
+    const uint16_t c1 = uint16_t(block[2] | block[3] << 8);
+    float palette[4][3];
+    const uint16_t packed[2] = { c0, c1 };
+    for (int e = 0; e < 2; ++e) {
+        int r = (packed[e] >> 11) & 31, g = (packed[e] >> 5) & 63, b = packed[e] & 31;
+        palette[e][0] = float(r << 3 | r >> 2);
+        palette[e][1] = float(g << 2 | g >> 4);
+        palette[e][2] = float(b << 3 | b >> 2);
+    }
+    for (int k = 0; k < 3; ++k) {
+        if (c0 > c1 || !allowThreeColor) {
+            palette[2][k] = (2.0f * palette[0][k] + palette[1][k]) / 3.0f;
+            palette[3][k] = (palette[0][k] + 2.0f * palette[1][k]) / 3.0f;
+        }
+        else {
+            palette[2][k] = (palette[0][k] + palette[1][k]) / 2.0f;
+            palette[3][k] = 0.0f;
+        }
+    }
+    const uint32_t indices = uint32_t(block[4]) | uint32_t(block[5]) << 8 | uint32_t(block[6]) << 16 |
+        uint32_t(block[7]) << 24;
+    for (int i = 0; i < 16; ++i) {
+        for (int k = 0; k < 3; ++k) out[i][k] = palette[(indices >> (2 * i)) & 3][k];
+    }
+}
+
+static void DecodeChannelBlock(const unsigned char* block, float out[16]) {
+    const int a0 = block[0], a1 = block[1];
+    float palette[8] = { float(a0), float(a1) };
+    if (a0 > a1) {
+        for (int i = 2; i < 8; ++i) palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7.0f;
+    }
+    else {
+        for (int i = 2; i < 6; ++i) palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5.0f;
+        palette[6] = 0.0f;
+        palette[7] = 255.0f;
+    }
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i) indices |= uint64_t(block[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; ++i) out[i] = palette[(indices >> (3 * i)) & 7];
+}
+
+// Decodes 'level' back to 'components' float channels per texel
+static std::vector<float> DecodeLevel(const ImageLevel& level, BlockFormat format, int components) {
+    std::vector<float> texels(size_t(level.width) * level.height * components);
+    const int blocksX = (level.width + 3) / 4;
+    const int blocksY = (level.height + 3) / 4;
+    const size_t blockBytes = BlockBytes(format);
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const unsigned char* block = level.pixels + (size_t(by) * blocksX + bx) * blockBytes;
+            float colors[16][3] = {};
+            float channels[2][16] = {};
+            switch (format) {
+            case BlockFormat::BC1: DecodeColorBlock(block, true, colors); break;
+            case BlockFormat::BC3:
+                DecodeChannelBlock(block, channels[0]);
+                DecodeColorBlock(block + 8, false, colors);
+                break;
+            case BlockFormat::BC4: DecodeChannelBlock(block, channels[0]); break;
+            case BlockFormat::BC5:
+                DecodeChannelBlock(block, channels[0]);
+                DecodeChannelBlock(block + 8, channels[1]);
+                break;
+            default: break;
+            }
+            for (int i = 0; i < 16; ++i) {
+                int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x >= level.width || y >= level.height) continue;
+                float* texel = &texels[(size_t(y) * level.width + x) * components];
+                if (components >= 3) {
+                    for (int k = 0; k < 3; ++k) texel[k] = colors[i][k];
+                    if (components == 4) texel[3] = channels[0][i];
+                }
+                else {
+                    for (int k = 0; k < components; ++k) texel[k] = channels[k][i];
+                }
+            }
+        }
+    }
+    return texels;
+}
+
+// ---- Test images ----
+
+// Smooth gradients and waves with a little noise, like a photographic
+// texture; sizes that are not multiples of 4 exercise the edge blocks
+static std::shared_ptr<DecodedImage> MakeTestImage(int width, int height, int components) {
+    auto image = std::make_shared<DecodedImage>();
+    image->width = width;
+    image->height = height;
+    image->components = components;
+    image->levelStorage.resize(size_t(width) * height * components);
+    uint32_t seed = 12345;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float waves[4] = {
+                128.0f + 100.0f * std::sin(x * 0.21f) * std::cos(y * 0.13f),
+                255.0f * x / width,
+                40.0f + 180.0f * y / height,
+                128.0f + 120.0f * std::cos((x + y) * 0.09f),
+            };
+            for (int c = 0; c < components; ++c) {
+                seed = seed * 1664525u + 1013904223u;
+                float noise = float(int(seed >> 24) % 9 - 4);
+                float value = std::min(255.0f, std::max(0.0f, waves[c] + noise));
+                image->levelStorage[(size_t(y) * width + x) * components + c] = (unsigned char)(value + 0.5f);
+            }
+        }
+    }
+    ImageLevel level;
+    level.width = width;
+    level.height = height;
+    level.size = image->levelStorage.size();
+    level.pixels = image->levelStorage.data();
+    image->levels.push_back(level);
+    return image;
+}
+
+static double Psnr(const std::vector<unsigned char>& original, const std::vector<float>& decoded) {
+    double squared = 0.0;
+    for (size_t i = 0; i < original.size(); ++i) {
+        double d = double(original[i]) - decoded[i];
+        squared += d * d;
+    }
+    double mse = squared / double(original.size());
+    return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+static double EncodedPsnr(int components, TextureCompression quality) {
+    DetectBlockFormats();
+    auto image = MakeTestImage(66, 38, components);
+    std::vector<unsigned char> original = image->levelStorage;
+    if (!CompressMipChain(*image, quality)) return 0.0;
+    if (image->blockFormat != BlockFormatFor(components)) return 0.0;
+    return Psnr(original, DecodeLevel(image->levels[0], image->blockFormat, components));
+}
+
+// Thresholds sit about a dB under what the encoders reach on the test image
+// (BC1 34.7/35.6, BC3 35.7/36.6, BC4 43.4/43.5, BC5 45.8/45.8 dB, Fast/High),
+// so a regression in endpoint selection or index search fails here
+TEST(BlockEncodersMeetPsnr) {
+    struct Case {
+        int components;
+        double fast;
+        double high;
+    };
+    const Case cases[] = {
+        { 3, 33.5, 34.5 },  // BC1
+        { 4, 34.5, 35.5 },  // BC3
+        { 1, 42.5, 42.5 },  // BC4
+        { 2, 44.5, 44.5 },  // BC5
+    };
+    for (const Case& test : cases) {
+        double fast = EncodedPsnr(test.components, TextureCompression::Fast);
+        double high = EncodedPsnr(test.components, TextureCompression::High);
+        CHECK(fast >= test.fast);
+        CHECK(high >= test.high);
+        CHECK(high >= fast - 0.01);
+    }
+}
+
+// ---- Model options ----
+
+static std::string WriteTexturedObj(const std::string& name, unsigned char shade) {
+    std::string ppm = "P6\n8 8\n255\n";
+    for (int i = 0; i < 8 * 8 * 3; ++i) ppm.push_back(char(shade + i % 40));
+    std::ofstream(TestTempPath(name + ".ppm"), std::ios::binary) << ppm;
+    std::ofstream(TestTempPath(name + ".mtl"), std::ios::binary) << "newmtl lit\nmap_Kd " << name << ".ppm\n";
+    std::string path = TestTempPath(name + ".obj");
+    std::ofstream(path, std::ios::binary) << "mtllib " << name << ".mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\n"
+        "usemtl lit\nf 1 2 3\n";
+    return path;
+}
+
+static ModelLoadOptions TextureOptions(bool useMipCache, TextureCompression compression) {
+    ModelLoadOptions options;
+    options.useMeshCache = false;
+    options.lazyTextures = false;
+    options.useMipCache = useMipCache;
+    options.textureCompression = compression;
+    return options;
+}
+
+// Without the mip cache the chain is built and compressed on the spot
+TEST(CompressionWorksWithoutMipCache) {
+    std::string path = WriteTexturedObj("bc_nocache", 10);
+    Model model;
+    REQUIRE(model.Load(path, TextureOptions(false, TextureCompression::Fast)));
+    CHECK(model.loadedTextures.size() == 1);
+    CHECK(GlStub().compressedLevelUploads == 4);    // 8x8 down to 1x1
+    model.Cleanup();
+}
+
+// The same bytes loaded compressed and uncompressed stay two textures
+TEST(TextureCacheKeepsCompressionApart) {
+    std::string path = WriteTexturedObj("bc_shared", 70);
+    Model compressed, plain, overridden;
+    REQUIRE(compressed.Load(path, TextureOptions(false, TextureCompression::Fast)));
+    REQUIRE(plain.Load(path, TextureOptions(false, TextureCompression::None)));
+    CHECK(plain.loadedTextures.begin()->second != compressed.loadedTextures.begin()->second);
+
+    // A per-path None override shares the plain texture, not the compressed one
+    ModelLoadOptions options = TextureOptions(false, TextureCompression::Fast);
+    options.textureCompressionByPath[plain.loadedTextures.begin()->first] = TextureCompression::None;
+    const size_t uploads = GlStub().textureLevelUploads;
+    REQUIRE(overridden.Load(path, options));
+    CHECK(overridden.loadedTextures.begin()->second == plain.loadedTextures.begin()->second);
+    CHECK(GlStub().textureLevelUploads == uploads);
+
+    // And a second compressed load shares the compressed one
+    Model again;
+    REQUIRE(again.Load(path, TextureOptions(false, TextureCompression::Fast)));
+    CHECK(again.loadedTextures.begin()->second == compressed.loadedTextures.begin()->second);
+    again.Cleanup();
+    overridden.Cleanup();
+    plain.Cleanup();
+    compressed.Cleanup();
+}
@@ -0,0 +1,183 @@
+// GlStub.cpp
+#include "GlStub.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static GlStubCounters counters;
+static GLuint nextName = 1;
+static std::unordered_map<GLenum, GLuint> boundBuffers;
+static std::unordered_map<GLuint, std::vector<unsigned char>> bufferStorage;
+static std::unordered_map<std::string, GLint> uniformLocations;
+
+GlStubCounters& GlStub() {
+    return counters;
+}
+
+void ResetGlStub() {
+    counters = GlStubCounters();
+    boundBuffers.clear();
+    bufferStorage.clear();
+    uniformLocations.clear();
+}
+
+// A do-nothing function of any GL signature, returning zero
+template <typename Fn> struct Noop;
+template <typename R, typename... Args> struct Noop<R (APIENTRY*)(Args...)> {
+    static R APIENTRY Call(Args...) { return R(); }
+};
+template <typename Fn> static void SetNoop(Fn& pointer) {
+    pointer = &Noop<Fn>::Call;
+}
+
+static void APIENTRY GenNames(GLsizei n, GLuint* names) {
+    for (GLsizei i = 0; i < n; ++i) names[i] = nextName++;
+}
+
+static void APIENTRY GenTextures(GLsizei n, GLuint* names) {
+    GenNames(n, names);
+    counters.texturesCreated += size_t(n);
+}
+
+static void APIENTRY DeleteTextures(GLsizei n, const GLuint*) {
+    counters.texturesDeleted += size_t(n);
+}
+
+static size_t ClientChannels(GLenum format) {
+    switch (format) {
+    case GL_RED: return 1;
+    case GL_RG: return 2;
+    case GL_RGB: return 3;
+    default: return 4;
+    }
+}
+
+static void APIENTRY TexImage2D(GLenum, GLint, GLint, GLsizei width, GLsizei height, GLint, GLenum format, GLenum,
+    const void*) {
+    ++counters.textureLevelUploads;
+    counters.textureBytesRead += size_t(width) * size_t(height) * ClientChannels(format);
+}
+
+static void APIENTRY CompressedTexImage2D(GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei imageSize,
+    const void*) {
+    ++counters.textureLevelUploads;
+    ++counters.compressedLevelUploads;
+    counters.textureBytesRead += size_t(imageSize);
+}
+
+static void APIENTRY BindBuffer(GLenum target, GLuint buffer) {
+    boundBuffers[target] = buffer;
+}
+
+static void APIENTRY DeleteBuffers(GLsizei n, const GLuint* buffers) {
+    for (GLsizei i = 0; i < n; ++i) bufferStorage.erase(buffers[i]);
+}
+
+static void APIENTRY BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum) {
+    std::vector<unsigned char>& storage = bufferStorage[boundBuffers[target]];
+    storage.assign(size_t(size), 0);
+    if (data) std::copy(static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size,
+        storage.begin());
+}
+
+static void* APIENTRY MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield) {
+    std::vector<unsigned char>& storage = bufferStorage[boundBuffers[target]];
+    if (offset < 0 || size_t(offset + length) > storage.size()) return nullptr;
+    ++counters.bufferMaps;
+    return storage.data() + offset;
+}
+
+static GLboolean APIENTRY UnmapBuffer(GLenum) {
+    ++counters.bufferUnmaps;
+    return GL_TRUE;
+}
+
+static GLint APIENTRY GetUniformLocation(GLuint program, const GLchar* name) {
+    ++counters.uniformLookups;
+    auto found = uniformLocations.emplace(std::to_string(program) + "/" + name, GLint(uniformLocations.size()));
+    return found.first->second;
+}
+
+static void APIENTRY GetIntegerv(GLenum pname, GLint* data) {
+    *data = pname == GL_MAX_TEXTURE_SIZE ? 16384 : pname == GL_NUM_EXTENSIONS ? 1 : 0;
+}
+
+static void APIENTRY GetShaderiv(GLuint, GLenum, GLint* params) {
+    *params = GL_TRUE;
+}
+
+static const GLubyte* APIENTRY GetStringi(GLenum, GLuint) {
+    return reinterpret_cast<const GLubyte*>("GL_EXT_texture_compression_s3tc");
+}
+
+static GLsync APIENTRY FenceSync(GLenum, GLbitfield) {
+    return reinterpret_cast<GLsync>(size_t(nextName++));
+}
+
+static GLenum APIENTRY ClientWaitSync(GLsync, GLbitfield, GLuint64) {
+    return GL_ALREADY_SIGNALED;
+}
+
+static GLuint APIENTRY CreateName() {
+    return nextName++;
+}
+
+static GLuint APIENTRY CreateShader(GLenum) {
+    return nextName++;
+}
+
+void InstallGlStub() {
+    glad_glGenTextures = GenTextures;
+    glad_glDeleteTextures = DeleteTextures;
+    glad_glTexImage2D = TexImage2D;
+    glad_glCompressedTexImage2D = CompressedTexImage2D;
+    glad_glGenBuffers = GenNames;
+    glad_glGenVertexArrays = GenNames;
+    glad_glBindBuffer = BindBuffer;
+    glad_glDeleteBuffers = DeleteBuffers;
+    glad_glBufferData = BufferData;
+    glad_glMapBufferRange = MapBufferRange;
+    glad_glUnmapBuffer = UnmapBuffer;
+    glad_glGetUniformLocation = GetUniformLocation;
+    glad_glGetIntegerv = GetIntegerv;
+    glad_glGetShaderiv = GetShaderiv;
+    glad_glGetProgramiv = GetShaderiv;
+    glad_glGetStringi = GetStringi;
+    glad_glFenceSync = FenceSync;
+    glad_glClientWaitSync = ClientWaitSync;
+    glad_glCreateProgram = CreateName;
+    glad_glCreateShader = CreateShader;
+
+    SetNoop(glad_glActiveTexture);
+    SetNoop(glad_glAttachShader);
+    SetNoop(glad_glBindTexture);
+    SetNoop(glad_glBindVertexArray);
+    SetNoop(glad_glBufferSubData);
+    SetNoop(glad_glCompileShader);
+    SetNoop(glad_glCompressedTexImage3D);
+    SetNoop(glad_glCompressedTexSubImage3D);
+    SetNoop(glad_glDeleteShader);
+    SetNoop(glad_glDeleteSync);
+    SetNoop(glad_glDeleteVertexArrays);
+    SetNoop(glad_glDepthFunc);
+    SetNoop(glad_glDrawArrays);
+    SetNoop(glad_glDrawElementsBaseVertex);
+    SetNoop(glad_glEnableVertexAttribArray);
+    SetNoop(glad_glGenerateMipmap);
+    SetNoop(glad_glGetProgramInfoLog);
+    SetNoop(glad_glGetShaderInfoLog);
+    SetNoop(glad_glLinkProgram);
+    SetNoop(glad_glPixelStorei);
+    SetNoop(glad_glShaderSource);
+    SetNoop(glad_glTexImage3D);
+    SetNoop(glad_glTexParameteri);
+    SetNoop(glad_glTexSubImage3D);
+    SetNoop(glad_glUniform1f);
+    SetNoop(glad_glUniform1i);
+    SetNoop(glad_glUniform3fv);
+    SetNoop(glad_glUniformMatrix4fv);
+    SetNoop(glad_glUseProgram);
+    SetNoop(glad_glVertexAttribPointer);
+}
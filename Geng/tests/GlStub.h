@@ -0,0 +1,24 @@
+// GlStub.h
+#pragma once
+#include <cstddef>
+
+// Points the glad function pointers the engine calls at a fake GL, so code
+// that uploads or draws can run without a context. Names come from a
+// counter, buffers are plain memory so mapping works, syncs are signalled
+// at once, S3TC is the one extension, so every block format is supported,
+// and everything else does nothing. The counters below let tests
+// see what reached GL.
+void InstallGlStub();
+void ResetGlStub();
+
+struct GlStubCounters {
+    size_t uniformLookups = 0;          // glGetUniformLocation calls
+    size_t texturesCreated = 0;
+    size_t texturesDeleted = 0;
+    size_t textureLevelUploads = 0;     // glTexImage2D / glCompressedTexImage2D calls
+    size_t compressedLevelUploads = 0;  // of those, glCompressedTexImage2D
+    size_t textureBytesRead = 0;        // pixel bytes those calls read, by their client format
+    size_t bufferMaps = 0;
+    size_t bufferUnmaps = 0;
+};
+GlStubCounters& GlStub();
@@ -0,0 +1,194 @@
+// GltfLoaderTests.cpp
+#include "TestFramework.h"
+#include "GltfLoader.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static void Append(std::string& bin, const void* data, size_t size) {
+    bin.append(static_cast<const char*>(data), size);
+    while (bin.size() % 4) bin.push_back('\0');
+}
+
+// The two chunks with their headers, each padded to 4 bytes
+static std::string GlbBytes(std::string doc, const std::string& bin) {
+    while (doc.size() % 4) doc.push_back(' ');
+    auto u32 = [](std::string& out, uint32_t value) { out.append(reinterpret_cast<const char*>(&value), 4); };
+    std::string glb;
+    u32(glb, 0x46546C67);
+    u32(glb, 2);
+    u32(glb, uint32_t(12 + 8 + doc.size() + 8 + bin.size()));
+    u32(glb, uint32_t(doc.size()));
+    u32(glb, 0x4E4F534A);
+    glb += doc;
+    u32(glb, uint32_t(bin.size()));
+    u32(glb, 0x004E4942);
+    glb += bin;
+    return glb;
+}
+
+static const char IMAGE0[] = "first image";
+static const char IMAGE1[] = "second image";
+static const int CHAIN_NODES = 24;
+
+// One triangle, drawn by:
+//   node 0 "parent"   translate (10,0,0), children 1 and 2
+//   node 1 "scaled"   scale 2, textured material
+//   node 2 "mirrored" scale (-1,1,1)
+//   node 3 "broken"   a POSITION accessor one element longer than its view
+//   nodes 4/5         children of each other
+//   node 6 onwards    each lists the next node twice, the last one draws
+static std::string TestGlb() {
+    const float positions[9] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+    const uint16_t indices[3] = { 0, 1, 2 };
+    std::string bin;
+    Append(bin, positions, sizeof(positions));
+    const size_t indexOffset = bin.size();
+    Append(bin, indices, sizeof(indices));
+    const size_t image0Offset = bin.size();
+    Append(bin, IMAGE0, sizeof(IMAGE0) - 1);
+    const size_t image1Offset = bin.size();
+    Append(bin, IMAGE1, sizeof(IMAGE1) - 1);
+
+    auto view = [](size_t offset, size_t length) {
+        return "{\"buffer\":0,\"byteOffset\":" + std::to_string(offset) + ",\"byteLength\":" +
+            std::to_string(length) + "}";
+    };
+    std::string nodes =
+        "{\"name\":\"parent\",\"translation\":[10,0,0],\"children\":[1,2]},"
+        "{\"name\":\"scaled\",\"scale\":[2,2,2],\"mesh\":0},"
+        "{\"name\":\"mirrored\",\"scale\":[-1,1,1],\"mesh\":0},"
+        "{\"name\":\"broken\",\"mesh\":1},"
+        "{\"name\":\"loop\",\"children\":[5]},"
+        "{\"name\":\"back\",\"children\":[4],\"mesh\":0}";
+    for (int i = 0; i < CHAIN_NODES; ++i) {
+        int node = 6 + i;
+        nodes += ",{\"name\":\"chain" + std::to_string(i) + "\"";
+        if (i + 1 < CHAIN_NODES) {
+            nodes += ",\"children\":[" + std::to_string(node + 1) + "," + std::to_string(node + 1) + "]}";
+        }
+        else {
+            nodes += ",\"mesh\":0}";
+        }
+    }
+
+    std::string doc = std::string("{\"asset\":{\"version\":\"2.0\"},") +
+        "\"buffers\":[{\"byteLength\":" + std::to_string(bin.size()) + "}]," +
+        "\"bufferViews\":[" + view(0, 36) + "," + view(indexOffset, 6) + "," +
+        view(image0Offset, sizeof(IMAGE0) - 1) + "," + view(image1Offset, sizeof(IMAGE1) - 1) + "]," +
+        "\"accessors\":[" +
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"}," +
+        "{\"bufferView\":1,\"componentType\":5123,\"count\":3,\"type\":\"SCALAR\"}," +
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"}]," +
+        "\"images\":[{\"bufferView\":2,\"mimeType\":\"image/png\"},{\"bufferView\":3,\"mimeType\":\"image/png\"}]," +
+        "\"textures\":[{\"source\":0},{\"source\":1}]," +
+        "\"materials\":[{\"name\":\"painted\",\"pbrMetallicRoughness\":{\"baseColorTexture\":{\"index\":1}}}," +
+        "{\"name\":\"plain\"}]," +
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"indices\":1,\"material\":0}]}," +
+        "{\"primitives\":[{\"attributes\":{\"POSITION\":2},\"indices\":1,\"material\":1}]}]," +
+        "\"nodes\":[" + nodes + "]," +
+        "\"scenes\":[{\"nodes\":[0,3,4,6]}],\"scene\":0}";
+    return GlbBytes(doc, bin);
+}
+
+static std::string WriteTestGlb(const std::string& name, size_t keepBytes = std::string::npos) {
+    std::string path = TestTempPath(name);
+    std::string glb = TestGlb();
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << glb.substr(0, keepBytes);
+    return path;
+}
+
+static const Mesh* FindGroup(const std::vector<Mesh>& meshes, const std::string& group) {
+    for (const auto& mesh : meshes) {
+        if (mesh.group == group) return &mesh;
+    }
+    return nullptr;
+}
+
+static bool NearlyEqual(const glm::vec3& a, const glm::vec3& b) {
+    return glm::length(a - b) < 1e-5f;
+}
+
+TEST(GlbBakesNodeTransforms) {
+    std::vector<Mesh> meshes;
+    GlbLoadStats stats;
+    REQUIRE(LoadGlb(WriteTestGlb("nodes.glb"), true, meshes, stats));
+
+    const Mesh* scaled = FindGroup(meshes, "scaled");
+    REQUIRE(scaled && scaled->vertices.size() == 3);
+    CHECK(NearlyEqual(scaled->vertices[0].position, glm::vec3(10, 0, 0)));
+    CHECK(NearlyEqual(scaled->vertices[1].position, glm::vec3(12, 0, 0)));
+    CHECK(NearlyEqual(scaled->vertices[2].position, glm::vec3(10, 2, 0)));
+    CHECK(scaled->indices == std::vector<unsigned int>({ 0, 1, 2 }));
+    CHECK(NearlyEqual(scaled->vertices[0].normal, glm::vec3(0, 0, 1)));
+}
+
+// A negative scale mirrors the triangle, so its winding is turned around to
+// keep it front facing
+TEST(GlbFlipsMirroredWinding) {
+    std::vector<Mesh> meshes;
+    GlbLoadStats stats;
+    REQUIRE(LoadGlb(WriteTestGlb("mirrored.glb"), true, meshes, stats));
+
+    const Mesh* mirrored = FindGroup(meshes, "mirrored");
+    REQUIRE(mirrored && mirrored->vertices.size() == 3);
+    CHECK(NearlyEqual(mirrored->vertices[1].position, glm::vec3(9, 0, 0)));
+    CHECK(mirrored->indices == std::vector<unsigned int>({ 0, 2, 1 }));
+    CHECK(NearlyEqual(mirrored->vertices[0].normal, glm::vec3(0, 0, 1)));
+}
+
+// Materials point at images through textures[].source, not the texture index
+TEST(GlbMapsMaterialsToImages) {
+    std::string path = WriteTestGlb("materials.glb");
+    std::vector<Mesh> meshes;
+    GlbLoadStats stats;
+    REQUIRE(LoadGlb(path, true, meshes, stats));
+
+    const Mesh* scaled = FindGroup(meshes, "scaled");
+    REQUIRE(scaled);
+    CHECK(scaled->material.name == "painted");
+    CHECK(scaled->material.diffuseTexture == path + "#image1");
+    CHECK(IsGlbImagePath(scaled->material.diffuseTexture));
+
+    std::vector<unsigned char> bytes;
+    REQUIRE(ReadGlbImage(scaled->material.diffuseTexture, bytes));
+    CHECK(std::string(bytes.begin(), bytes.end()) == IMAGE1);
+
+    // Opened once, read for both images
+    std::shared_ptr<const GlbFile> glb = OpenGlbFile(path);
+    REQUIRE(glb != nullptr);
+    REQUIRE(ReadGlbImage(path + "#image0", bytes, glb.get()));
+    CHECK(std::string(bytes.begin(), bytes.end()) == IMAGE0);
+    REQUIRE(ReadGlbImage(path + "#image1", bytes, glb.get()));
+    CHECK(std::string(bytes.begin(), bytes.end()) == IMAGE1);
+    CHECK(!ReadGlbImage(path + "#image2", bytes, glb.get()));
+}
+
+// Cycles and shared children are visited once each; an accessor that
+// runs past its view skips only its own primitive
+TEST(GlbSkipsBadNodesAndAccessors) {
+    std::vector<Mesh> meshes;
+    GlbLoadStats stats;
+    REQUIRE(LoadGlb(WriteTestGlb("bad_nodes.glb"), true, meshes, stats));
+
+    CHECK(stats.primitives == 4);       // scaled, mirrored, back, last of the chain
+    CHECK(stats.skippedPrimitives == 1);
+    CHECK(meshes.size() == 4);
+    CHECK(FindGroup(meshes, "broken") == nullptr);
+    const Mesh* back = FindGroup(meshes, "back");
+    const Mesh* chained = FindGroup(meshes, "chain" + std::to_string(CHAIN_NODES - 1));
+    CHECK(back && back->indices.size() == 3);
+    CHECK(chained && chained->indices.size() == 3);
+}
+
+// Cut inside the BIN chunk, the file has no buffer to read from
+TEST(GlbRejectsTruncatedFile) {
+    const std::string full = TestGlb();
+    std::vector<Mesh> meshes;
+    GlbLoadStats stats;
+    CHECK(!LoadGlb(WriteTestGlb("truncated.glb", full.size() - 8), true, meshes, stats));
+    CHECK(meshes.empty());
+    CHECK(stats.skippedPrimitives > 0);
+    CHECK(!LoadGlb(WriteTestGlb("header_only.glb", 16), true, meshes, stats));
+}
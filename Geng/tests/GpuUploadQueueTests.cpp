@@ -0,0 +1,60 @@
+// GpuUploadQueueTests.cpp
+#include "TestFramework.h"
+#include "GpuUploadQueue.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Producers push while the consumer drains. Every job must run exactly once,
+// on the consumer, and each producer's jobs in the order it pushed them.
+TEST(UploadQueueMultipleProducers) {
+    const int PRODUCERS = 4;
+    const int JOBS_PER_PRODUCER = 20000;
+
+    GpuUploadQueue queue;
+    std::vector<std::vector<int>> ran(PRODUCERS);
+    std::atomic<int> wrongThread{ 0 };
+    std::atomic<int> producersDone{ 0 };
+    const std::thread::id consumer = std::this_thread::get_id();
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&, p]() {
+            for (int j = 0; j < JOBS_PER_PRODUCER; ++j) {
+                queue.Push([&, p, j]() {
+                    if (std::this_thread::get_id() != consumer) ++wrongThread;
+                    ran[p].push_back(j);
+                });
+            }
+            ++producersDone;
+        });
+    }
+
+    size_t drained = 0;
+    while (producersDone.load() < PRODUCERS || queue.Pending() > 0) {
+        drained += queue.Drain(1.0);
+    }
+    for (auto& producer : producers) producer.join();
+    drained += queue.Drain(1000.0);
+
+    CHECK(drained == size_t(PRODUCERS) * JOBS_PER_PRODUCER);
+    CHECK(queue.Pending() == 0);
+    CHECK(wrongThread.load() == 0);
+    for (int p = 0; p < PRODUCERS; ++p) {
+        REQUIRE(ran[p].size() == size_t(JOBS_PER_PRODUCER));
+        for (int j = 0; j < JOBS_PER_PRODUCER; ++j) {
+            REQUIRE(ran[p][j] == j);
+        }
+    }
+}
+
+TEST(UploadQueueDrainRunsOneJobOverBudget) {
+    GpuUploadQueue queue;
+    int ran = 0;
+    for (int j = 0; j < 3; ++j) queue.Push([&]() { ++ran; });
+    CHECK(queue.Drain(0.0) >= 1);
+    CHECK(ran >= 1);
+    queue.Drain(1000.0);
+    CHECK(ran == 3);
+    CHECK(queue.Drain(1000.0) == 0);
+}
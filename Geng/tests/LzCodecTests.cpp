@@ -0,0 +1,87 @@
+// LzCodecTests.cpp
+#include "TestFramework.h"
+#include "LzCodec.h"
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+static bool RoundTrips(const std::vector<char>& raw) {
+    std::vector<char> packed;
+    LzCompress(raw.data(), raw.size(), packed);
+    std::vector<char> unpacked(raw.size() + 1);
+    return LzDecompress(packed.data(), packed.size(), unpacked.data(), raw.size()) &&
+        memcmp(unpacked.data(), raw.data(), raw.size()) == 0;
+}
+
+static std::vector<char> Text(size_t size) {
+    static const char* words[] = { "v ", "vt ", "vn ", "f ", "0.5", "1.25", "/", "-3", "\n", " " };
+    std::mt19937 rng(7);
+    std::vector<char> text;
+    while (text.size() < size) {
+        const char* word = words[rng() % 10];
+        text.insert(text.end(), word, word + strlen(word));
+    }
+    text.resize(size);
+    return text;
+}
+
+static std::vector<char> Noise(size_t size) {
+    std::mt19937 rng(11);
+    std::vector<char> noise(size);
+    for (char& c : noise) c = char(rng());
+    return noise;
+}
+
+TEST(LzRoundTripsEdgeSizes) {
+    for (size_t size : { 0, 1, 4, 11, 12, 13, 16, 64 }) {
+        CHECK(RoundTrips(Text(size)));
+        CHECK(RoundTrips(std::vector<char>(size, 'a')));
+    }
+}
+
+TEST(LzRoundTripsLongInputs) {
+    CHECK(RoundTrips(Text(300000)));        // matches across the 64 KB window
+    CHECK(RoundTrips(Noise(100000)));       // literal runs longer than 15 + 255
+    CHECK(RoundTrips(std::vector<char>(200000, 'z')));   // overlapping matches, long lengths
+
+    std::vector<char> mixed = Noise(5000);
+    std::vector<char> text = Text(70000);
+    mixed.insert(mixed.end(), text.begin(), text.end());
+    mixed.insert(mixed.end(), mixed.begin(), mixed.begin() + 5000);
+    CHECK(RoundTrips(mixed));
+}
+
+TEST(LzCompressesRepetitiveData) {
+    std::string lines;
+    for (int i = 0; i < 5000; ++i) lines += "vn 0.000000 1.000000 " + std::to_string(i % 10) + ".000000\n";
+    std::vector<char> text(lines.begin(), lines.end());
+    std::vector<char> packed;
+    LzCompress(text.data(), text.size(), packed);
+    CHECK(packed.size() < text.size() / 2);
+}
+
+TEST(LzRejectsTruncatedAndMisSizedInput) {
+    std::vector<char> raw = Text(20000);
+    std::vector<char> packed;
+    LzCompress(raw.data(), raw.size(), packed);
+    std::vector<char> out(raw.size() + 64);
+
+    for (size_t size = 0; size < packed.size(); size += 1 + size / 64) {
+        CHECK(!LzDecompress(packed.data(), size, out.data(), raw.size()));
+    }
+    CHECK(!LzDecompress(packed.data(), packed.size(), out.data(), raw.size() - 1));
+    CHECK(!LzDecompress(packed.data(), packed.size(), out.data(), raw.size() + 1));
+}
+
+TEST(LzRejectsBadMatchOffset) {
+    // "abcd" then a match reaching 5 bytes back, before the start of the output
+    const unsigned char stream[] = { 0x40, 'a', 'b', 'c', 'd', 0x05, 0x00, 0x00 };
+    char out[16];
+    CHECK(!LzDecompress(reinterpret_cast<const char*>(stream), sizeof(stream), out, 8));
+
+    // Offset 0 is never valid
+    const unsigned char zero[] = { 0x40, 'a', 'b', 'c', 'd', 0x00, 0x00, 0x00 };
+    CHECK(!LzDecompress(reinterpret_cast<const char*>(zero), sizeof(zero), out, 8));
+}
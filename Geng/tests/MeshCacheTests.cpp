@@ -0,0 +1,190 @@
+// MeshCacheTests.cpp
+#include "TestFramework.h"
+#include "GlStub.h"
+#include "MeshCache.h"
+#include "model_loader.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+// Two groups of quads, so the cache holds more than one mesh
+static const char* CACHE_OBJ =
+    "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\n"
+    "vt 0 0\nvt 2 0\nvt 2 3\nvt 0 3\n"
+    "g front\nf 1/1 2/2 3/3 4/4\n"
+    "g back\nf 5/1 6/2 7/3 8/4\nf 1/1 5/2 8/3 4/4\n";
+
+static std::string WriteCacheObj(const std::string& name) {
+    std::string path = TestTempPath(name);
+    std::ofstream(path, std::ios::binary) << CACHE_OBJ;
+    std::error_code ec;
+    std::filesystem::remove(MeshCachePath(path), ec);
+    return path;
+}
+
+static std::vector<char> ReadBytes(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void WriteBytes(const std::string& path, const std::vector<char>& bytes, size_t size) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), std::streamsize(size));
+}
+
+static ModelLoadOptions CacheOptions() {
+    ModelLoadOptions options;
+    options.optimizeMeshes = false;
+    return options;
+}
+
+// Opens the cache with the flags the load wrote into its header
+static bool CacheOpens(const std::string& path, uint32_t flags) {
+    MappedFile file;
+    std::vector<CachedMeshView> views;
+    std::vector<std::string> sources;
+    return OpenMeshCache(path, flags, file, views, sources);
+}
+
+static uint32_t HeaderFlags(const std::vector<char>& bytes) {
+    uint32_t flags = 0;
+    if (bytes.size() >= 12) memcpy(&flags, bytes.data() + 8, sizeof(flags));
+    return flags;
+}
+
+TEST(MeshCacheHitMatchesParse) {
+    std::string path = WriteCacheObj("cache_hit.obj");
+    Model parsed;
+    REQUIRE(parsed.LoadSource(path, CacheOptions()));
+    REQUIRE(!parsed.stats.fromCache);
+
+    Model cached;
+    REQUIRE(cached.LoadSource(path, CacheOptions()));
+    CHECK(cached.stats.fromCache);
+    REQUIRE(cached.meshes.size() == parsed.meshes.size());
+    for (size_t m = 0; m < parsed.meshes.size(); ++m) {
+        const Mesh& a = parsed.meshes[m];
+        const Mesh& b = cached.meshes[m];
+        CHECK(b.mapping != nullptr);
+        CHECK(b.vertices.empty() && b.indices.empty());
+        REQUIRE(a.VertexCount() == b.VertexCount() && a.IndexCount() == b.IndexCount());
+        CHECK(memcmp(a.VertexData(), b.VertexData(), a.VertexCount() * sizeof(Vertex)) == 0);
+        CHECK(memcmp(a.IndexData(), b.IndexData(), a.IndexCount() * sizeof(unsigned int)) == 0);
+        CHECK(a.boundsMin == b.boundsMin && a.boundsMax == b.boundsMax);
+        CHECK(a.uvExtent == b.uvExtent);
+        CHECK(a.contentHash == b.contentHash);
+        CHECK(a.group == b.group);
+    }
+    CHECK(cached.meshes[0].uvExtent == 3.0f);
+}
+
+TEST(MeshCacheStoresPackedVertices) {
+    std::string path = WriteCacheObj("cache_packed.obj");
+    ModelLoadOptions options = CacheOptions();
+    options.vertexFormat = VertexFormat::Packed16;
+    Model parsed;
+    REQUIRE(parsed.LoadSource(path, options));
+
+    Model cached;
+    REQUIRE(cached.LoadSource(path, options));
+    REQUIRE(cached.stats.fromCache);
+    for (size_t m = 0; m < parsed.meshes.size(); ++m) {
+        const Mesh& a = parsed.meshes[m];
+        const Mesh& b = cached.meshes[m];
+        REQUIRE(b.mappedPackedVertices != nullptr);
+        CHECK(memcmp(a.packedVertices.data(), b.mappedPackedVertices, a.VertexCount() * sizeof(PackedVertex)) == 0);
+        CHECK(a.positionOffset == b.positionOffset && a.positionScale == b.positionScale);
+    }
+    CHECK(cached.stats.packedPositionError == parsed.stats.packedPositionError);
+}
+
+TEST(MeshCacheReleaseKeepsResidentCopy) {
+    std::string path = WriteCacheObj("cache_release.obj");
+    Model parsed;
+    REQUIRE(parsed.LoadSource(path, CacheOptions()));
+
+    ModelLoadOptions options = CacheOptions();
+    options.residency = GeometryResidency::PositionsOnly;
+    Model model;
+    REQUIRE(model.Load(path, options));
+    REQUIRE(model.stats.fromCache);
+    for (size_t m = 0; m < model.meshes.size(); ++m) {
+        const Mesh& mesh = model.meshes[m];
+        CHECK(mesh.mapping == nullptr);
+        CHECK(mesh.positions.size() == parsed.meshes[m].VertexCount());
+        CHECK(mesh.indices == parsed.meshes[m].indices);
+    }
+}
+
+TEST(MeshCacheRejectsTruncation) {
+    std::string path = WriteCacheObj("cache_truncated.obj");
+    Model model;
+    REQUIRE(model.LoadSource(path, CacheOptions()));
+    std::string cachePath = MeshCachePath(path);
+    std::vector<char> bytes = ReadBytes(cachePath);
+    const uint32_t flags = HeaderFlags(bytes);
+    REQUIRE(CacheOpens(path, flags));
+
+    for (size_t size = 0; size < bytes.size(); ++size) {
+        WriteBytes(cachePath, bytes, size);
+        if (CacheOpens(path, flags)) {
+            ReportFailure(__FILE__, __LINE__, "cache truncated to " + std::to_string(size) + " bytes opened");
+            break;
+        }
+    }
+}
+
+TEST(MeshCacheRejectsCorruption) {
+    std::string path = WriteCacheObj("cache_corrupt.obj");
+    Model model;
+    REQUIRE(model.LoadSource(path, CacheOptions()));
+    std::string cachePath = MeshCachePath(path);
+    const std::vector<char> bytes = ReadBytes(cachePath);
+    const uint32_t flags = HeaderFlags(bytes);
+
+    auto opensWith = [&](size_t offset, const void* value, size_t size) {
+        std::vector<char> corrupt = bytes;
+        memcpy(corrupt.data() + offset, value, size);
+        WriteBytes(cachePath, corrupt, corrupt.size());
+        return CacheOpens(path, flags);
+    };
+    const uint32_t wrongVersion = MESH_CACHE_VERSION + 1;
+    CHECK(!opensWith(0, "GMSX", 4));
+    CHECK(!opensWith(4, &wrongVersion, sizeof(wrongVersion)));
+
+    // An index past the vertex buffer, in the last mesh's index blob
+    const Mesh& last = model.meshes.back();
+    size_t indexBytes = last.IndexCount() * sizeof(unsigned int);
+    size_t lastIndices = bytes.size() - ((indexBytes + 15) / 16 * 16);
+    const unsigned int outOfRange = unsigned(last.VertexCount());
+    CHECK(!opensWith(lastIndices, &outOfRange, sizeof(outOfRange)));
+
+    // A vertex count larger than the file, where the last mesh stores its counts
+    const uint64_t counts[2] = { last.VertexCount(), last.IndexCount() };
+    const char* countBytes = reinterpret_cast<const char*>(counts);
+    auto found = std::find_end(bytes.begin(), bytes.end(), countBytes, countBytes + sizeof(counts));
+    REQUIRE(found != bytes.end());
+    const uint64_t hugeCount = uint64_t(1) << 40;
+    CHECK(!opensWith(size_t(found - bytes.begin()), &hugeCount, sizeof(hugeCount)));
+
+    // LOD tables: none at all, a level 0 that is not the full mesh, and one
+    // that stops short of the index payload. Without simplified levels the
+    // table is count 1, then first index 0 and the whole index count.
+    std::vector<char> lodBytes(4 + 16);
+    const uint32_t one = 1;
+    const uint64_t full[2] = { 0, last.IndexCount() };
+    memcpy(lodBytes.data(), &one, 4);
+    memcpy(lodBytes.data() + 4, full, 16);
+    auto table = std::find_end(bytes.begin(), bytes.end(), lodBytes.begin(), lodBytes.end());
+    REQUIRE(table != bytes.end());
+    const size_t tableOffset = size_t(table - bytes.begin());
+    const uint32_t noLods = 0;
+    const uint64_t shifted = 3, shorter = last.IndexCount() - 3;
+    CHECK(!opensWith(tableOffset, &noLods, sizeof(noLods)));
+    CHECK(!opensWith(tableOffset + 4, &shifted, sizeof(shifted)));
+    CHECK(!opensWith(tableOffset + 12, &shorter, sizeof(shorter)));
+
+    WriteBytes(cachePath, bytes, bytes.size());
+    CHECK(CacheOpens(path, flags));
+}
@@ -0,0 +1,204 @@
+// MipCacheTests.cpp
+#include "TestFramework.h"
+#include "GlStub.h"
+#include "MipCache.h"
+#include "PixelUploadRing.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Offsets into a .gtex file, as MipCache.cpp lays it out
+static const size_t HEADER_VERSION = 4;
+static const size_t HEADER_KEY = 8;
+static const size_t HEADER_COMPONENTS = 24;
+static const size_t HEADER_LEVEL_COUNT = 28;
+static const size_t HEADER_BLOCK_FORMAT = 32;
+static const size_t FIRST_LEVEL = 40;
+static const size_t LEVEL_ENTRY = 24;       // width height offset(u64) size(u64)
+
+static std::vector<char> ReadBytes(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void WriteBytes(const std::string& path, const std::vector<char>& bytes, size_t size) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), std::streamsize(size));
+}
+
+// A full chain of patterned texels, down to 1x1
+static void MakeChain(int width, int height, int components, DecodedImage& image) {
+    image.width = width;
+    image.height = height;
+    image.components = components;
+    std::vector<size_t> offsets;
+    for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        ImageLevel level;
+        level.width = w;
+        level.height = h;
+        level.size = size_t(w) * size_t(h) * size_t(components);
+        offsets.push_back(image.levelStorage.size());
+        image.levelStorage.resize(image.levelStorage.size() + level.size);
+        image.levels.push_back(level);
+        if (w == 1 && h == 1) break;
+    }
+    for (size_t i = 0; i < image.levelStorage.size(); ++i) {
+        image.levelStorage[i] = static_cast<unsigned char>(i * 37 + 11);
+    }
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        image.levels[i].pixels = image.levelStorage.data() + offsets[i];
+    }
+}
+
+static bool SameLevels(const DecodedImage& a, const DecodedImage& b) {
+    if (a.levels.size() != b.levels.size()) return false;
+    for (size_t i = 0; i < a.levels.size(); ++i) {
+        const ImageLevel& x = a.levels[i];
+        const ImageLevel& y = b.levels[i];
+        if (x.width != y.width || x.height != y.height || x.size != y.size ||
+            memcmp(x.pixels, y.pixels, x.size) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool CacheOpens(uint64_t key) {
+    DecodedImage image;
+    return OpenMipCache(key, image);
+}
+
+TEST(MipCacheRoundTrip) {
+    const uint64_t key = MipCacheKey(0x6d69707465737431ull);
+    DecodedImage written;
+    MakeChain(12, 5, 3, written);
+    REQUIRE(WriteMipCache(key, written));
+
+    DecodedImage read;
+    REQUIRE(OpenMipCache(key, read));
+    CHECK(read.width == 12 && read.height == 5 && read.components == 3);
+    CHECK(read.mipCacheKey == key);
+    CHECK(read.blockFormat == BlockFormat::None);
+    CHECK(SameLevels(written, read));
+    read.levelFile.Close();
+    std::filesystem::remove(MipCachePath(key));
+}
+
+TEST(MipCacheRejectsTruncation) {
+    const uint64_t key = MipCacheKey(0x6d69707465737432ull);
+    DecodedImage written;
+    MakeChain(9, 7, 4, written);
+    REQUIRE(WriteMipCache(key, written));
+    const std::string path = MipCachePath(key);
+    const std::vector<char> bytes = ReadBytes(path);
+    REQUIRE(CacheOpens(key));
+
+    // The last level ends the file, so every shorter size loses data
+    for (size_t size = 0; size < bytes.size(); ++size) {
+        WriteBytes(path, bytes, size);
+        if (CacheOpens(key)) {
+            ReportFailure(__FILE__, __LINE__, "mip cache truncated to " + std::to_string(size) + " bytes opened");
+            break;
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(MipCacheRejectsCorruption) {
+    const uint64_t key = MipCacheKey(0x6d69707465737433ull);
+    DecodedImage written;
+    MakeChain(8, 8, 2, written);
+    REQUIRE(WriteMipCache(key, written));
+    const std::string path = MipCachePath(key);
+    const std::vector<char> bytes = ReadBytes(path);
+
+    auto opensWith = [&](size_t offset, const void* value, size_t size) {
+        std::vector<char> corrupt = bytes;
+        memcpy(corrupt.data() + offset, value, size);
+        WriteBytes(path, corrupt, corrupt.size());
+        return CacheOpens(key);
+    };
+    const uint32_t wrongVersion = MIP_CACHE_VERSION + 1;
+    const uint64_t otherKey = key + 1;
+    const uint32_t zero = 0, five = 5, tooManyLevels = 33, unknownFormat = 2, bc4 = uint32_t(BlockFormat::BC4);
+    CHECK(!opensWith(0, "GTEY", 4));
+    CHECK(!opensWith(HEADER_VERSION, &wrongVersion, sizeof(wrongVersion)));
+    CHECK(!opensWith(HEADER_KEY, &otherKey, sizeof(otherKey)));
+    CHECK(!opensWith(HEADER_COMPONENTS, &zero, sizeof(zero)));
+    CHECK(!opensWith(HEADER_COMPONENTS, &five, sizeof(five)));
+    CHECK(!opensWith(HEADER_LEVEL_COUNT, &zero, sizeof(zero)));
+    CHECK(!opensWith(HEADER_LEVEL_COUNT, &tooManyLevels, sizeof(tooManyLevels)));
+    CHECK(!opensWith(HEADER_BLOCK_FORMAT, &unknownFormat, sizeof(unknownFormat)));
+    // Texel-sized levels are the wrong size for blocks
+    CHECK(!opensWith(HEADER_BLOCK_FORMAT, &bc4, sizeof(bc4)));
+
+    // Per level: a size that breaks the halving chain, data past the end of
+    // the file, and a size that does not match the dimensions
+    const size_t second = FIRST_LEVEL + LEVEL_ENTRY;
+    const uint32_t wrongWidth = 3;
+    const uint64_t pastEnd = uint64_t(bytes.size());
+    const uint64_t hugeSize = uint64_t(1) << 40;
+    const uint64_t shortSize = 4;
+    CHECK(!opensWith(second, &wrongWidth, sizeof(wrongWidth)));
+    CHECK(!opensWith(second + 8, &pastEnd, sizeof(pastEnd)));
+    CHECK(!opensWith(second + 16, &hugeSize, sizeof(hugeSize)));
+    CHECK(!opensWith(second + 16, &shortSize, sizeof(shortSize)));
+
+    WriteBytes(path, bytes, bytes.size());
+    CHECK(CacheOpens(key));
+    std::filesystem::remove(path);
+}
+
+// A damaged entry is a miss: the image decodes again and the entry is rewritten
+TEST(MipCacheRebuildsDamagedEntry) {
+    std::string ppm = "P6\n4 2\n255\n";
+    for (int i = 0; i < 4 * 2 * 3; ++i) ppm.push_back(char(i * 9 + 200));
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(ppm.data());
+
+    DecodedImage first;
+    REQUIRE(DecodeImageMemoryMips(bytes, ppm.size(), false, first));
+    REQUIRE(first.mipCacheKey != 0);
+    const std::string path = MipCachePath(first.mipCacheKey);
+    const std::vector<char> good = ReadBytes(path);
+    first.levelFile.Close();
+
+    WriteBytes(path, good, good.size() / 2);
+    DecodedImage rebuilt;
+    REQUIRE(DecodeImageMemoryMips(bytes, ppm.size(), false, rebuilt));
+    CHECK(rebuilt.mipCacheKey == first.mipCacheKey);
+    CHECK(rebuilt.levels.size() == 3);
+    CHECK(ReadBytes(path) == good);
+
+    DecodedImage reopened;
+    REQUIRE(OpenMipCache(first.mipCacheKey, reopened));
+    CHECK(SameLevels(rebuilt, reopened));
+    reopened.levelFile.Close();
+    std::filesystem::remove(path);
+}
+
+// Two channels upload as GL_RG, so GL reads exactly the bytes each level holds
+TEST(UploadsTwoChannelLevelsAsRg) {
+    PixelUploadRing::Shared().Release();
+    DecodedImage chain;
+    MakeChain(9, 7, 2, chain);
+    CHECK(TextureFormat(2) == GL_RG);
+    CHECK(ImageInternalFormat(chain) == GL_RG8);
+    UploadImageLevels(chain, ImageInternalFormat(chain));
+    CHECK(GlStub().textureLevelUploads == chain.levels.size());
+    CHECK(GlStub().textureBytesRead == chain.levelStorage.size());
+
+    // A lone level 0, which the caller mipmaps
+    std::vector<unsigned char> texels(9 * 7 * 2, 0x40);
+    DecodedImage single;
+    single.width = 9;
+    single.height = 7;
+    single.components = 2;
+    single.pixels = texels.data();
+    const size_t before = GlStub().textureBytesRead;
+    UploadImageLevels(single, ImageInternalFormat(single));
+    CHECK(GlStub().textureBytesRead == before + 9 * 7 * 2);
+    single.pixels = nullptr;
+    PixelUploadRing::Shared().Release();
+}
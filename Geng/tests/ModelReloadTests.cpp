@@ -0,0 +1,152 @@
+// ModelReloadTests.cpp
+#include "TestFramework.h"
+#include "GlStub.h"
+#include "GpuUploadQueue.h"
+#include "PixelUploadRing.h"
+#include "model_loader.h"
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// A 2x2 binary PPM, which stb_image reads like any other embedded image
+static std::string TinyPpm(unsigned char shade) {
+    std::string ppm = "P6\n2 2\n255\n";
+    for (int i = 0; i < 2 * 2 * 3; ++i) ppm.push_back(char(shade + i));
+    return ppm;
+}
+
+static void Append(std::string& bin, const void* data, size_t size) {
+    bin.append(static_cast<const char*>(data), size);
+    while (bin.size() % 4) bin.push_back('\0');
+}
+
+// One triangle drawn twice, once with each of the two embedded images
+static void WriteTwoImageGlb(const std::string& path, float height, const std::string& image0,
+    const std::string& image1) {
+    const float positions[9] = { 0, 0, 0, 1, 0, 0, 0, height, 0 };
+    const unsigned int indices[3] = { 0, 1, 2 };
+    std::string bin;
+    Append(bin, positions, sizeof(positions));
+    const size_t image0Offset = bin.size();
+    Append(bin, image0.data(), image0.size());
+    const size_t image1Offset = bin.size();
+    Append(bin, image1.data(), image1.size());
+    const size_t indicesOffset = bin.size();
+    Append(bin, indices, sizeof(indices));
+
+    std::string doc = std::string("{\"asset\":{\"version\":\"2.0\"},") +
+        "\"buffers\":[{\"byteLength\":" + std::to_string(bin.size()) + "}]," +
+        "\"bufferViews\":[" +
+        "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":36}," +
+        "{\"buffer\":0,\"byteOffset\":" + std::to_string(image0Offset) + ",\"byteLength\":" + std::to_string(image0.size()) + "}," +
+        "{\"buffer\":0,\"byteOffset\":" + std::to_string(image1Offset) + ",\"byteLength\":" + std::to_string(image1.size()) + "}," +
+        "{\"buffer\":0,\"byteOffset\":" + std::to_string(indicesOffset) + ",\"byteLength\":12}]," +
+        "\"accessors\":[" +
+        "{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"}," +
+        "{\"bufferView\":3,\"componentType\":5125,\"count\":3,\"type\":\"SCALAR\"}]," +
+        "\"images\":[{\"bufferView\":1,\"mimeType\":\"image/x-portable-pixmap\"}," +
+        "{\"bufferView\":2,\"mimeType\":\"image/x-portable-pixmap\"}]," +
+        "\"textures\":[{\"source\":0},{\"source\":1}]," +
+        "\"materials\":[{\"pbrMetallicRoughness\":{\"baseColorTexture\":{\"index\":0}}}," +
+        "{\"pbrMetallicRoughness\":{\"baseColorTexture\":{\"index\":1}}}]," +
+        "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"indices\":1,\"material\":0}," +
+        "{\"attributes\":{\"POSITION\":0},\"indices\":1,\"material\":1}]}]}";
+    while (doc.size() % 4) doc.push_back(' ');
+
+    auto u32 = [](std::string& out, uint32_t value) { out.append(reinterpret_cast<const char*>(&value), 4); };
+    std::string glb;
+    u32(glb, 0x46546C67);
+    u32(glb, 2);
+    u32(glb, uint32_t(12 + 8 + doc.size() + 8 + bin.size()));
+    u32(glb, uint32_t(doc.size()));
+    u32(glb, 0x4E4F534A);
+    glb += doc;
+    u32(glb, uint32_t(bin.size()));
+    u32(glb, 0x004E4942);
+    glb += bin;
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << glb;
+}
+
+static bool FinishReload(const ModelLoadHandle& task, GpuUploadQueue& uploads) {
+    if (!task) return false;
+    while (!task->IsFinished()) uploads.Drain(1.0);
+    return task->GetStatus() == ModelLoadTask::Status::Done;
+}
+
+// Rewriting a .glb re-decodes only the embedded images whose bytes changed
+TEST(GlbReloadRedecodesOnlyChangedImages) {
+    PixelUploadRing::Shared().Release();
+    std::string path = TestTempPath("two_images.glb");
+    WriteTwoImageGlb(path, 1.0f, TinyPpm(10), TinyPpm(60));
+    ModelLoadOptions options;
+    options.useMeshCache = false;
+    options.useMipCache = false;
+    options.lazyTextures = false;
+    Model model;
+    REQUIRE(model.Load(path, options));
+    REQUIRE(model.loadedTextures.size() == 2);
+    const size_t created = GlStub().texturesCreated;
+
+    // Geometry edit, same images: nothing is decoded or uploaded again
+    GpuUploadQueue uploads;
+    WriteTwoImageGlb(path, 2.0f, TinyPpm(10), TinyPpm(60));
+    REQUIRE(FinishReload(model.ReloadAsync(path, uploads), uploads));
+    CHECK(model.stats.reloadedTextures == 0);
+    CHECK(GlStub().texturesCreated == created);
+    CHECK(model.loadedTextures.size() == 2);
+
+    // One image edited: only that one is replaced, its pixels copied on the pool
+    GLuint first = model.loadedTextures[path + "#image0"];
+    const PixelUploadRing::Stats before = PixelUploadRing::Shared().GetStats();
+    WriteTwoImageGlb(path, 2.0f, TinyPpm(10), TinyPpm(110));
+    REQUIRE(FinishReload(model.ReloadAsync(path, uploads), uploads));
+    CHECK(model.stats.reloadedTextures == 1);
+    CHECK(GlStub().texturesCreated == created + 1);
+    CHECK(model.loadedTextures[path + "#image0"] == first);
+    CHECK(PixelUploadRing::Shared().GetStats().copiedBytes == before.copiedBytes + 2 * 2 * 3);
+    CHECK(PixelUploadRing::Shared().GetStats().stagedBytes == before.stagedBytes);
+    model.Cleanup();
+    PixelUploadRing::Shared().Release();
+}
+
+// Editing an MTL decodes textures only for materials a mesh is drawn with
+TEST(MtlReloadSkipsUnusedMaterials) {
+    PixelUploadRing::Shared().Release();
+    std::ofstream(TestTempPath("reload_used.ppm"), std::ios::binary) << TinyPpm(20);
+    std::ofstream(TestTempPath("reload_unused.ppm"), std::ios::binary) << TinyPpm(80);
+    std::ofstream(TestTempPath("reload_edited.ppm"), std::ios::binary) << TinyPpm(140);
+    const std::string mtl = TestTempPath("reload_materials.mtl");
+    auto writeMtl = [&mtl](const char* usedTexture) {
+        std::ofstream(mtl, std::ios::binary | std::ios::trunc) << "newmtl used\nmap_Kd " << usedTexture <<
+            "\nnewmtl unused\nmap_Kd reload_unused.ppm\n";
+    };
+    writeMtl("reload_used.ppm");
+    std::string path = TestTempPath("reload_materials.obj");
+    std::ofstream(path, std::ios::binary) << "mtllib reload_materials.mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\n"
+        "usemtl used\nf 1 2 3\n";
+
+    ModelLoadOptions options;
+    options.useMeshCache = false;
+    options.useMipCache = false;
+    options.lazyTextures = false;
+    Model model;
+    REQUIRE(model.Load(path, options));
+    REQUIRE(model.loadedTextures.size() == 1);
+    const size_t created = GlStub().texturesCreated;
+
+    GpuUploadQueue uploads;
+    writeMtl("reload_used.ppm");
+    REQUIRE(FinishReload(model.ReloadAsync(mtl, uploads), uploads));
+    CHECK(model.stats.reloadedTextures == 0);
+    CHECK(GlStub().texturesCreated == created);
+
+    writeMtl("reload_edited.ppm");
+    REQUIRE(FinishReload(model.ReloadAsync(mtl, uploads), uploads));
+    CHECK(model.stats.reloadedTextures == 1);
+    CHECK(GlStub().texturesCreated == created + 1);
+    CHECK(model.loadedTextures.size() == 1);
+    CHECK(model.loadedTextures.count(TestTempPath("reload_edited.ppm")) == 1);
+    model.Cleanup();
+    PixelUploadRing::Shared().Release();
+}
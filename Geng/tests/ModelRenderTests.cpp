@@ -0,0 +1,32 @@
+// ModelRenderTests.cpp
+#include "TestFramework.h"
+#include "GlStub.h"
+#include "model_loader.h"
+#include <fstream>
+
+static const char* THREE_GROUPS_OBJ =
+    "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+    "g a\nf 1 2 3\ng b\nf 1 2 3\ng c\nf 1 2 3\n";
+
+// Locations are looked up once per program, not per mesh or per frame
+TEST(RenderLooksUpUniformsOncePerProgram) {
+    std::string path = TestTempPath("three_groups.obj");
+    std::ofstream(path, std::ios::binary) << THREE_GROUPS_OBJ;
+    ModelLoadOptions options;
+    options.useMeshCache = false;
+    Model model;
+    REQUIRE(model.Load(path, options));
+    REQUIRE(model.meshes.size() == 3);
+
+    const GLuint program = 7;
+    model.Render(program);
+    const size_t perProgram = GlStub().uniformLookups;
+    CHECK(perProgram > 0);
+
+    for (int frame = 0; frame < 3; ++frame) model.Render(program);
+    CHECK(GlStub().uniformLookups == perProgram);
+
+    model.Render(program + 1);
+    model.Render(program);
+    CHECK(GlStub().uniformLookups == perProgram * 2);
+}
@@ -0,0 +1,105 @@
+// ObjLoaderTests.cpp
+#include "TestFramework.h"
+#include "model_loader.h"
+#include "ObjBenchmark.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static std::string WriteObj(const std::string& name, const std::string& text) {
+    std::string path = TestTempPath(name);
+    std::ofstream(path, std::ios::binary) << text;
+    return path;
+}
+
+static ModelLoadOptions PlainOptions() {
+    ModelLoadOptions options;
+    options.useMeshCache = false;
+    options.optimizeMeshes = false;
+    return options;
+}
+
+// One good triangle, then faces that fail after corners that would have
+// been new vertices: an out of range index and a two-corner face.
+static const char* BAD_FACES_OBJ =
+    "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+    "f 1 2 3\n"
+    "f 4 1 9\n"
+    "f 4 2\n"
+    "f -1 -3 -40\n";
+
+TEST(BadWeldedFaceLeavesNoVertices) {
+    Model model;
+    REQUIRE(model.LoadSource(WriteObj("bad_faces.obj", BAD_FACES_OBJ), PlainOptions()));
+    REQUIRE(model.meshes.size() == 1);
+    CHECK(model.meshes[0].vertices.size() == 3);
+    CHECK(model.meshes[0].indices.size() == 3);
+}
+
+TEST(BadUnweldedFaceLeavesNoVertices) {
+    ModelLoadOptions options = PlainOptions();
+    options.weldVertices = false;
+    Model model;
+    REQUIRE(model.LoadSource(WriteObj("bad_faces.obj", BAD_FACES_OBJ), options));
+    REQUIRE(model.meshes.size() == 1);
+    CHECK(model.meshes[0].vertices.size() == 3);
+    CHECK(model.meshes[0].indices.size() == 3);
+}
+
+TEST(WeldedFaceAfterBadFaceReusesVertices) {
+    Model model;
+    REQUIRE(model.LoadSource(WriteObj("bad_then_good.obj", std::string(BAD_FACES_OBJ) + "f 1 3 4\n"),
+        PlainOptions()));
+    REQUIRE(model.meshes.size() == 1);
+    CHECK(model.meshes[0].vertices.size() == 4);
+    CHECK(model.meshes[0].indices.size() == 6);
+}
+
+static void CheckSameMeshes(const Model& expected, const Model& actual, unsigned threads) {
+    REQUIRE(expected.meshes.size() == actual.meshes.size());
+    for (size_t m = 0; m < expected.meshes.size(); ++m) {
+        const Mesh& a = expected.meshes[m];
+        const Mesh& b = actual.meshes[m];
+        bool same = a.material.name == b.material.name && a.group == b.group &&
+            a.vertices.size() == b.vertices.size() && a.indices.size() == b.indices.size() &&
+            memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) == 0 &&
+            memcmp(a.indices.data(), b.indices.data(), a.indices.size() * sizeof(unsigned int)) == 0;
+        if (!same) {
+            ReportFailure(__FILE__, __LINE__, "mesh " + std::to_string(m) + " (" + a.group + ", " +
+                a.material.name + ") differs with parseThreads=" + std::to_string(threads));
+            return;
+        }
+    }
+}
+
+// A file several OBJ chunks long, whose rows switch usemtl, open o/g groups
+// that straddle chunk boundaries and use negative indices, parses to the
+// same meshes in chunks on the pool as in the one chunk of a serial parse.
+TEST(ChunkedParseMatchesSerialParse) {
+    std::string path = TestTempPath("chunked.obj");
+    REQUIRE(WriteSyntheticObj(path, 40000));
+    REQUIRE(std::filesystem::file_size(path) > 4 * (size_t(1) << 20));
+
+    for (bool splitGroups : { true, false }) {
+        ModelLoadOptions options = PlainOptions();
+        options.splitGroups = splitGroups;
+        options.parseThreads = 1;     // one chunk: nothing to stitch
+        Model serial;
+        REQUIRE(serial.LoadSource(path, options));
+        REQUIRE(serial.meshes.size() > 1);
+
+        for (unsigned threads : { 0u, 3u }) {
+            options.parseThreads = threads;
+            Model parallel;
+            REQUIRE(parallel.LoadSource(path, options));
+            CheckSameMeshes(serial, parallel, threads);
+        }
+    }
+}
+
+// The benchmark refuses to time a parser whose corners differ from the old one's
+TEST(ObjBenchmarkMatchesLegacyParse) {
+    std::string path = TestTempPath("bench_small.obj");
+    std::filesystem::remove(path);
+    CHECK(RunObjBenchmark(path, 3000));
+}
@@ -0,0 +1,113 @@
+// PixelUploadRingTests.cpp
+#include "TestFramework.h"
+#include "GlStub.h"
+#include "GpuUploadQueue.h"
+#include "PixelUploadRing.h"
+#include "model_loader.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+// Mapped on the GL thread, filled by another, then handed out by Stage
+// without a second copy or map
+TEST(RingBatchCopiesOffGlThread) {
+    PixelUploadRing& ring = PixelUploadRing::Shared();
+    ring.Release();     // drop buffers from an earlier test's stub
+    std::vector<unsigned char> a(1000, 0x11), b(77, 0x22);
+
+    PixelCopyBatch batch;
+    batch.sources = { { a.data(), a.size() }, { b.data(), b.size() } };
+    REQUIRE(ring.MapBatch(batch));
+    REQUIRE(batch.offsets.size() == 2);
+    CHECK(batch.offsets[1] % 16 == 0 && batch.offsets[1] >= batch.offsets[0] + a.size());
+
+    PixelCopyBatch other;
+    other.sources = { { b.data(), b.size() } };
+    CHECK(!ring.MapBatch(other));     // one batch at a time
+
+    std::thread loader([&ring, &batch]() { ring.CopyBatch(batch); });
+    loader.join();
+    CHECK(batch.data[0] == 0x11 && batch.data[batch.offsets[1] - batch.begin] == 0x22);
+    REQUIRE(ring.UnmapBatch(batch));
+
+    const PixelUploadRing::Stats before = ring.GetStats();
+    const size_t maps = GlStub().bufferMaps;
+    CHECK(ring.Stage(a.data(), a.size()) == reinterpret_cast<const void*>(uintptr_t(batch.offsets[0])));
+    CHECK(ring.Stage(b.data(), b.size()) == reinterpret_cast<const void*>(uintptr_t(batch.offsets[1])));
+    ring.ReleaseBatch(batch);
+    CHECK(GlStub().bufferMaps == maps);
+    CHECK(ring.GetStats().copiedBytes == before.copiedBytes + a.size() + b.size());
+    CHECK(ring.GetStats().stagedBytes == before.stagedBytes);
+
+    // Released, the copies are gone and the ring takes the next batch
+    ring.Stage(a.data(), a.size());
+    ring.Finish();
+    CHECK(ring.GetStats().stagedBytes == before.stagedBytes + a.size());
+    REQUIRE(ring.MapBatch(other));
+    ring.ReleaseBatch(other);
+    ring.Release();
+}
+
+// A copy that only gets to run after the ring is released, or after its
+// batch was unmapped, writes nothing, and the batch is not handed out
+TEST(RingSkipsCopiesAfterRelease) {
+    PixelUploadRing& ring = PixelUploadRing::Shared();
+    ring.Release();
+    std::vector<unsigned char> a(256, 0x33);
+    const PixelUploadRing::Stats before = ring.GetStats();
+
+    PixelCopyBatch late;
+    late.sources = { { a.data(), a.size() } };
+    REQUIRE(ring.MapBatch(late));
+    ring.Release();
+
+    // The next batch is mapped over fresh memory at the same offsets
+    PixelCopyBatch next;
+    next.sources = { { a.data(), a.size() } };
+    REQUIRE(ring.MapBatch(next));
+    std::thread loader([&ring, &late]() { ring.CopyBatch(late); });
+    loader.join();
+    CHECK(next.data[0] == 0 && next.data[a.size() - 1] == 0);
+
+    // Unmapped before it was copied: Stage copies instead
+    CHECK(!ring.UnmapBatch(next));
+    ring.CopyBatch(next);
+    ring.Stage(a.data(), a.size());
+    ring.ReleaseBatch(next);
+    CHECK(ring.GetStats().copiedBytes == before.copiedBytes);
+    CHECK(ring.GetStats().stagedBytes == before.stagedBytes + a.size());
+    ring.Release();
+}
+
+// LoadAsync copies texture pixels on the pool; the GL thread only maps once
+TEST(LoadAsyncCopiesTexturesOffGlThread) {
+    PixelUploadRing::Shared().Release();
+    std::string ppm = "P6\n8 4\n255\n";
+    for (int i = 0; i < 8 * 4 * 3; ++i) ppm.push_back(char(i));
+    std::ofstream(TestTempPath("ring_texture.ppm"), std::ios::binary) << ppm;
+    std::ofstream(TestTempPath("ring_model.mtl"), std::ios::binary) << "newmtl lit\nmap_Kd ring_texture.ppm\n";
+    std::string path = TestTempPath("ring_model.obj");
+    std::ofstream(path, std::ios::binary) << "mtllib ring_model.mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\nusemtl lit\nf 1 2 3\n";
+
+    ModelLoadOptions options;
+    options.useMeshCache = false;
+    options.useMipCache = false;
+    options.lazyTextures = false;
+    const PixelUploadRing::Stats before = PixelUploadRing::Shared().GetStats();
+    GpuUploadQueue uploads;
+    Model model;
+    ModelLoadHandle task = model.LoadAsync(path, uploads, options);
+    while (!task->IsFinished()) uploads.Drain(1.0);
+    REQUIRE(task->GetStatus() == ModelLoadTask::Status::Done);
+    CHECK(model.loadedTextures.size() == 1);
+
+    const PixelUploadRing::Stats after = PixelUploadRing::Shared().GetStats();
+    CHECK(after.copiedBytes == before.copiedBytes + 8 * 4 * 3);
+    CHECK(after.stagedBytes == before.stagedBytes);
+    CHECK(GlStub().bufferMaps == 1);
+    CHECK(GlStub().bufferUnmaps == 1);
+    model.Cleanup();
+    PixelUploadRing::Shared().Release();
+}
@@ -0,0 +1,24 @@
+// TestFramework.h
+#pragma once
+#include <string>
+
+// Just enough of a test runner for GengTests. TEST(Name) { ... } registers a
+// test; CHECK records a failure and carries on, REQUIRE also returns from the
+// test. GengTests runs every test, or those whose names contain argv[1].
+typedef void (*TestFunction)();
+bool RegisterTest(const char* name, TestFunction run);
+void ReportFailure(const char* file, int line, const std::string& what);
+
+// A path under the system temp directory for files a test writes.
+std::string TestTempPath(const std::string& name);
+
+#define TEST(name) \
+    static void name(); \
+    static const bool name##Registered = RegisterTest(#name, name); \
+    static void name()
+
+#define CHECK(expr) \
+    do { if (!(expr)) ReportFailure(__FILE__, __LINE__, #expr); } while (0)
+
+#define REQUIRE(expr) \
+    do { if (!(expr)) { ReportFailure(__FILE__, __LINE__, #expr); return; } } while (0)
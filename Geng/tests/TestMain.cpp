@@ -0,0 +1,53 @@
+// TestMain.cpp
+#include "TestFramework.h"
+#include "GlStub.h"
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+struct RegisteredTest {
+    const char* name;
+    TestFunction run;
+};
+
+static std::vector<RegisteredTest>& Registry() {
+    static std::vector<RegisteredTest> tests;
+    return tests;
+}
+
+static int currentFailures = 0;
+
+bool RegisterTest(const char* name, TestFunction run) {
+    Registry().push_back({ name, run });
+    return true;
+}
+
+void ReportFailure(const char* file, int line, const std::string& what) {
+    std::cerr << file << "(" << line << "): CHECK failed: " << what << std::endl;
+    ++currentFailures;
+}
+
+std::string TestTempPath(const std::string& name) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "GengTests";
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    return (dir / name).string();
+}
+
+int main(int argc, char** argv) {
+    InstallGlStub();
+
+    int failed = 0, run = 0;
+    for (const RegisteredTest& test : Registry()) {
+        if (argc > 1 && !std::strstr(test.name, argv[1])) continue;
+        currentFailures = 0;
+        ResetGlStub();
+        test.run();
+        ++run;
+        if (currentFailures) ++failed;
+        std::cout << (currentFailures ? "[FAIL] " : "[ OK ] ") << test.name << std::endl;
+    }
+    std::cout << run - failed << "/" << run << " tests passed" << std::endl;
+    return failed ? 1 : 0;
+}
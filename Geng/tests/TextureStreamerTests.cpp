@@ -0,0 +1,183 @@
+// TextureStreamerTests.cpp
+#include "TestFramework.h"
+#include "GlStub.h"
+#include "MipCache.h"
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <memory>
+
+// A 128x128 RGBA chain held in memory: 8 levels, 64 KB at level 0
+static const int STREAM_SIZE = 128;
+static const int STREAM_TAIL = 32;      // tail starts at level 2
+
+static std::shared_ptr<DecodedImage> MakeStreamImage(int components = 4) {
+    auto image = std::make_shared<DecodedImage>();
+    image->width = image->height = STREAM_SIZE;
+    image->components = components;
+    size_t total = 0;
+    for (int size = STREAM_SIZE; ; size /= 2) {
+        ImageLevel level;
+        level.width = level.height = size;
+        level.size = size_t(size) * size * size_t(components);
+        image->levels.push_back(level);
+        total += level.size;
+        if (size == 1) break;
+    }
+    image->levelStorage.assign(total, 0x5a);
+    size_t offset = 0;
+    for (auto& level : image->levels) {
+        level.pixels = image->levelStorage.data() + offset;
+        offset += level.size;
+    }
+    return image;
+}
+
+// What a texture holding 'level' and coarser takes
+static size_t ChainBytes(const DecodedImage& image, size_t level) {
+    size_t bytes = 0;
+    for (size_t i = level; i < image.levels.size(); ++i) bytes += image.levels[i].size;
+    return bytes;
+}
+
+static TextureStreamer::Settings StreamSettings() {
+    TextureStreamer::Settings settings;
+    settings.tailSize = STREAM_TAIL;
+    settings.uploadBytesPerFrame = 1 << 20;
+    settings.residentBudgetBytes = 1 << 20;
+    settings.idleFrames = 2;
+    return settings;
+}
+
+TEST(StreamerStartsAtTail) {
+    TextureStreamer streamer;
+    streamer.settings = StreamSettings();
+    auto image = MakeStreamImage();
+    REQUIRE(streamer.CanStream(*image));
+    GLuint texture = streamer.Create(image, GL_RGBA);
+    CHECK(streamer.ResidentBytes(texture) == ChainBytes(*image, 2));
+    CHECK(GlStub().textureLevelUploads == image->levels.size() - 2);
+
+    // Drawn small, it stays at its tail
+    streamer.Request(texture, 16.0f);
+    streamer.Update();
+    CHECK(streamer.ResidentBytes(texture) == ChainBytes(*image, 2));
+    CHECK(streamer.GetStats().uploadedBytes == 0);
+    CHECK(streamer.GetStats().fullBytes == ChainBytes(*image, 0));
+
+    streamer.Forget(texture);
+    CHECK(streamer.GetStats().textures == 0);
+    CHECK(streamer.GetStats().residentBytes == 0);
+}
+
+// A frame uploads no more than uploadBytesPerFrame, except that the first
+// step of a frame always goes through so large levels still arrive
+TEST(StreamerKeepsToUploadBudget) {
+    TextureStreamer streamer;
+    streamer.settings = StreamSettings();
+    auto image = MakeStreamImage();
+    streamer.settings.uploadBytesPerFrame = ChainBytes(*image, 1) + 1000;
+    GLuint first = streamer.Create(image, GL_RGBA);
+    GLuint second = streamer.Create(image, GL_RGBA);
+
+    streamer.Request(first, float(STREAM_SIZE));
+    streamer.Request(second, float(STREAM_SIZE));
+    streamer.Update();
+    TextureStreamer::Stats stats = streamer.GetStats();
+    CHECK(stats.uploadedBytes <= streamer.settings.uploadBytesPerFrame);
+    CHECK(stats.pendingTextures == 2);
+    // One of the two got level 1; the other had to wait
+    size_t finer = std::min(streamer.ResidentBytes(first), streamer.ResidentBytes(second));
+    size_t coarser = std::max(streamer.ResidentBytes(first), streamer.ResidentBytes(second));
+    CHECK(finer == ChainBytes(*image, 2));
+    CHECK(coarser == ChainBytes(*image, 1));
+
+    // Level 0 is larger than a frame's budget but still arrives, one texture a frame
+    for (int frame = 0; frame < 4; ++frame) {
+        streamer.Request(first, float(STREAM_SIZE));
+        streamer.Request(second, float(STREAM_SIZE));
+        streamer.Update();
+    }
+    CHECK(streamer.ResidentBytes(first) == ChainBytes(*image, 0));
+    CHECK(streamer.ResidentBytes(second) == ChainBytes(*image, 0));
+    CHECK(streamer.GetStats().pendingTextures == 0);
+    streamer.Forget(first);
+    streamer.Forget(second);
+}
+
+// Room for one full chain: a texture needing it waits until the other one
+// has gone idle, which is then evicted back to its tail
+TEST(StreamerEvictsIdleTexturesToBudget) {
+    TextureStreamer streamer;
+    streamer.settings = StreamSettings();
+    auto image = MakeStreamImage();
+    const size_t full = ChainBytes(*image, 0);
+    const size_t tail = ChainBytes(*image, 2);
+    streamer.settings.residentBudgetBytes = full + tail;
+    GLuint a = streamer.Create(image, GL_RGBA);
+    GLuint b = streamer.Create(image, GL_RGBA);
+
+    streamer.Request(a, float(STREAM_SIZE));
+    streamer.Update();
+    REQUIRE(streamer.ResidentBytes(a) == full);
+
+    // A is still within idleFrames, so B cannot grow
+    streamer.Request(b, float(STREAM_SIZE));
+    streamer.Update();
+    CHECK(streamer.ResidentBytes(b) == tail);
+    CHECK(streamer.GetStats().pendingTextures == 1);
+    CHECK(streamer.GetStats().residentBytes <= streamer.settings.residentBudgetBytes);
+
+    for (unsigned frame = 0; frame < streamer.settings.idleFrames + 1; ++frame) {
+        streamer.Request(b, float(STREAM_SIZE));
+        streamer.Update();
+        CHECK(streamer.GetStats().residentBytes <= streamer.settings.residentBudgetBytes);
+    }
+    CHECK(streamer.ResidentBytes(a) == tail);
+    CHECK(streamer.ResidentBytes(b) == full);
+    CHECK(streamer.GetStats().residentBytes == full + tail);
+    streamer.Forget(a);
+    streamer.Forget(b);
+}
+
+// A texture drawn smaller than it is held gives back its finer levels when
+// another needs the memory, though it is not idle
+TEST(StreamerShrinksTexturesDrawnSmaller) {
+    TextureStreamer streamer;
+    streamer.settings = StreamSettings();
+    auto image = MakeStreamImage();
+    const size_t full = ChainBytes(*image, 0);
+    const size_t tail = ChainBytes(*image, 2);
+    streamer.settings.residentBudgetBytes = full + tail;
+    GLuint a = streamer.Create(image, GL_RGBA);
+    GLuint b = streamer.Create(image, GL_RGBA);
+
+    streamer.Request(a, float(STREAM_SIZE));
+    streamer.Update();
+    REQUIRE(streamer.ResidentBytes(a) == full);
+
+    streamer.Request(a, float(STREAM_SIZE / 2));
+    streamer.Request(b, float(STREAM_SIZE));
+    streamer.Update();
+    TextureStreamer::Stats stats = streamer.GetStats();
+    CHECK(streamer.ResidentBytes(a) == ChainBytes(*image, 1));
+    CHECK(streamer.ResidentBytes(b) == ChainBytes(*image, 1));
+    CHECK(stats.evictedTextures == 1);
+    CHECK(stats.residentBytes <= streamer.settings.residentBudgetBytes);
+    streamer.Forget(a);
+    streamer.Forget(b);
+}
+
+// A two-channel chain streams as GL_RG: every level uploaded is read at its size
+TEST(StreamerUploadsTwoChannelsAsRg) {
+    TextureStreamer streamer;
+    streamer.settings = StreamSettings();
+    auto image = MakeStreamImage(2);
+    GLuint texture = streamer.Create(image, ImageInternalFormat(*image));
+    CHECK(GlStub().textureBytesRead == ChainBytes(*image, 2));
+
+    streamer.Request(texture, float(STREAM_SIZE));
+    streamer.Update();
+    CHECK(streamer.ResidentBytes(texture) == ChainBytes(*image, 0));
+    CHECK(GlStub().textureBytesRead == ChainBytes(*image, 2) + ChainBytes(*image, 0));
+    streamer.Forget(texture);
+}